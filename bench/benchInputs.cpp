@@ -0,0 +1,51 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include <cmath>
+
+std::vector<mini::gk2::kernels::SimdLevel> mini::gk2::bench::SimdLevels()
+{
+    std::vector<kernels::SimdLevel> levels = {kernels::SimdLevel::Scalar};
+    if (kernels::DetectSimdLevel() != kernels::SimdLevel::Scalar)
+    {
+        levels.push_back(kernels::DetectSimdLevel());
+    }
+    return levels;
+}
+
+std::vector<float> mini::gk2::bench::RippledSurface(int samplesCount, std::size_t stride, std::size_t offset)
+{
+    // center x, center y (normalized), frequency (radians per cell)
+    constexpr std::array<std::array<float, 3>, 3> waves = {
+        {{0.3f, 0.4f, 0.3f}, {0.7f, 0.6f, 0.2f}, {0.5f, 0.1f, 0.5f}}};
+
+    std::vector<float> heights(stride * (samplesCount + 2), 0.f);
+    const auto size = static_cast<float>(samplesCount);
+    for (auto i = 0; i < samplesCount; i++)
+    {
+        for (auto j = 0; j < samplesCount; j++)
+        {
+            auto h = 0.f;
+            for (const auto& [cx, cy, frequency] : waves)
+            {
+                const auto dx = static_cast<float>(j) - cx * size;
+                const auto dy = static_cast<float>(i) - cy * size;
+                const auto r  = std::sqrt(dx * dx + dy * dy);
+                h += 0.6f * std::sin(frequency * r) / (1.f + 0.05f * r);
+            }
+            heights[offset + i * stride + j] = h;
+        }
+    }
+    return heights;
+}
+
+void mini::gk2::bench::EncodeNormals(kernels::NormalRowFn normalRow, const float* firstRow, int samplesCount,
+                                     std::size_t texelSize, std::uint8_t* texels)
+{
+    const auto n = static_cast<std::size_t>(samplesCount);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const auto* row = firstRow + i * n;
+        normalRow(row - n, row, row + n, texels + texelSize * i * n, samplesCount, 0, samplesCount);
+    }
+}
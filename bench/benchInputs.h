@@ -0,0 +1,62 @@
+#pragma once
+#include "waterSurfaceKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Inputs shared by the benchmarks of duckBench and the checks of duckTests
+namespace mini::gk2::bench
+{
+constexpr int DROPS = 16; // per side of the grid of drops activating the whole surface
+
+// The scalar kernels and the best ones of the machine
+std::vector<kernels::SimdLevel> SimdLevels();
+
+// Sum of circular waves, so that the normals and the blocks of BC5 are not uniform. Rows of samplesCount heights
+// `stride` apart, the first at `offset`, in a buffer of samplesCount + 2 rows, so that with an offset of at least
+// `stride` there is a row of zeros above the first row and below the last one.
+std::vector<float> RippledSurface(int samplesCount, std::size_t stride, std::size_t offset);
+
+// Normal map of samplesCount x samplesCount heights stored row after row, with texelSize bytes per texel. The rows
+// above the first and below the last one have to be readable, as in a RippledSurface with a stride and an offset of
+// samplesCount.
+void EncodeNormals(kernels::NormalRowFn normalRow, const float* firstRow, int samplesCount, std::size_t texelSize,
+                   std::uint8_t* texels);
+
+// A drops x drops grid of drops, so that the waves cover the whole surface after a few steps
+template <typename Simulation> void DropGrid(Simulation& simulation, int drops = DROPS)
+{
+    for (auto y = 0; y < drops; y++)
+    {
+        for (auto x = 0; x < drops; x++)
+        {
+            simulation.DropAt((x + 0.5f) / drops, (y + 0.5f) / drops);
+        }
+    }
+}
+
+// Time of an Update() running exactly one step
+template <typename Simulation> double PrepareSingleSteps(Simulation& simulation)
+{
+    // Half a step of slack, so that every Update() runs exactly one step despite the rounding
+    const auto stepDt = simulation.StepTime() / simulation.SimSpeed();
+    simulation.Update(0.5 * stepDt);
+    return stepDt;
+}
+
+// The heights of a simulation row by row
+template <typename Simulation> std::vector<float> Heights(const Simulation& simulation)
+{
+    const auto n = simulation.SamplesCount();
+    std::vector<float> heights;
+    heights.reserve(static_cast<std::size_t>(n) * n);
+    for (auto i = 0; i < n; i++)
+    {
+        for (auto j = 0; j < n; j++)
+        {
+            heights.push_back(simulation.Height(i, j));
+        }
+    }
+    return heights;
+}
+} // namespace mini::gk2::bench
@@ -0,0 +1,91 @@
+#include "pch.h"
+
+#include "benchReport.h"
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <numeric>
+
+namespace
+{
+std::string Escape(std::string_view text)
+{
+    std::string result;
+    for (const auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result.push_back('\\');
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+double Percentile(const std::vector<double>& sorted, double p)
+{
+    const auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+} // namespace
+
+mini::gk2::bench::Statistics mini::gk2::bench::Summarize(std::vector<double> sampleNs)
+{
+    if (sampleNs.empty())
+    {
+        return {};
+    }
+    std::ranges::sort(sampleNs);
+    const auto sum = std::accumulate(sampleNs.begin(), sampleNs.end(), 0.0);
+    return {sampleNs.front(),
+            Percentile(sampleNs, 0.5),
+            Percentile(sampleNs, 0.9),
+            Percentile(sampleNs, 0.99),
+            sampleNs.back(),
+            sum / static_cast<double>(sampleNs.size())};
+}
+
+mini::gk2::bench::Report::Report(std::string label, std::string simdLevel, unsigned int threads)
+    : m_label(std::move(label)), m_simdLevel(std::move(simdLevel)), m_threads(threads)
+{
+}
+
+void mini::gk2::bench::Report::Add(Result result)
+{
+    const auto stats = Summarize(result.sampleNs);
+    std::println(stderr, "{:<20} {:<8} {:6} {:10.3f} ns/{:<8} p99 {:10.3f} us {:4} samples", result.kernel,
+                 result.variant, result.size, stats.p50 / result.unitsPerSample, result.unit, stats.p99 / 1e3,
+                 result.sampleNs.size());
+    m_results.push_back(std::move(result));
+}
+
+std::string mini::gk2::bench::Report::ToJson() const
+{
+    std::string json;
+    auto out = std::back_inserter(json);
+    std::format_to(out, "{{\n  \"label\": \"{}\",\n  \"simd\": \"{}\",\n  \"threads\": {},\n  \"results\": [",
+                   Escape(m_label), m_simdLevel, m_threads);
+    for (std::size_t r = 0; r < m_results.size(); r++)
+    {
+        const auto& result = m_results[r];
+        const auto stats   = Summarize(result.sampleNs);
+
+        // Throughput of the median sample, bytes per nanosecond are GB/s
+        std::format_to(out,
+                       "{}\n    {{\"kernel\": \"{}\", \"variant\": \"{}\", \"size\": {}, \"unit\": \"{}\", "
+                       "\"units_per_sample\": {}, \"samples\": {}, \"ns_per_unit\": {:.4f}, ",
+                       r == 0 ? "" : ",", result.kernel, Escape(result.variant), result.size, result.unit,
+                       result.unitsPerSample, result.sampleNs.size(), stats.p50 / result.unitsPerSample);
+        if (result.bytesPerUnit > 0.0)
+        {
+            std::format_to(out, "\"bytes_per_unit\": {:.1f}, \"gb_per_s\": {:.3f}, ", result.bytesPerUnit,
+                           result.unitsPerSample * result.bytesPerUnit / stats.p50);
+        }
+        std::format_to(out,
+                       "\"ns\": {{\"min\": {:.1f}, \"p50\": {:.1f}, \"p90\": {:.1f}, \"p99\": {:.1f}, "
+                       "\"max\": {:.1f}, \"mean\": {:.1f}}}}}",
+                       stats.min, stats.p50, stats.p90, stats.p99, stats.max, stats.mean);
+    }
+    std::format_to(out, "\n  ]\n}}\n");
+    return json;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace mini::gk2::bench
+{
+// Timings of one kernel at one size. A sample covers `unitsPerSample` units of work (cells, vertices, triangles,
+// queries or steps), the throughput is computed from the median sample.
+struct Result
+{
+    std::string kernel;
+    std::string variant;        // SIMD level, encoding or mesh, empty if the kernel has a single one
+    int size              = 0;  // grid side, vertices of a mesh, ...
+    const char* unit      = ""; // "cell", "vertex", "triangle", "object", "query" or "step"
+    double unitsPerSample = 1.0;
+    double bytesPerUnit   = 0.0; // estimated memory traffic (read and written), 0 if not meaningful
+    std::vector<double> sampleNs;
+};
+
+struct Statistics
+{
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+};
+
+// Nearest rank percentiles of the samples
+Statistics Summarize(std::vector<double> sampleNs);
+
+// A kernel is sampled until it has maxSamples samples, or minSamples once the time budget is spent
+struct SamplingOptions
+{
+    int warmupSamples    = 2;
+    int minSamples       = 5;
+    int maxSamples       = 100;
+    double budgetSeconds = 0.5;
+};
+
+// Times single calls of func in nanoseconds
+template <typename Func> std::vector<double> Sample(const SamplingOptions& options, Func&& func)
+{
+    using clock = std::chrono::steady_clock;
+    for (auto w = 0; w < options.warmupSamples; w++)
+    {
+        func();
+    }
+
+    std::vector<double> sampleNs;
+    const auto budget = std::chrono::duration<double>(options.budgetSeconds);
+    const auto start  = clock::now();
+    while (static_cast<int>(sampleNs.size()) < options.maxSamples &&
+           (static_cast<int>(sampleNs.size()) < options.minSamples || clock::now() - start < budget))
+    {
+        const auto sampleStart = clock::now();
+        func();
+        sampleNs.push_back(std::chrono::duration<double, std::nano>(clock::now() - sampleStart).count());
+    }
+    return sampleNs;
+}
+
+// Results of a whole run, written as a single JSON document so that runs of different commits can be compared by a
+// script. Every result is also printed to stderr as it arrives.
+class Report
+{
+  public:
+    Report(std::string label, std::string simdLevel, unsigned int threads);
+
+    void Add(Result result);
+
+    std::string ToJson() const;
+
+  private:
+    std::string m_label;
+    std::string m_simdLevel;
+    unsigned int m_threads;
+    std::vector<Result> m_results;
+};
+} // namespace mini::gk2::bench
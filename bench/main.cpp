@@ -0,0 +1,985 @@
+#include "pch.h"
+
+#include "arcLengthTable.h"
+#include "benchInputs.h"
+#include "benchReport.h"
+#include "benchmarks.h"
+#include "duckSimulation.h"
+#include "fft.h"
+#include "flockSimulation.h"
+#include "meshData.h"
+#include "meshFile.h"
+#include "meshOptimizer.h"
+#include "normalMapEncoding.h"
+#include "oceanSimulation.h"
+#include "shallowWaterSimulation.h"
+#include "simulationScheduler.h"
+#include "surfaceTexture.h"
+#include "waterSurfaceKernels.h"
+#include "waterSurfaceSimulation.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+using namespace mini;
+using namespace mini::gk2;
+using bench::DropGrid;
+using bench::PrepareSingleSteps;
+using bench::RippledSurface;
+using bench::SimdLevels;
+
+namespace
+{
+constexpr std::array<int, 5> GRID_SIZES       = {128, 256, 512, 1024, 2048};
+constexpr std::array<int, 2> QUICK_GRID_SIZES = {128, 512};
+
+// Grids larger than the caches, where the blocks of the temporal blocking pay off
+constexpr std::array<int, 3> TEMPORAL_GRID_SIZES       = {512, 1024, 2048};
+constexpr std::array<int, 1> QUICK_TEMPORAL_GRID_SIZES = {512};
+
+// Grids small enough for the setup of a step to matter next to the stencil
+constexpr std::array<int, 4> SMALL_GRID_SIZES = {16, 32, 64, 128};
+
+// Threads of the private pools of the water_step sweep at the largest grid
+constexpr std::array<unsigned int, 5> WATER_THREAD_COUNTS = {1, 2, 4, 8, 16};
+
+constexpr std::array<int, 3> FLOCK_SIZES       = {1024, 16384, 131072};
+constexpr std::array<int, 2> QUICK_FLOCK_SIZES = {1024, 16384};
+
+// Vertices per side of the generated meshes, 255 x 255 is the largest grid with 16 bit indices and 1024 x 1024 a
+// million vertex scan
+constexpr std::array<int, 5> MESH_SIDES       = {16, 64, 128, 255, 1024};
+constexpr std::array<int, 2> QUICK_MESH_SIDES = {16, 128};
+
+constexpr int DUCK_STEPS_PER_SAMPLE = 1000; // a single step is too short for the clock
+constexpr int SUBSTEPS_PER_UPDATE   = 16;
+
+// Estimated memory traffic per unit of work, for the GB/s of the report
+constexpr double STENCIL_BYTES_PER_CELL  = 3 * sizeof(float);     // current and previous heights, next heights
+constexpr double NORMAL_BYTES_PER_CELL   = sizeof(float) + 4;     // heights, RGBA8 texel
+constexpr double RG8_BYTES_PER_CELL      = sizeof(float) + 2;     // heights, RG8 texel
+constexpr double BC5_BYTES_PER_CELL      = 2 + 1;                 // RG8 texel, its byte of the BC5 block
+constexpr double HALF_BYTES_PER_CELL     = sizeof(float) + 2;     // height, half float
+constexpr double WATER_BYTES_PER_CELL    = 3 * sizeof(float) + 4; // the stencil and the fused normal map
+constexpr double SHALLOW_BYTES_PER_CELL  = 9 * sizeof(float) + 4; // heights, velocities and fluxes, normal map
+constexpr double ADJACENCY_BYTES_PER_TRI = 3 * (4 + 12) + 6 * 4;  // indices and positions, adjacency indices
+constexpr double OCEAN_BYTES_PER_PASS    = 4 * sizeof(float);     // complex value read and written by a pass
+constexpr double FLOCK_BYTES_PER_OBJECT  = 22 * sizeof(float);    // points, distance, speed, table cell, instance
+
+constexpr int SURFACE_QUERIES      = 1 << 16; // per sample, spread over the whole pool
+constexpr int SURFACE_SETTLE_STEPS = 50;      // so that the waves of the drops reach the queried points
+
+// Newton iteration on the arc length of a segment, the per frame alternative to the arc length tables
+constexpr int NEWTON_MAX_ITERATIONS = 8;
+constexpr float NEWTON_TOLERANCE    = 1e-4f; // of the distance, relative to the length of the segment
+
+struct Options
+{
+    std::string filter;           // runs only the kernels whose name contains it
+    std::filesystem::path output; // stdout if empty
+    std::filesystem::path duckMesh = std::filesystem::path(DUCK_RESOURCES_DIR) / "meshes" / "duck" / "duck.txt";
+    std::string label;
+    std::filesystem::path replay;       // checks the recording instead of running the benchmarks if not empty
+    std::filesystem::path replayHashes; // where the replay writes its hashes, none if empty
+    bool quick = false;
+};
+
+struct Context
+{
+    Options options;
+    bench::SamplingOptions sampling;
+    bench::Report& report;
+
+    bool Enabled(std::string_view kernel) const
+    {
+        return options.filter.empty() || kernel.find(options.filter) != std::string_view::npos;
+    }
+
+    std::span<const int> GridSizes() const
+    {
+        return options.quick ? std::span<const int>(QUICK_GRID_SIZES) : std::span<const int>(GRID_SIZES);
+    }
+
+    std::span<const int> TemporalGridSizes() const
+    {
+        return options.quick ? std::span<const int>(QUICK_TEMPORAL_GRID_SIZES)
+                             : std::span<const int>(TEMPORAL_GRID_SIZES);
+    }
+
+    std::span<const int> FlockSizes() const
+    {
+        return options.quick ? std::span<const int>(QUICK_FLOCK_SIZES) : std::span<const int>(FLOCK_SIZES);
+    }
+
+    std::span<const int> MeshSides() const
+    {
+        return options.quick ? std::span<const int>(QUICK_MESH_SIDES) : std::span<const int>(MESH_SIDES);
+    }
+
+    void Add(const char* kernel, std::string variant, int size, const char* unit, double unitsPerSample,
+             double bytesPerUnit, std::vector<double> sampleNs) const
+    {
+        report.Add({kernel, std::move(variant), size, unit, unitsPerSample, bytesPerUnit, std::move(sampleNs)});
+    }
+};
+
+// Row kernel of the wave equation on the calling thread, rows with a column of padding on both sides
+void RunStencilRow(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        const auto stencilRow = kernels::SelectStencilRow(level);
+        for (const auto n : context.GridSizes())
+        {
+            const auto stride = static_cast<std::size_t>(n) + 2;
+            auto curr         = RippledSurface(n, stride, stride + 1);
+            auto next         = curr;
+            const std::vector<float> damping(n, 0.99f);
+            const auto a = 0.2f;
+            const auto b = 2.f - 4.f * a;
+
+            const auto grid = [&]()
+            {
+                for (auto i = 1; i <= n; i++)
+                {
+                    const auto* row = curr.data() + i * stride + 1;
+                    stencilRow(row - stride, row, row + stride, damping.data(), next.data() + i * stride + 1, n, a, b);
+                }
+                curr.swap(next);
+            };
+            auto samples = bench::Sample(context.sampling, grid);
+            context.Add("stencil_row", kernels::ToString(level), n, "cell", static_cast<double>(n) * n,
+                        STENCIL_BYTES_PER_CELL, std::move(samples));
+        }
+    }
+}
+
+// RGBA8 and RG8 normal row kernels on the calling thread
+void RunNormalRow(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        for (const auto encoding : {NormalMapEncoding::RGBA8, NormalMapEncoding::RG8})
+        {
+            const auto normalRow = kernels::SelectNormalRow(level, encoding);
+            const auto rg8       = encoding == NormalMapEncoding::RG8;
+            const auto texelSize = rg8 ? 2U : 4U;
+            const auto variant   = std::string(kernels::ToString(level)) + (rg8 ? "_rg8" : "");
+            for (const auto n : context.GridSizes())
+            {
+                const auto heights   = RippledSurface(n, n, n);
+                const auto* firstRow = heights.data() + n;
+                std::vector<std::uint8_t> texels(texelSize * static_cast<std::size_t>(n) * n);
+
+                const auto grid = [&]() { bench::EncodeNormals(normalRow, firstRow, n, texelSize, texels.data()); };
+                auto samples    = bench::Sample(context.sampling, grid);
+                context.Add("normal_row", variant, n, "cell", static_cast<double>(n) * n,
+                            rg8 ? RG8_BYTES_PER_CELL : NORMAL_BYTES_PER_CELL, std::move(samples));
+            }
+        }
+    }
+}
+
+// BC5 compression of RG8 normal maps on the calling thread. That it decodes within BC5_MAX_ERROR is checked by
+// duckTests.
+void RunBc5Encode(const Context& context)
+{
+    for (const auto n : context.GridSizes())
+    {
+        const auto heights = RippledSurface(n, n, n);
+        std::vector<std::uint8_t> rg(normalEncoding::EncodedSize(NormalMapEncoding::RG8, n, n));
+        std::vector<std::uint8_t> bc5(normalEncoding::EncodedSize(NormalMapEncoding::BC5, n, n));
+        bench::EncodeNormals(kernels::NormalRowRGScalar, heights.data() + n, n, 2, rg.data());
+
+        const auto encode = [&]() { normalEncoding::EncodeBC5(rg.data(), n, n, bc5.data()); };
+        auto samples      = bench::Sample(context.sampling, encode);
+        context.Add("bc5_encode", "", n, "cell", static_cast<double>(n) * n, BC5_BYTES_PER_CELL, std::move(samples));
+    }
+}
+
+// Half float packing of the heights of the R16F maps on the calling thread
+void RunFloatToHalf(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        const auto floatToHalf = kernels::SelectFloatToHalfRow(level);
+        for (const auto n : context.GridSizes())
+        {
+            const auto heights = RippledSurface(n, n, 0);
+            std::vector<std::uint16_t> halves(static_cast<std::size_t>(n) * n);
+
+            const auto pack = [&]() { floatToHalf(heights.data(), halves.data(), n * n); };
+            auto samples    = bench::Sample(context.sampling, pack);
+            context.Add("float_to_half", kernels::ToString(level), n, "cell", static_cast<double>(n) * n,
+                        HALF_BYTES_PER_CELL, std::move(samples));
+        }
+    }
+}
+
+// Whole steps of a fully active surface with the heights in Storage, on the shared pool unless `workers` is given
+template <typename Storage>
+void RunWaterStepWith(const Context& context, kernels::SimdLevel level, int n, ThreadPool* workers = nullptr)
+{
+    BasicWaterSurfaceSimulation<Storage> simulation(n);
+    simulation.Seed(n);
+    simulation.SetSimdLevel(level);
+    simulation.SetActivityThreshold(0.f);
+    if (workers != nullptr)
+    {
+        simulation.SetThreadPool(*workers);
+    }
+    DropGrid(simulation);
+
+    // The float32 variants keep the name of the level alone, as before the compact storages
+    auto variant = std::string(kernels::ToString(level));
+    if (!std::is_same_v<Storage, Float32Storage>)
+    {
+        variant += std::string("_") + Storage::NAME;
+    }
+    if (workers != nullptr)
+    {
+        variant += std::format("_threads{}", workers->ThreadCount());
+    }
+    // The three height buffers shrink with the storage, the normal map does not
+    const auto bytesPerCell = WATER_BYTES_PER_CELL - 3 * (sizeof(float) - sizeof(typename Storage::Value));
+
+    const auto stepDt = PrepareSingleSteps(simulation);
+    auto samples      = bench::Sample(context.sampling, [&]() { simulation.Update(stepDt); });
+    context.Add("water_step", std::move(variant), n, "cell", static_cast<double>(n) * n, bytesPerCell,
+                std::move(samples));
+}
+
+// Whole steps of a quiet pool after a single drop with the default activity threshold, as the demo runs between the
+// drops. Only the tiles the waves reach are stepped, the throughput counts the cells of the whole grid and the mean
+// count of the active tiles over the samples is printed next to the timings.
+void RunWaterStepQuiet(const Context& context, int n)
+{
+    const auto level = kernels::DetectSimdLevel();
+    WaterSurfaceSimulation simulation(n);
+    simulation.Seed(n);
+    simulation.SetSimdLevel(level);
+    simulation.DropAt(0.5f, 0.5f);
+
+    const auto stepDt = PrepareSingleSteps(simulation);
+    auto steps        = 0;
+    auto activeTiles  = 0.0;
+    const auto step   = [&]()
+    {
+        simulation.Update(stepDt);
+        activeTiles += simulation.ActiveTilesCount();
+        steps++;
+    };
+    auto samples       = bench::Sample(context.sampling, step);
+    const auto variant = std::string(kernels::ToString(level)) + "_quiet";
+    std::println(stderr, "water_step {} {}: {:.1f} of {} tiles active", variant, n, activeTiles / std::max(steps, 1),
+                 simulation.TilesCount());
+    context.Add("water_step", variant, n, "cell", static_cast<double>(n) * n, WATER_BYTES_PER_CELL, std::move(samples));
+}
+
+// Whole steps of a fully active surface: the tiles, the threads and the fused normal map. The compact height storages
+// run at the detected level only, their error against float32 is checked by duckTests. The _quiet variants keep the
+// default activity threshold, the _threads<N> ones sweep private pools of WATER_THREAD_COUNTS at the largest grid.
+void RunWaterStep(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        for (const auto n : context.GridSizes())
+        {
+            RunWaterStepWith<Float32Storage>(context, level, n);
+        }
+    }
+    for (const auto n : context.GridSizes())
+    {
+        RunWaterStepWith<Float16Storage>(context, kernels::DetectSimdLevel(), n);
+        RunWaterStepWith<Fixed16Storage>(context, kernels::DetectSimdLevel(), n);
+        RunWaterStepQuiet(context, n);
+    }
+    for (const auto threads : WATER_THREAD_COUNTS)
+    {
+        ThreadPool workers(threads);
+        RunWaterStepWith<Float32Storage>(context, kernels::DetectSimdLevel(), context.GridSizes().back(), &workers);
+    }
+}
+
+// Updates running several steps of small grids, one Step() per step against the batched StepN() of the water
+void RunWaterSubsteps(const Context& context)
+{
+    const auto substeps = [&](bool batched, int n)
+    {
+        WaterSurfaceSimulation simulation(n);
+        simulation.SetBatchedSteps(batched);
+        simulation.Seed(n);
+        simulation.SetActivityThreshold(0.f);
+        DropGrid(simulation);
+
+        const auto stepDt = PrepareSingleSteps(simulation);
+        const auto cells  = static_cast<double>(SUBSTEPS_PER_UPDATE) * n * n;
+
+        auto samples = bench::Sample(context.sampling, [&]() { simulation.Update(SUBSTEPS_PER_UPDATE * stepDt); });
+        context.Add("water_substeps", batched ? "step_n" : "step", n, "cell", cells, WATER_BYTES_PER_CELL,
+                    std::move(samples));
+    };
+    for (const auto n : SMALL_GRID_SIZES)
+    {
+        substeps(false, n);
+        substeps(true, n);
+    }
+}
+
+// Updates of TEMPORAL_BLOCK_STEPS steps of a fully active surface, step by step against the blocks of the temporal
+// blocking. That both compute the same heights is checked by duckTests.
+void RunWaterTemporal(const Context& context)
+{
+    constexpr auto steps = WaterSurfaceSimulation::TEMPORAL_BLOCK_STEPS;
+    for (const auto n : context.TemporalGridSizes())
+    {
+        for (const auto blocking : {false, true})
+        {
+            WaterSurfaceSimulation simulation(n);
+            simulation.Seed(n);
+            simulation.SetActivityThreshold(0.f);
+            simulation.SetTemporalBlocking(blocking);
+            DropGrid(simulation);
+
+            const auto stepDt = PrepareSingleSteps(simulation);
+            const auto cells  = static_cast<double>(steps) * n * n;
+            auto samples      = bench::Sample(context.sampling, [&]() { simulation.Update(steps * stepDt); });
+            context.Add("water_temporal", blocking ? "blocked" : "step_by_step", n, "cell", cells,
+                        WATER_BYTES_PER_CELL, std::move(samples));
+        }
+    }
+}
+
+// Surface textures of the simulations changing every cell, in every encoding
+void RunSurfaceTexture(const Context& context)
+{
+    auto& workers = ThreadPool::Shared();
+    for (const auto encoding : NORMAL_MAP_ENCODINGS)
+    {
+        for (const auto n : context.GridSizes())
+        {
+            const auto heights = RippledSurface(n, n, 0);
+            SurfaceTexture texture;
+            texture.SetEncoding(encoding);
+            texture.Resize(n);
+
+            const auto texelBytes = static_cast<double>(texture.RowPitch()) * texture.Rows() / n / n;
+            auto samples = bench::Sample(context.sampling, [&]() { texture.Build(heights.data(), n, false, workers); });
+            context.Add("surface_texture", ToString(texture.Encoding()), n, "cell", static_cast<double>(n) * n,
+                        sizeof(float) + texelBytes, std::move(samples));
+        }
+    }
+}
+
+// Steps of the shallow water from a grid of drops, with a body circling the pool for the _body variants. That the
+// SIMD heights match the scalar ones and the water is conserved is checked by duckTests.
+void RunShallowWaterStep(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        for (const auto withBody : {false, true})
+        {
+            const auto variant = std::string(kernels::ToString(level)) + (withBody ? "_body" : "");
+            for (const auto n : context.GridSizes())
+            {
+                ShallowWaterSimulation simulation(n);
+                simulation.SetSimdLevel(level);
+                DropGrid(simulation);
+                const auto body = withBody ? simulation.AddFloatingBody(0.04f, 0.003f) : -1;
+
+                const auto stepDt = PrepareSingleSteps(simulation);
+                auto angle        = 0.f;
+                const auto step   = [&]()
+                {
+                    if (withBody)
+                    {
+                        angle += 0.02f;
+                        simulation.MoveFloatingBody(body, 0.5f + 0.3f * std::cos(angle), 0.5f + 0.3f * std::sin(angle));
+                    }
+                    simulation.Update(stepDt);
+                };
+                auto samples = bench::Sample(context.sampling, step);
+                context.Add("shallow_water_step", variant, n, "cell", static_cast<double>(n) * n,
+                            SHALLOW_BYTES_PER_CELL, std::move(samples));
+            }
+        }
+    }
+}
+
+// Height and slope under a body at scattered points of the shallow water, as the duck queries them every frame
+void RunShallowWaterQuery(const Context& context)
+{
+    for (const auto n : context.GridSizes())
+    {
+        ShallowWaterSimulation simulation(n);
+        DropGrid(simulation);
+        const auto stepDt = PrepareSingleSteps(simulation);
+        for (auto s = 0; s < SURFACE_SETTLE_STEPS; s++)
+        {
+            simulation.Update(stepDt);
+        }
+
+        // The sum keeps the queries from being optimized out
+        auto sum           = 0.f;
+        const auto queries = [&]()
+        {
+            for (auto q = 0; q < SURFACE_QUERIES; q++)
+            {
+                const auto x      = static_cast<float>((q * 37) % 1024) / 1024.f;
+                const auto y      = static_cast<float>((q * 91) % 1024) / 1024.f;
+                const auto sample = simulation.SampleSurface(x, y, 0.04f);
+                sum += sample.height + sample.slopeX + sample.slopeY;
+            }
+        };
+        auto samples = bench::Sample(context.sampling, queries);
+        context.Add("shallow_water_query", "", n, "query", SURFACE_QUERIES, 0.0, std::move(samples));
+        std::println(stderr, "shallow_water_query {}: checksum {:.3f}", n, sum);
+    }
+}
+
+// A frame of the ocean is an inverse FFT of the evolved spectrum, 2 log2 N passes over the grid. The JONSWAP spectrum
+// runs at the detected level only.
+void RunOceanFrame(const Context& context)
+{
+    const auto frames = [&](kernels::SimdLevel level, OceanSpectrum spectrum)
+    {
+        OceanParameters parameters;
+        parameters.spectrum = spectrum;
+        auto variant        = std::string(kernels::ToString(level));
+        if (spectrum != OceanSpectrum::Phillips)
+        {
+            variant += std::string("_") + ToString(spectrum);
+        }
+        for (const auto n : context.GridSizes())
+        {
+            OceanSimulation simulation(n, parameters);
+            simulation.SetSimdLevel(level);
+
+            const auto stepDt = PrepareSingleSteps(simulation);
+            auto samples      = bench::Sample(context.sampling, [&]() { simulation.Update(stepDt); });
+            const auto size   = simulation.SamplesCount();
+            context.Add("ocean_frame", variant, size, "cell", static_cast<double>(size) * size,
+                        2.0 * std::log2(size) * OCEAN_BYTES_PER_PASS, std::move(samples));
+        }
+    };
+    for (const auto level : SimdLevels())
+    {
+        frames(level, OceanSpectrum::Phillips);
+    }
+    frames(kernels::DetectSimdLevel(), OceanSpectrum::Jonswap);
+}
+
+// The inverse FFT of a frame alone, without the spectrum and the normal map. Its error against the direct sum is
+// checked by duckTests.
+void RunOceanFft(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        for (const auto n : context.GridSizes())
+        {
+            InverseFft2D fft(n);
+            fft.SetSimdLevel(level);
+            std::vector<float> re(n * static_cast<std::size_t>(fft.Stride()), 1.f);
+            std::vector<float> im(re.size(), 0.f);
+
+            auto& workers = ThreadPool::Shared();
+            auto samples  = bench::Sample(context.sampling, [&]() { fft.Transform(re.data(), im.data(), workers); });
+            context.Add("ocean_fft", kernels::ToString(level), n, "cell", static_cast<double>(n) * n,
+                        2.0 * std::log2(n) * OCEAN_BYTES_PER_PASS, std::move(samples));
+        }
+    }
+}
+
+void RunDuckStep(const Context& context)
+{
+    DuckSimulation simulation({-1.f, -1.f}, {1.f, 1.f});
+    simulation.Seed(1);
+    const auto stepDt = PrepareSingleSteps(simulation);
+    const auto steps  = [&]()
+    {
+        for (auto s = 0; s < DUCK_STEPS_PER_SAMPLE; s++)
+        {
+            simulation.Update(stepDt);
+        }
+    };
+    auto samples = bench::Sample(context.sampling, steps);
+    context.Add("duck_step", "", 1, "step", DUCK_STEPS_PER_SAMPLE, 0.0, std::move(samples));
+}
+
+// A frame of the wave water and the ocean side by side, each with half of the threads. Stepped one after the other
+// the frame takes the sum of the two, scheduled it takes the longer one.
+void RunScheduledFrame(const Context& context)
+{
+    const auto threads = std::max(ThreadPool::DefaultThreadCount() / 2, 1U);
+    ThreadPool waterWorkers(threads);
+    ThreadPool oceanWorkers(threads);
+    for (const auto n : context.GridSizes())
+    {
+        WaterSurfaceSimulation water(n);
+        water.Seed(n);
+        water.SetActivityThreshold(0.f);
+        water.SetThreadPool(waterWorkers);
+        DropGrid(water);
+        OceanSimulation ocean(n);
+        ocean.SetThreadPool(oceanWorkers);
+
+        // The same dt steps both exactly once per frame
+        const auto stepDt = PrepareSingleSteps(water);
+        ocean.SetSimSpeed(ocean.StepTime() / stepDt);
+        ocean.Update(0.5 * stepDt);
+
+        SimulationScheduler scheduler;
+        scheduler.Add(water);
+        scheduler.Add(ocean);
+
+        const auto cells  = 2.0 * n * n;
+        const auto serial = [&]()
+        {
+            water.Update(stepDt);
+            ocean.Update(stepDt);
+        };
+        auto samples = bench::Sample(context.sampling, serial);
+        context.Add("scheduled_frame", "serial", n, "cell", cells, 0.0, std::move(samples));
+        samples = bench::Sample(context.sampling, [&]() { scheduler.Update(stepDt); });
+        context.Add("scheduled_frame", "scheduled", n, "cell", cells, 0.0, std::move(samples));
+    }
+}
+
+// A step of the flock and the evaluation of its frames into the instance buffer
+void RunFlockUpdate(const Context& context)
+{
+    for (const auto level : SimdLevels())
+    {
+        for (const auto n : context.FlockSizes())
+        {
+            FlockSimulation simulation(n, {-1.f, -1.f}, {1.f, 1.f});
+            simulation.Seed(1);
+            simulation.SetSimdLevel(level);
+
+            const auto stepDt = PrepareSingleSteps(simulation);
+            auto samples      = bench::Sample(context.sampling, [&]() { simulation.Update(stepDt); });
+            context.Add("flock_update", kernels::ToString(level), n, "object", n, FLOCK_BYTES_PER_OBJECT,
+                        std::move(samples));
+        }
+    }
+}
+
+// Random segments in [-1, 1]^2 stored as a structure of arrays, as in FlockSimulation
+struct Segments
+{
+    std::array<std::vector<float>, 4> x;
+    std::array<std::vector<float>, 4> y;
+
+    explicit Segments(int count)
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+        for (auto i = 0; i < 4; i++)
+        {
+            x[i].resize(count);
+            y[i].resize(count);
+            std::ranges::generate(x[i], [&]() { return uniform(generator); });
+            std::ranges::generate(y[i], [&]() { return uniform(generator); });
+        }
+    }
+
+    std::array<const float*, 4> X() const
+    {
+        return {x[0].data(), x[1].data(), x[2].data(), x[3].data()};
+    }
+
+    std::array<const float*, 4> Y() const
+    {
+        return {y[0].data(), y[1].data(), y[2].data(), y[3].data()};
+    }
+};
+
+// Speed |C'(t)| of segment k of the uniform cubic B-spline, derivatives of the basis of kernels::BSplineRowFn
+float SegmentSpeed(const Segments& segments, int k, float t)
+{
+    const auto s2 = t * t;
+    const auto u  = 1.f - t;
+    const std::array<float, 4> d{-0.5f * u * u, 1.5f * s2 - 2.f * t, -1.5f * s2 + t + 0.5f, 0.5f * s2};
+    auto dx = 0.f;
+    auto dy = 0.f;
+    for (auto i = 0; i < 4; i++)
+    {
+        dx += d[i] * segments.x[i][k];
+        dy += d[i] * segments.y[i][k];
+    }
+    return std::hypot(dx, dy);
+}
+
+// Length of segment k from 0 to t by 5 point Gauss-Legendre quadrature
+float SegmentLength(const Segments& segments, int k, float t)
+{
+    constexpr std::array<float, 5> nodes   = {-0.9061798f, -0.5384693f, 0.f, 0.5384693f, 0.9061798f};
+    constexpr std::array<float, 5> weights = {0.2369269f, 0.4786287f, 0.5688889f, 0.4786287f, 0.2369269f};
+    auto length                            = 0.f;
+    for (auto i = 0; i < 5; i++)
+    {
+        length += weights[i] * SegmentSpeed(segments, k, 0.5f * t * (nodes[i] + 1.f));
+    }
+    return 0.5f * t * length;
+}
+
+// Parameter at `fraction` of the length of segment k, solved from scratch as a frame without tables would
+float NewtonParameterAt(const Segments& segments, int k, float fraction)
+{
+    const auto total    = SegmentLength(segments, k, 1.f);
+    const auto distance = fraction * total;
+    auto t              = fraction;
+    for (auto i = 0; i < NEWTON_MAX_ITERATIONS; i++)
+    {
+        const auto error = SegmentLength(segments, k, t) - distance;
+        const auto speed = SegmentSpeed(segments, k, t);
+        if (std::abs(error) <= NEWTON_TOLERANCE * total || speed == 0.f)
+        {
+            break;
+        }
+        t = std::clamp(t - error / speed, 0.f, 1.f);
+    }
+    return t;
+}
+
+// Parameters at given distances along many segments: the lookups in the tables of the flock and the duck against
+// Newton iteration on the arc length in every frame
+void RunArcLengthLookup(const Context& context)
+{
+    for (const auto n : context.FlockSizes())
+    {
+        const Segments segments(n);
+        const auto x = segments.X();
+        const auto y = segments.Y();
+        std::vector<ArcLengthTable> tables(n);
+        BuildArcLengthTables(kernels::BSplineRowScalar, x.data(), y.data(), tables.data(), n);
+
+        std::vector<float> fractions(n);
+        std::vector<float> distances(n);
+        std::vector<float> t(n);
+        std::mt19937 generator(2);
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+        for (auto k = 0; k < n; k++)
+        {
+            fractions[k] = uniform(generator);
+            distances[k] = fractions[k] * tables[k].length;
+        }
+
+        const auto newton = [&]()
+        {
+            for (auto k = 0; k < n; k++)
+            {
+                t[k] = NewtonParameterAt(segments, k, fractions[k]);
+            }
+        };
+        auto samples = bench::Sample(context.sampling, newton);
+        context.Add("arc_length_lookup", "newton", n, "object", n, 0.0, std::move(samples));
+
+        const auto table = [&]()
+        {
+            for (auto k = 0; k < n; k++)
+            {
+                t[k] = tables[k].ParameterAt(distances[k]);
+            }
+        };
+        samples = bench::Sample(context.sampling, table);
+        context.Add("arc_length_lookup", "table", n, "object", n, sizeof(ArcLengthTable) + 2 * sizeof(float),
+                    std::move(samples));
+    }
+}
+
+// Arc length tables of many segments, one by one as for the duck and in SIMD batches as for the flock
+void RunArcLengthBuild(const Context& context)
+{
+    for (const auto n : context.FlockSizes())
+    {
+        const Segments segments(n);
+        const auto x = segments.X();
+        const auto y = segments.Y();
+        std::vector<ArcLengthTable> tables(n);
+
+        const auto single = [&]()
+        {
+            for (auto k = 0; k < n; k++)
+            {
+                const float px[4] = {x[0][k], x[1][k], x[2][k], x[3][k]};
+                const float py[4] = {y[0][k], y[1][k], y[2][k], y[3][k]};
+                tables[k]         = BuildArcLengthTable(px, py);
+            }
+        };
+        auto samples = bench::Sample(context.sampling, single);
+        context.Add("arc_length_build", "single", n, "object", n, 0.0, std::move(samples));
+
+        for (const auto level : SimdLevels())
+        {
+            const auto bsplineRow = kernels::SelectBSplineRow(level);
+            const auto batched    = [&]() { BuildArcLengthTables(bsplineRow, x.data(), y.data(), tables.data(), n); };
+            samples               = bench::Sample(context.sampling, batched);
+            context.Add("arc_length_build", kernels::ToString(level), n, "object", n, 0.0, std::move(samples));
+        }
+    }
+}
+
+// Wavy side x side grid in the text format of LoadMeshData
+void WriteGridMesh(const std::filesystem::path& path, int side)
+{
+    std::ofstream output(path);
+    output << side * side << '\n';
+    for (auto i = 0; i < side; i++)
+    {
+        for (auto j = 0; j < side; j++)
+        {
+            const auto u = static_cast<float>(j) / static_cast<float>(side - 1);
+            const auto v = static_cast<float>(i) / static_cast<float>(side - 1);
+            output << u << ' ' << 0.1f * std::sin(6.f * u) * std::cos(6.f * v) << ' ' << v << " 0 1 0 " << u << ' '
+                   << v << '\n';
+        }
+    }
+    output << 2 * (side - 1) * (side - 1) << '\n';
+    for (auto i = 0; i + 1 < side; i++)
+    {
+        for (auto j = 0; j + 1 < side; j++)
+        {
+            const auto k = i * side + j;
+            output << k << ' ' << k + side << ' ' << k + 1 << '\n';
+            output << k + 1 << ' ' << k + side << ' ' << k + side + 1 << '\n';
+        }
+    }
+}
+
+// The parser LoadMeshData replaced, operator>> on an ifstream value by value, the baseline of the mesh_load variants
+MeshData LoadMeshDataIostream(const std::filesystem::path& meshPath)
+{
+    std::ifstream input;
+    input.exceptions(std::ios::badbit | std::ios::failbit | std::ios::eofbit);
+    input.open(meshPath);
+
+    int vn;
+    input >> vn;
+    MeshData mesh;
+    auto& verts = mesh.vertices;
+    verts.resize(vn);
+    for (auto i = 0; i < vn; ++i)
+    {
+        input >> verts[i].position.x >> verts[i].position.y >> verts[i].position.z >> verts[i].normal.x >>
+            verts[i].normal.y >> verts[i].normal.z >> verts[i].tex.x >> verts[i].tex.y;
+    }
+
+    int in;
+    input >> in;
+    auto& inds = mesh.indices;
+    inds.resize(3 * static_cast<std::size_t>(in));
+    for (auto i = 0; i < in; ++i)
+    {
+        input >> inds[3 * i] >> inds[3 * i + 1] >> inds[3 * i + 2];
+    }
+
+    ComputeTangents(mesh);
+    return mesh;
+}
+
+// Loading, adjacency and optimization of the generated grids and of the duck, the text files parsed and their binary
+// conversions mapped and copied out, as the upload to the GPU reads them
+void RunMeshes(const Context& context)
+{
+    if (!context.Enabled("mesh_load") && !context.Enabled("mesh_load_binary") && !context.Enabled("mesh_adjacency") &&
+        !context.Enabled("mesh_optimize"))
+    {
+        return;
+    }
+
+    const auto directory = std::filesystem::temp_directory_path() / "duckBench";
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::pair<std::string, std::filesystem::path>> meshes;
+    for (const auto side : context.MeshSides())
+    {
+        const auto path = directory / std::format("grid{}.txt", side);
+        WriteGridMesh(path, side);
+        meshes.emplace_back("grid", path);
+    }
+    if (std::filesystem::exists(context.options.duckMesh))
+    {
+        meshes.emplace_back("duck", context.options.duckMesh);
+    }
+    else
+    {
+        std::println(stderr, "{} not found, skipping the duck mesh", context.options.duckMesh.string());
+    }
+
+    for (const auto& [name, path] : meshes)
+    {
+        const auto mesh      = LoadMeshData(path);
+        const auto vertices  = static_cast<int>(mesh.vertices.size());
+        const auto triangles = static_cast<double>(mesh.indices.size() / 3);
+        if (context.Enabled("mesh_load"))
+        {
+            const auto fileBytes = static_cast<double>(std::filesystem::file_size(path));
+            auto samples         = bench::Sample(context.sampling, [&]() { LoadMeshData(path); });
+            context.Add("mesh_load", name, vertices, "vertex", vertices, fileBytes / vertices, std::move(samples));
+            samples = bench::Sample(context.sampling, [&]() { LoadMeshDataIostream(path); });
+            context.Add("mesh_load", name + "_iostream", vertices, "vertex", vertices, fileBytes / vertices,
+                        std::move(samples));
+        }
+        if (context.Enabled("mesh_load_binary"))
+        {
+            const auto meshPath = directory / path.filename().replace_extension(MESH_FILE_EXTENSION);
+            WriteMeshFile(meshPath, mesh);
+            const auto fileBytes = static_cast<double>(std::filesystem::file_size(meshPath));
+            auto samples         = bench::Sample(context.sampling, [&]() { MappedMeshFile(meshPath).ToMeshData(); });
+            context.Add("mesh_load_binary", name, vertices, "vertex", vertices, fileBytes / vertices,
+                        std::move(samples));
+        }
+        if (context.Enabled("mesh_adjacency"))
+        {
+            const auto adjacency = [&]() { TriangleListAdjacency(mesh.vertices, mesh.indices); };
+            auto samples         = bench::Sample(context.sampling, adjacency);
+            context.Add("mesh_adjacency", name, vertices, "triangle", triangles, ADJACENCY_BYTES_PER_TRI,
+                        std::move(samples));
+        }
+        if (context.Enabled("mesh_optimize"))
+        {
+            // Every sample optimizes a fresh copy in file order, the copy is timed along
+            for (const auto overdraw : {false, true})
+            {
+                const auto variant = overdraw ? name + "_overdraw" : name;
+                auto optimized     = mesh;
+                const auto report  = OptimizeMesh(optimized.vertices, optimized.indices, overdraw);
+                std::println(stderr, "mesh_optimize {} {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", variant,
+                             vertices, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+
+                const auto optimize = [&]()
+                {
+                    optimized = mesh;
+                    OptimizeMesh(optimized.vertices, optimized.indices, overdraw);
+                };
+                auto samples = bench::Sample(context.sampling, optimize);
+                context.Add("mesh_optimize", variant, vertices, "triangle", triangles, 0.0, std::move(samples));
+            }
+        }
+    }
+}
+
+void PrintUsage()
+{
+    std::println(stderr, "usage: duckBench [--quick] [--filter <kernel>] [--output <file.json>] [--label <text>] "
+                         "[--duck-mesh <file>]");
+    std::println(stderr, "       duckBench --replay <recording> [--replay-hashes <file>]");
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        const auto hasValue        = i + 1 < argc;
+        if (arg == "--quick")
+        {
+            options.quick = true;
+        }
+        else if (arg == "--filter" && hasValue)
+        {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            options.output = argv[++i];
+        }
+        else if (arg == "--label" && hasValue)
+        {
+            options.label = argv[++i];
+        }
+        else if (arg == "--duck-mesh" && hasValue)
+        {
+            options.duckMesh = argv[++i];
+        }
+        else if (arg == "--replay" && hasValue)
+        {
+            options.replay = argv[++i];
+        }
+        else if (arg == "--replay-hashes" && hasValue)
+        {
+            options.replayHashes = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return options.replayHashes.empty() || !options.replay.empty();
+}
+} // namespace
+
+// Headless benchmarks of the CPU side of the demo. Progress goes to stderr, the JSON report to stdout or --output.
+// With --replay the recording is replayed with the scalar and the detected SIMD kernels instead, as by the --replay of
+// the demo, and the exit status is 1 if their hashes differ.
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+    if (!options.replay.empty())
+    {
+        return benchmarks::RunReplay(options.replay, options.replayHashes) ? 0 : 1;
+    }
+
+    bench::Report report(options.label, kernels::ToString(kernels::DetectSimdLevel()),
+                         ThreadPool::Shared().ThreadCount());
+    Context context{options, {}, report};
+    if (options.quick)
+    {
+        context.sampling.maxSamples    = 20;
+        context.sampling.budgetSeconds = 0.1;
+    }
+
+    const std::array<std::pair<const char*, void (*)(const Context&)>, 18> benchmarks = {{
+        {"stencil_row", RunStencilRow},
+        {"normal_row", RunNormalRow},
+        {"bc5_encode", RunBc5Encode},
+        {"float_to_half", RunFloatToHalf},
+        {"water_step", RunWaterStep},
+        {"water_substeps", RunWaterSubsteps},
+        {"water_temporal", RunWaterTemporal},
+        {"surface_texture", RunSurfaceTexture},
+        {"shallow_water_step", RunShallowWaterStep},
+        {"shallow_water_query", RunShallowWaterQuery},
+        {"ocean_frame", RunOceanFrame},
+        {"ocean_fft", RunOceanFft},
+        {"duck_step", RunDuckStep},
+        {"flock_update", RunFlockUpdate},
+        {"arc_length_lookup", RunArcLengthLookup},
+        {"arc_length_build", RunArcLengthBuild},
+        {"scheduled_frame", RunScheduledFrame},
+        {"mesh", RunMeshes},
+    }};
+    for (const auto& [name, run] : benchmarks)
+    {
+        // The mesh kernels share their inputs and are filtered one by one
+        if (name == std::string_view("mesh") || context.Enabled(name))
+        {
+            run(context);
+        }
+    }
+
+    const auto json = report.ToJson();
+    if (options.output.empty())
+    {
+        std::print("{}", json);
+        return 0;
+    }
+    std::ofstream output(options.output);
+    output << json;
+    if (!output)
+    {
+        std::println(stderr, "cannot write {}", options.output.string());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "pch.h"
+
+#include "dirtyRegions.h"
+#include "testing.h"
+
+using namespace mini;
+
+namespace
+{
+constexpr int IMAGE_SIZE = 100;
+
+// Empty regions of a IMAGE_SIZE x IMAGE_SIZE image
+DirtyRegions CleanRegions()
+{
+    DirtyRegions regions;
+    regions.Reset(IMAGE_SIZE, IMAGE_SIZE);
+    regions.Clear();
+    return regions;
+}
+
+bool Equal(const DirtyRect& a, const DirtyRect& b)
+{
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+} // namespace
+
+TEST(DirtyRegionsResetMarksAll)
+{
+    DirtyRegions regions;
+    regions.Reset(IMAGE_SIZE, IMAGE_SIZE);
+    CHECK(regions.FullUpload());
+    CHECK(regions.DirtyArea() == IMAGE_SIZE * IMAGE_SIZE);
+
+    // Nothing is collected until the next upload clears the regions
+    regions.Add({0, 0, 10, 10});
+    CHECK(regions.Rects().empty());
+    regions.Clear();
+    CHECK(regions.Empty());
+    CHECK(!regions.FullUpload());
+}
+
+TEST(DirtyRegionsClipsToImage)
+{
+    auto regions = CleanRegions();
+    regions.Add({-5, 90, 10, 120});
+    regions.Add({IMAGE_SIZE, 0, IMAGE_SIZE + 10, 10});
+    CHECK(regions.Rects().size() == 1);
+    CHECK(Equal(regions.Rects().front(), {0, 90, 10, IMAGE_SIZE}));
+}
+
+TEST(DirtyRegionsMergesOverlapping)
+{
+    auto regions = CleanRegions();
+    regions.Add({0, 0, 20, 20});
+    regions.Add({10, 10, 30, 30});
+    CHECK(regions.Rects().size() == 1);
+    CHECK(Equal(regions.Rects().front(), {0, 0, 30, 30}));
+}
+
+TEST(DirtyRegionsMergesSharedEdges)
+{
+    auto regions = CleanRegions();
+    regions.Add({0, 0, 20, 10});
+    regions.Add({0, 10, 20, 20});
+    regions.Add({20, 5, 30, 15});
+    CHECK(regions.Rects().size() == 1);
+    CHECK(Equal(regions.Rects().front(), {0, 0, 30, 20}));
+}
+
+TEST(DirtyRegionsKeepsCornersApart)
+{
+    auto regions = CleanRegions();
+    regions.Add({0, 0, 10, 10});
+    regions.Add({10, 10, 20, 20});
+    regions.Add({20, 0, 30, 10});
+    CHECK(regions.Rects().size() == 3);
+    CHECK(regions.DirtyArea() == 300);
+}
+
+// A union grown by a merge is checked against the remaining rectangles again
+TEST(DirtyRegionsMergesChains)
+{
+    auto regions = CleanRegions();
+    regions.Add({0, 0, 10, 10});
+    regions.Add({30, 0, 40, 10});
+    regions.Add({50, 0, 60, 10});
+    regions.Add({5, 5, 35, 8});
+    CHECK(regions.Rects().size() == 2);
+    CHECK(regions.DirtyArea() == 400 + 100);
+}
+
+TEST(DirtyRegionsMergesCheapestPairs)
+{
+    auto regions = CleanRegions();
+    regions.SetMaxRects(2);
+    regions.Add({0, 0, 10, 10});
+    regions.Add({80, 80, 90, 90});
+    regions.Add({0, 12, 10, 22});
+    CHECK(regions.Rects().size() == 2);
+    CHECK(Equal(regions.Rects().back(), {0, 0, 10, 22}));
+}
+
+TEST(DirtyRegionsFullUploadAboveThreshold)
+{
+    auto regions = CleanRegions();
+    regions.Add({0, 0, IMAGE_SIZE / 2, IMAGE_SIZE});
+    CHECK(!regions.FullUpload());
+    regions.Add({IMAGE_SIZE / 2 + 1, 0, IMAGE_SIZE / 2 + 2, 1});
+    CHECK(regions.FullUpload());
+
+    regions.SetFullUploadAreaFactor(0.75);
+    CHECK(!regions.FullUpload());
+}
@@ -0,0 +1,47 @@
+#include "pch.h"
+
+#include "testing.h"
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+int g_failures = 0;
+} // namespace
+
+std::vector<mini::test::TestCase>& mini::test::Registry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void mini::test::Fail(const char* file, int line, const char* expression)
+{
+    std::println(stderr, "{}({}): check failed: {}", file, line, expression);
+    g_failures++;
+}
+
+// Runs every test, or those whose name contains the first argument. Exits with 1 if a check failed.
+int main(int argc, char* argv[])
+{
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+    auto run                      = 0;
+    auto failed                   = 0;
+    for (const auto& [name, fn] : mini::test::Registry())
+    {
+        if (std::string_view(name).find(filter) == std::string_view::npos)
+        {
+            continue;
+        }
+        const auto failuresBefore = g_failures;
+        fn();
+        run++;
+        if (g_failures != failuresBefore)
+        {
+            std::println(stderr, "FAILED {}", name);
+            failed++;
+        }
+    }
+    std::println(stderr, "{} of {} tests passed", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include "pch.h"
+
+#include "meshData.h"
+#include "meshFile.h"
+#include "testing.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace mini;
+
+namespace
+{
+// Vertex lines parsed by a task of LoadMeshData, VERTEX_CHUNK of meshData.cpp
+constexpr int PARSED_VERTEX_CHUNK = 8192;
+
+constexpr std::string_view VERTEX_LINE = "0.5 0 -0.5 0 1 0 0.25 1\n";
+
+// A strip of vertexCount vertices on a line, triangle i uses vertices i, i+1 and i+2
+MeshData StripMesh(unsigned int vertexCount)
+{
+    MeshData mesh;
+    mesh.vertices.resize(vertexCount);
+    for (auto i = 0U; i < vertexCount; i++)
+    {
+        const auto x     = static_cast<float>(i);
+        mesh.vertices[i] = {{x, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {x, 0.f}};
+    }
+    for (auto i = 0U; i + 2 < vertexCount; i++)
+    {
+        mesh.indices.insert(mesh.indices.end(), {i, i + 1, i + 2});
+    }
+    return mesh;
+}
+
+bool SameMesh(const MeshData& left, const MeshData& right)
+{
+    return left.indices == right.indices && left.vertices.size() == right.vertices.size() &&
+           std::memcmp(left.vertices.data(), right.vertices.data(), left.vertices.size() * sizeof(MeshVertex)) == 0;
+}
+
+// Writes the mesh, maps it back and checks its index format and contents
+void CheckRoundTrip(const MeshData& mesh, IndexFormat expectedFormat)
+{
+    const auto path = std::filesystem::temp_directory_path() / "duckTests.mesh";
+    WriteMeshFile(path, mesh);
+    {
+        const MappedMeshFile file(path);
+        CHECK(file.IndicesFormat() == expectedFormat);
+        CHECK(file.IndexBytes().size() == mesh.indices.size() * IndexSize(expectedFormat));
+        CHECK(SameMesh(file.ToMeshData(), mesh));
+    }
+    std::filesystem::remove(path);
+}
+// Text mesh of vertexCount copies of VERTEX_LINE, the one at badVertex replaced by badLine, and the indices
+std::string TextMesh(int vertexCount, int badVertex, std::string_view badLine, std::string_view indices)
+{
+    auto text = std::to_string(vertexCount) + "\n";
+    for (auto i = 0; i < vertexCount; i++)
+    {
+        text += i == badVertex ? badLine : VERTEX_LINE;
+    }
+    return text += indices;
+}
+
+// Line of the MeshParseError LoadMeshData throws on the text, 0 if it loads
+int ParseErrorLine(std::string_view text)
+{
+    const auto path = std::filesystem::temp_directory_path() / "duckTests.txt";
+    std::ofstream(path, std::ios::binary) << text;
+    auto line = 0;
+    try
+    {
+        LoadMeshData(path);
+    }
+    catch (const MeshParseError& error)
+    {
+        line = error.Line();
+    }
+    std::filesystem::remove(path);
+    return line;
+}
+} // namespace
+
+TEST(SelectIndexFormatSwitchesAbove16Bits)
+{
+    CHECK(SelectIndexFormat(0) == IndexFormat::UInt16);
+    CHECK(SelectIndexFormat(MAX_16BIT_VERTICES) == IndexFormat::UInt16);
+    CHECK(SelectIndexFormat(MAX_16BIT_VERTICES + 1) == IndexFormat::UInt32);
+    CHECK(IndexSize(IndexFormat::UInt16) == 2);
+    CHECK(IndexSize(IndexFormat::UInt32) == 4);
+}
+
+TEST(NarrowIndicesKeepsValues)
+{
+    const std::vector<unsigned int> indices{0, 1, 65535};
+    const std::vector<unsigned short> expected{0, 1, 65535};
+    CHECK(NarrowIndices(indices) == expected);
+}
+
+TEST(NarrowIndicesThrowsAbove16Bits)
+{
+    const std::vector<unsigned int> indices{0, 65536, 1};
+    CHECK_THROWS(std::out_of_range, NarrowIndices(indices));
+}
+
+TEST(IndicesInRangeRejectsVertexCount)
+{
+    const std::vector<unsigned int> indices{0, 1, 2};
+    CHECK(IndicesInRange(indices, 3));
+    CHECK(!IndicesInRange(indices, 2));
+    CHECK(IndicesInRange({}, 0));
+}
+
+TEST(MeshFileRoundTrips16BitIndices)
+{
+    CheckRoundTrip(StripMesh(100), IndexFormat::UInt16);
+}
+
+TEST(MeshFileRoundTrips32BitIndices)
+{
+    CheckRoundTrip(StripMesh(MAX_16BIT_VERTICES + 1), IndexFormat::UInt32);
+}
+
+TEST(LoadMeshDataReadsTextMesh)
+{
+    CHECK(ParseErrorLine(TextMesh(3, -1, {}, "1\n0 1 2\n")) == 0);
+    CHECK(ParseErrorLine(TextMesh(3, -1, {}, "1 0\n1\n2")) == 0);
+}
+
+// The lines are counted from 1, the vertex count is on line 1 and vertex i on line i + 2
+TEST(LoadMeshDataReportsErrorLine)
+{
+    CHECK(ParseErrorLine(TextMesh(3, 1, "0.5 0 -0.5 0 1 0 0.25\n", "1\n0 1 2\n")) == 3);
+    CHECK(ParseErrorLine(TextMesh(3, 0, "0.5 0 -0.5 0 1 0 0.25 1 7\n", "1\n0 1 2\n")) == 2);
+    CHECK(ParseErrorLine(TextMesh(3, -1, {}, "2\n0 1 2\n2 1 3\n")) == 7);
+    // Truncated in the vertices and in the triangles
+    CHECK(ParseErrorLine(TextMesh(3, -1, {}, {}).substr(0, 2 + 2 * VERTEX_LINE.size())) == 4);
+    CHECK(ParseErrorLine(TextMesh(3, -1, {}, "2\n0 1 2\n2 1")) == 7);
+}
+
+// The chunks are parsed in parallel, the line of an error past the first one still counts the lines of the others
+TEST(LoadMeshDataReportsErrorLineOfLaterChunk)
+{
+    constexpr auto badVertex = PARSED_VERTEX_CHUNK + 5;
+    const auto text = TextMesh(PARSED_VERTEX_CHUNK + 10, badVertex, "0.5 0 -0.5 0 1 x 0.25 1\n", "1\n0 1 2\n");
+    CHECK(ParseErrorLine(text) == badVertex + 2);
+}
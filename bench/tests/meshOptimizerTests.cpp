@@ -0,0 +1,188 @@
+#include "pch.h"
+
+#include "meshData.h"
+#include "meshOptimizer.h"
+#include "testing.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+using namespace mini;
+
+namespace
+{
+constexpr unsigned int GRID_SIDE = 64;
+
+using Triangle = std::array<unsigned int, 3>;
+
+// A side x side grid of vertices in the plane z = 0, row after row, with two triangles per quad
+MeshData GridMesh(unsigned int side)
+{
+    MeshData mesh;
+    for (auto y = 0U; y < side; y++)
+    {
+        for (auto x = 0U; x < side; x++)
+        {
+            const auto u = static_cast<float>(x), v = static_cast<float>(y);
+            mesh.vertices.push_back({{u, v, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}, {u, v}});
+        }
+    }
+    for (auto y = 0U; y + 1 < side; y++)
+    {
+        for (auto x = 0U; x + 1 < side; x++)
+        {
+            const auto v = y * side + x;
+            mesh.indices.insert(mesh.indices.end(), {v, v + 1, v + side, v + 1, v + side + 1, v + side});
+        }
+    }
+    return mesh;
+}
+
+// The grid with its triangles in random order, each starting at a random corner
+MeshData ShuffledGridMesh(unsigned int side)
+{
+    auto mesh = GridMesh(side);
+    std::mt19937 generator(side);
+    std::vector<Triangle> triangles(mesh.indices.size() / 3);
+    for (std::size_t t = 0; t < triangles.size(); t++)
+    {
+        std::copy_n(mesh.indices.begin() + t * 3, 3, triangles[t].begin());
+    }
+    std::ranges::shuffle(triangles, generator);
+    mesh.indices.clear();
+    for (auto triangle : triangles)
+    {
+        std::ranges::rotate(triangle, triangle.begin() + generator() % 3);
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    }
+    return mesh;
+}
+
+// The triangles of an index list, each rotated to start at its smallest index, so that the order of the triangles and
+// their first corner do not matter but their winding does
+std::vector<Triangle> Triangles(std::span<const unsigned int> indices)
+{
+    std::vector<Triangle> triangles;
+    for (std::size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        Triangle triangle{indices[t], indices[t + 1], indices[t + 2]};
+        std::ranges::rotate(triangle, std::ranges::min_element(triangle));
+        triangles.push_back(triangle);
+    }
+    std::ranges::sort(triangles);
+    return triangles;
+}
+
+// The triangles of a mesh by the positions of their corners, so that meshes with renumbered vertices compare
+std::vector<std::array<float, 9>> TrianglePositions(const MeshData& mesh)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (std::size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+    {
+        std::array<DirectX::XMFLOAT3, 3> corners;
+        for (auto k = 0; k < 3; k++)
+        {
+            corners[k] = mesh.vertices[mesh.indices[t + k]].position;
+        }
+        const auto first = std::ranges::min_element(corners, [](const auto& a, const auto& b)
+                                                    { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); });
+        std::ranges::rotate(corners, first);
+        triangles.push_back({corners[0].x, corners[0].y, corners[0].z, corners[1].x, corners[1].y, corners[1].z,
+                             corners[2].x, corners[2].y, corners[2].z});
+    }
+    std::ranges::sort(triangles);
+    return triangles;
+}
+
+// Every index is either a vertex used before or the next new one
+bool InFirstUseOrder(std::span<const unsigned int> indices)
+{
+    auto next = 0U;
+    for (const auto v : indices)
+    {
+        if (v > next)
+        {
+            return false;
+        }
+        next += v == next ? 1 : 0;
+    }
+    return true;
+}
+} // namespace
+
+// The cache and the overdraw orders only reorder the triangles and rotate their corners
+TEST(OptimizersKeepTrianglesAndWinding)
+{
+    for (const auto& mesh : {GridMesh(GRID_SIDE), ShuffledGridMesh(GRID_SIDE)})
+    {
+        auto indices = mesh.indices;
+        OptimizeVertexCache(indices, mesh.vertices.size());
+        CHECK(Triangles(indices) == Triangles(mesh.indices));
+        OptimizeOverdraw(std::span<unsigned int>(indices), mesh.vertices);
+        CHECK(Triangles(indices) == Triangles(mesh.indices));
+    }
+}
+
+TEST(VertexFetchNumbersVerticesInFirstUseOrder)
+{
+    // A vertex no triangle uses, in the middle of the vertex buffer
+    auto mesh         = ShuffledGridMesh(GRID_SIDE);
+    const auto unused = static_cast<unsigned int>(mesh.vertices.size() / 2);
+    const MeshVertex vertex{{-1.f, -1.f, -1.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f}};
+    mesh.vertices.insert(mesh.vertices.begin() + unused, vertex);
+    for (auto& v : mesh.indices)
+    {
+        v += v >= unused ? 1 : 0;
+    }
+
+    auto optimized = mesh;
+    OptimizeVertexFetch(optimized.vertices, optimized.indices);
+    CHECK(optimized.vertices.size() == mesh.vertices.size() - 1);
+    CHECK(InFirstUseOrder(optimized.indices));
+    CHECK(std::ranges::none_of(optimized.vertices, [](const MeshVertex& v) { return v.position.x < 0.f; }));
+    CHECK(TrianglePositions(optimized) == TrianglePositions(mesh));
+
+    auto indices     = mesh.indices;
+    const auto remap = OptimizeVertexFetchRemap(indices, mesh.vertices.size());
+    CHECK(remap[unused] == UNUSED_VERTEX);
+    CHECK(remap[mesh.indices[0]] == 0 && indices == optimized.indices);
+}
+
+TEST(OptimizeMeshDoesNotRaiseAcmr)
+{
+    for (const auto overdraw : {false, true})
+    {
+        for (auto mesh : {GridMesh(GRID_SIDE), ShuffledGridMesh(GRID_SIDE)})
+        {
+            const auto triangles = TrianglePositions(mesh);
+            const auto report    = OptimizeMesh(mesh.vertices, mesh.indices, overdraw);
+            CHECK(report.after.acmr <= report.before.acmr);
+            CHECK(report.after.acmr == AnalyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr);
+            CHECK(TrianglePositions(mesh) == triangles);
+        }
+    }
+}
+
+// Triangles with a repeated vertex are kept as they are, and a mesh of nothing else or of no triangles at all passes
+TEST(OptimizersHandleDegenerateTriangles)
+{
+    auto mesh = GridMesh(4);
+    mesh.indices.insert(mesh.indices.end(), {5, 5, 6, 9, 10, 9, 3, 3, 3});
+    std::vector<MeshData> meshes{mesh, GridMesh(4), MeshData{GridMesh(4).vertices, {}}};
+    meshes[1].indices = {0, 0, 1, 2, 2, 2, 7, 1, 1};
+
+    for (auto& degenerate : meshes)
+    {
+        const auto indices = degenerate.indices;
+        auto optimized     = indices;
+        OptimizeVertexCache(optimized, degenerate.vertices.size());
+        CHECK(Triangles(optimized) == Triangles(indices));
+        OptimizeOverdraw(std::span<unsigned int>(optimized), degenerate.vertices);
+        CHECK(Triangles(optimized) == Triangles(indices));
+
+        const auto triangles = TrianglePositions(degenerate);
+        OptimizeMesh(degenerate.vertices, degenerate.indices, true);
+        CHECK(TrianglePositions(degenerate) == triangles);
+        CHECK(InFirstUseOrder(degenerate.indices));
+    }
+}
@@ -0,0 +1,220 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "normalMapEncoding.h"
+#include "testing.h"
+#include "waterSurfaceKernels.h"
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using namespace mini::gk2;
+
+namespace
+{
+// Not a multiple of the SIMD widths, so that the tails of the kernels are covered
+constexpr int NORMAL_MAP_SIZE = 67;
+
+// Normal map of a rippled n x n surface with texelSize bytes per texel
+std::vector<std::uint8_t> RippledNormals(kernels::NormalRowFn normalRow, int n, std::size_t texelSize)
+{
+    const auto heights = bench::RippledSurface(n, n, n);
+    std::vector<std::uint8_t> texels(texelSize * n * n);
+    bench::EncodeNormals(normalRow, heights.data() + n, n, texelSize, texels.data());
+    return texels;
+}
+
+// Whole BC5 image of an n x n RG8 image decoded back by the reference decoder
+std::vector<std::uint8_t> RoundTripBC5(const std::vector<std::uint8_t>& rg, int n)
+{
+    std::vector<std::uint8_t> bc5(normalEncoding::EncodedSize(NormalMapEncoding::BC5, n, n));
+    normalEncoding::EncodeBC5(rg.data(), n, n, bc5.data());
+
+    const auto rowPitch = normalEncoding::RowPitch(NormalMapEncoding::RG8, n);
+    std::vector<std::uint8_t> decoded(rg.size());
+    for (auto y = 0; y < n; y += normalEncoding::BC_BLOCK_SIZE)
+    {
+        for (auto x = 0; x < n; x += normalEncoding::BC_BLOCK_SIZE)
+        {
+            normalEncoding::DecodeBC5Block(bc5.data() + normalEncoding::Offset(NormalMapEncoding::BC5, n, x, y),
+                                           decoded.data() + normalEncoding::Offset(NormalMapEncoding::RG8, n, x, y),
+                                           rowPitch);
+        }
+    }
+    return decoded;
+}
+
+// A sweep over the float bit patterns and the rounding corner cases: ties around 1, largest half, overflow, smallest
+// subnormal and its half, smallest normal and the largest subnormal
+std::vector<float> HalfConversionInputs()
+{
+    constexpr std::uint32_t STEP = 4099; // odd, so both mantissa parities are covered
+    std::vector<float> values;
+    for (std::uint64_t bits = 0; bits <= 0xFFFFFFFFull; bits += STEP)
+    {
+        values.push_back(std::bit_cast<float>(static_cast<std::uint32_t>(bits)));
+    }
+    for (const auto value : {1.f + 1.f / 2048.f, 1.f + 3.f / 2048.f, 65504.f, 65519.f, 65520.f, 0x1p-24f, 0x1p-25f,
+                             0x1.8p-25f, 0x1p-14f, 0x1.ffcp-15f})
+    {
+        values.push_back(value);
+        values.push_back(-value);
+    }
+    return values;
+}
+
+bool SameFloat(float a, float b)
+{
+    return std::bit_cast<std::uint32_t>(a) == std::bit_cast<std::uint32_t>(b) || (std::isnan(a) && std::isnan(b));
+}
+} // namespace
+
+// The two channel kernels have to produce exactly the x and z of the four channel ones at every level
+TEST(RG8NormalsMatchRGBA8)
+{
+    for (const auto level : bench::SimdLevels())
+    {
+        const auto rgba = RippledNormals(kernels::SelectNormalRow(level, NormalMapEncoding::RGBA8), NORMAL_MAP_SIZE, 4);
+        const auto rg   = RippledNormals(kernels::SelectNormalRow(level, NormalMapEncoding::RG8), NORMAL_MAP_SIZE, 2);
+        auto mismatches = 0;
+        for (std::size_t t = 0; t < rg.size() / 2; t++)
+        {
+            mismatches += rg[2 * t] != rgba[4 * t] || rg[2 * t + 1] != rgba[4 * t + 2];
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+TEST(BC5DecodesWithinMaxError)
+{
+    const auto n       = NORMAL_MAP_SIZE / normalEncoding::BC_BLOCK_SIZE * normalEncoding::BC_BLOCK_SIZE;
+    const auto rg      = RippledNormals(kernels::NormalRowRGScalar, n, 2);
+    const auto decoded = RoundTripBC5(rg, n);
+    auto maxError      = 0;
+    for (std::size_t k = 0; k < rg.size(); k++)
+    {
+        maxError = std::max(maxError, std::abs(static_cast<int>(rg[k]) - static_cast<int>(decoded[k])));
+    }
+    CHECK(maxError <= normalEncoding::BC5_MAX_ERROR);
+}
+
+// A block of a single value has to survive exactly
+TEST(BC5KeepsFlatBlocks)
+{
+    constexpr auto rowPitch = 2 * normalEncoding::BC_BLOCK_SIZE;
+    for (const auto value : {0, 1, 128, 254, 255})
+    {
+        std::array<std::uint8_t, 2 * 16> flat;
+        flat.fill(static_cast<std::uint8_t>(value));
+        std::array<std::uint8_t, normalEncoding::BC5_BLOCK_BYTES> block;
+        std::array<std::uint8_t, 2 * 16> decoded;
+        normalEncoding::EncodeBC5Block(flat.data(), rowPitch, block.data());
+        normalEncoding::DecodeBC5Block(block.data(), decoded.data(), rowPitch);
+        CHECK(flat == decoded);
+    }
+}
+
+// BC5 falls back to RG8 for maps without whole blocks, the others fit any size
+TEST(EncodingsResolveAndParse)
+{
+    for (const auto encoding : NORMAL_MAP_ENCODINGS)
+    {
+        const auto expected = encoding == NormalMapEncoding::BC5 ? NormalMapEncoding::RG8 : encoding;
+        auto parsed         = NormalMapEncoding::RGBA8;
+        const auto name     = std::string_view(ToString(encoding));
+        CHECK(normalEncoding::Resolve(encoding, 256, 256) == encoding);
+        CHECK(normalEncoding::Resolve(encoding, 250, 256) == expected);
+        CHECK(TryParse(std::wstring(name.begin(), name.end()), parsed) && parsed == encoding);
+    }
+    auto parsed = NormalMapEncoding::RGBA8;
+    CHECK(!TryParse(L"bc7", parsed));
+}
+
+TEST(FloatToHalfRoundsToNearestEven)
+{
+    using normalEncoding::FloatToHalf;
+    CHECK(FloatToHalf(1.f) == 0x3C00);
+    CHECK(FloatToHalf(-2.f) == 0xC000);
+    CHECK(FloatToHalf(-0.f) == 0x8000);
+    CHECK(FloatToHalf(1.f + 1.f / 2048.f) == 0x3C00); // tie, down to the even mantissa
+    CHECK(FloatToHalf(1.f + 3.f / 2048.f) == 0x3C02); // tie, up to the even mantissa
+    CHECK(FloatToHalf(65504.f) == 0x7BFF);
+    CHECK(FloatToHalf(65519.f) == 0x7BFF);
+    CHECK(FloatToHalf(65520.f) == 0x7C00); // rounds to infinity
+    CHECK(FloatToHalf(INFINITY) == 0x7C00);
+    CHECK(FloatToHalf(0x1p-24f) == 0x0001);
+    CHECK(FloatToHalf(0x1p-25f) == 0x0000);
+    CHECK(FloatToHalf(0x1.8p-25f) == 0x0001);
+    CHECK(FloatToHalf(0x1p-14f) == 0x0400);
+    const auto nan = FloatToHalf(NAN);
+    CHECK((nan & 0x7C00) == 0x7C00 && (nan & 0x03FF) != 0);
+}
+
+// Every half but the NaNs converts to a float and back to itself, and the normal range keeps 11 bits of precision
+TEST(HalfFloatRoundTrips)
+{
+    auto failures = 0;
+    for (auto bits = 0; bits <= 0xFFFF; bits++)
+    {
+        const auto half  = static_cast<std::uint16_t>(bits);
+        const auto value = normalEncoding::HalfToFloat(half);
+        failures += !std::isnan(value) && normalEncoding::FloatToHalf(value) != half;
+    }
+    CHECK(failures == 0);
+
+    failures = 0;
+    for (const auto value : HalfConversionInputs())
+    {
+        if (std::abs(value) >= 0x1p-14f && std::abs(value) <= 65504.f)
+        {
+            const auto roundTrip = normalEncoding::HalfToFloat(normalEncoding::FloatToHalf(value));
+            failures += std::abs(roundTrip - value) > std::abs(value) * 0x1p-11f;
+        }
+    }
+    CHECK(failures == 0);
+}
+
+// The row kernels, F16C where the CPU has it, match the scalar conversions bit by bit
+TEST(HalfFloatRowsMatchScalar)
+{
+    const auto values = HalfConversionInputs();
+    const auto count  = static_cast<int>(values.size());
+    std::vector<std::uint16_t> expected(count);
+    kernels::FloatToHalfRowScalar(values.data(), expected.data(), count);
+
+    std::vector<std::uint16_t> halves(0x10000);
+    std::ranges::generate(halves, [half = 0]() mutable { return static_cast<std::uint16_t>(half++); });
+    for (const auto level : bench::SimdLevels())
+    {
+        std::vector<std::uint16_t> actual(count);
+        kernels::SelectFloatToHalfRow(level)(values.data(), actual.data(), count);
+        CHECK(actual == expected);
+
+        std::vector<float> floats(halves.size());
+        kernels::SelectHalfToFloatRow(level)(halves.data(), floats.data(), static_cast<int>(halves.size()));
+        auto mismatches = 0;
+        for (std::size_t k = 0; k < halves.size(); k++)
+        {
+            mismatches += !SameFloat(floats[k], normalEncoding::HalfToFloat(halves[k]));
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+// The height modes store no normals and fit any size, unlike BC5
+TEST(HeightEncodingsResolve)
+{
+    for (const auto encoding : {NormalMapEncoding::R16F, NormalMapEncoding::R32F})
+    {
+        CHECK(normalEncoding::StoresHeights(encoding));
+        CHECK(normalEncoding::Resolve(encoding, 67, 67) == encoding);
+        CHECK(normalEncoding::Supports(encoding, 67, 67));
+    }
+    for (const auto encoding : {NormalMapEncoding::RGBA8, NormalMapEncoding::RG8, NormalMapEncoding::BC5})
+    {
+        CHECK(!normalEncoding::StoresHeights(encoding));
+    }
+    CHECK(normalEncoding::EncodedSize(NormalMapEncoding::R16F, 64, 64) == 64 * 64 * sizeof(std::uint16_t));
+    CHECK(normalEncoding::EncodedSize(NormalMapEncoding::R32F, 64, 64) == 64 * 64 * sizeof(float));
+}
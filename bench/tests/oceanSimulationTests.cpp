@@ -0,0 +1,122 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "fft.h"
+#include "oceanSimulation.h"
+#include "testing.h"
+#include "threadPool.h"
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <random>
+
+using namespace mini::gk2;
+
+namespace
+{
+// Largest error of the inverse FFT against the direct sum, divided by the number of summed terms
+constexpr double FFT_MAX_ERROR = 1e-6;
+
+struct Grid
+{
+    std::vector<float> re;
+    std::vector<float> im;
+};
+
+// A random complex grid of the size and stride of the transform
+Grid RandomGrid(const InverseFft2D& fft)
+{
+    std::mt19937 generator(fft.Size());
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    Grid grid{std::vector<float>(fft.Size() * static_cast<std::size_t>(fft.Stride())), {}};
+    grid.im.resize(grid.re.size());
+    std::ranges::generate(grid.re, [&]() { return uniform(generator); });
+    std::ranges::generate(grid.im, [&]() { return uniform(generator); });
+    return grid;
+}
+
+Grid Transform(InverseFft2D& fft, kernels::SimdLevel level, Grid grid)
+{
+    fft.SetSimdLevel(level);
+    fft.Transform(grid.re.data(), grid.im.data(), mini::ThreadPool::Shared());
+    return grid;
+}
+
+// Largest difference between the transform of `input` and the direct evaluation of the sum, relative to the number of
+// terms
+double MaxErrorAgainstDft(const Grid& input, const Grid& output, int size, std::size_t stride)
+{
+    auto maxError = 0.0;
+    for (auto y = 0; y < size; y++)
+    {
+        for (auto x = 0; x < size; x++)
+        {
+            std::complex<double> sum;
+            for (auto n = 0; n < size; n++)
+            {
+                for (auto m = 0; m < size; m++)
+                {
+                    const auto angle = 2.0 * std::numbers::pi * ((m * x + n * y) % size) / size;
+                    sum += std::complex<double>(input.re[n * stride + m], input.im[n * stride + m]) *
+                           std::polar(1.0, angle);
+                }
+            }
+            const auto actual = std::complex<double>(output.re[y * stride + x], output.im[y * stride + x]);
+            maxError          = std::max(maxError, std::abs(sum - actual));
+        }
+    }
+    return maxError / (static_cast<double>(size) * size);
+}
+
+// Significant wave height, four times the standard deviation of the heights
+double SignificantHeight(const OceanSimulation& ocean)
+{
+    auto sumSquares = 0.0;
+    const auto heights = bench::Heights(ocean);
+    for (const auto h : heights)
+    {
+        sumSquares += static_cast<double>(h) * h;
+    }
+    return 4.0 * std::sqrt(sumSquares / static_cast<double>(heights.size()));
+}
+} // namespace
+
+// The SIMD butterflies match the scalar ones bit by bit, and both match the direct sum
+TEST(InverseFftMatchesDft)
+{
+    for (auto size = 1; size <= 32; size *= 2)
+    {
+        InverseFft2D fft(size);
+        const auto input     = RandomGrid(fft);
+        const auto reference = Transform(fft, kernels::SimdLevel::Scalar, input);
+        CHECK(MaxErrorAgainstDft(input, reference, size, fft.Stride()) <= FFT_MAX_ERROR);
+        for (const auto level : bench::SimdLevels())
+        {
+            const auto output = Transform(fft, level, input);
+            CHECK(output.re == reference.re && output.im == reference.im);
+        }
+    }
+}
+
+TEST(OceanSpectraRaiseWaves)
+{
+    for (const auto spectrum : {OceanSpectrum::Phillips, OceanSpectrum::Jonswap})
+    {
+        OceanParameters parameters;
+        parameters.spectrum = spectrum;
+        OceanSimulation ocean(OceanSimulation::MIN_SAMPLES * 4, parameters);
+        ocean.Update(0.25);
+        const auto height = SignificantHeight(ocean);
+        CHECK(std::isfinite(height) && height > 0.0);
+    }
+}
+
+// The spectrum is drawn from the seed only
+TEST(OceanIsReproducible)
+{
+    OceanSimulation first(OceanSimulation::MIN_SAMPLES * 4);
+    OceanSimulation second(OceanSimulation::MIN_SAMPLES * 4);
+    first.Update(0.25);
+    second.Update(0.25);
+    CHECK(bench::Heights(first) == bench::Heights(second));
+}
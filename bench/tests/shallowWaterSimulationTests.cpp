@@ -0,0 +1,62 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "shallowWaterSimulation.h"
+#include "testing.h"
+#include <cmath>
+
+using namespace mini::gk2;
+
+namespace
+{
+constexpr int SHALLOW_SAMPLES = 128;
+constexpr int SHALLOW_STEPS   = 200;
+
+// Largest relative change of the volume of the shallow water over a run with a still floating body
+constexpr double MAX_VOLUME_DRIFT = 1e-4;
+
+// Steps the shallow water with a floating body, circling the pool if `withBody`
+void RunSteps(ShallowWaterSimulation& simulation, bool withBody)
+{
+    const auto body   = simulation.AddFloatingBody(0.04f, 0.003f);
+    const auto stepDt = bench::PrepareSingleSteps(simulation);
+    for (auto s = 0; s < SHALLOW_STEPS; s++)
+    {
+        if (withBody)
+        {
+            const auto angle = 0.02f * static_cast<float>(s);
+            simulation.MoveFloatingBody(body, 0.5f + 0.3f * std::cos(angle), 0.5f + 0.3f * std::sin(angle));
+        }
+        simulation.Update(stepDt);
+    }
+}
+} // namespace
+
+TEST(ShallowWaterSimdMatchesScalar)
+{
+    std::vector<float> reference;
+    for (const auto level : bench::SimdLevels())
+    {
+        ShallowWaterSimulation simulation(SHALLOW_SAMPLES);
+        simulation.SetSimdLevel(level);
+        bench::DropGrid(simulation);
+        RunSteps(simulation, true);
+        const auto heights = bench::Heights(simulation);
+        if (reference.empty())
+        {
+            reference = heights;
+        }
+        CHECK(heights == reference);
+    }
+}
+
+// The fluxes move the water between the cells, only the bodies and the drops add or take it
+TEST(ShallowWaterConservesVolume)
+{
+    ShallowWaterSimulation simulation(SHALLOW_SAMPLES);
+    bench::DropGrid(simulation);
+    const auto volume = simulation.Volume();
+    RunSteps(simulation, false);
+    const auto drift = std::abs(simulation.Volume() - volume) / volume;
+    CHECK(drift <= MAX_VOLUME_DRIFT);
+}
@@ -0,0 +1,70 @@
+#include "pch.h"
+
+#include "simulationRecording.h"
+#include "testing.h"
+#include <filesystem>
+
+using namespace mini::gk2;
+
+namespace
+{
+constexpr int REPLAY_FRAMES = 120;
+
+// A short session with drops, a resize and uneven frame times, as the demo records it
+SimulationRecording ShortSession()
+{
+    SimulationRecording recording(1234, 64, false, {-0.5f, -0.5f}, {0.5f, 0.5f});
+    for (auto frame = 0; frame < REPLAY_FRAMES; frame++)
+    {
+        recording.RecordFrame(frame % 3 == 0 ? 1.0 / 30.0 : 1.0 / 60.0);
+        if (frame % 10 == 0)
+        {
+            recording.RecordDrop(0.1f + 0.007f * frame, 0.8f - 0.005f * frame, 1.f);
+        }
+        if (frame == REPLAY_FRAMES / 2)
+        {
+            recording.RecordResize(96);
+        }
+    }
+    return recording;
+}
+
+bool SameHashes(const ReplayResult& a, const ReplayResult& b)
+{
+    return a.frames == b.frames && a.waterHashes == b.waterHashes && a.duckHashes == b.duckHashes;
+}
+} // namespace
+
+TEST(RecordingSaveLoadRoundTrips)
+{
+    const auto recording = ShortSession();
+    const auto path      = std::filesystem::temp_directory_path() / "duckTests.rec";
+    CHECK(recording.Save(path));
+
+    SimulationRecording loaded;
+    CHECK(SimulationRecording::Load(path, loaded));
+    std::filesystem::remove(path);
+    CHECK(loaded.Seed() == recording.Seed() && loaded.WaterSamples() == recording.WaterSamples());
+    CHECK(loaded.Events().size() == recording.Events().size());
+    CHECK(SameHashes(Replay(loaded, kernels::SimdLevel::Scalar), Replay(recording, kernels::SimdLevel::Scalar)));
+}
+
+TEST(RecordingLoadRejectsOtherFiles)
+{
+    const auto path = std::filesystem::temp_directory_path() / "duckTests.rec";
+    std::ofstream(path) << "not a recording";
+    SimulationRecording loaded;
+    CHECK(!SimulationRecording::Load(path, loaded));
+    std::filesystem::remove(path);
+}
+
+// The replays of the same recording are equal step by step, with the scalar and the SIMD kernels alike
+TEST(ReplayIsDeterministic)
+{
+    const auto recording = ShortSession();
+    const auto reference = Replay(recording, kernels::SimdLevel::Scalar);
+    CHECK(reference.frames == REPLAY_FRAMES);
+    CHECK(!reference.waterHashes.empty() && !reference.duckHashes.empty());
+    CHECK(SameHashes(Replay(recording, kernels::SimdLevel::Scalar), reference));
+    CHECK(SameHashes(Replay(recording, kernels::DetectSimdLevel()), reference));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+
+// Minimal test registry of duckTests. TEST(Name) defines and registers a test, CHECK(expression) reports a failed
+// check with its location and lets the test go on, CHECK_THROWS(Exception, expression) checks that the expression
+// throws an Exception.
+namespace mini::test
+{
+using TestFn = void (*)();
+
+struct TestCase
+{
+    const char* name;
+    TestFn fn;
+};
+
+std::vector<TestCase>& Registry();
+
+// Counts the failure of the running test and prints it
+void Fail(const char* file, int line, const char* expression);
+
+struct Registrar
+{
+    Registrar(const char* name, TestFn fn)
+    {
+        Registry().push_back({name, fn});
+    }
+};
+} // namespace mini::test
+
+#define TEST(name)                                                                                                     \
+    static void name();                                                                                                \
+    static const ::mini::test::Registrar name##Registrar(#name, name);                                                 \
+    static void name()
+
+#define CHECK(expression) ((expression) ? void() : ::mini::test::Fail(__FILE__, __LINE__, #expression))
+
+#define CHECK_THROWS(exception, expression)                                                                            \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        auto thrown = false;                                                                                           \
+        try                                                                                                            \
+        {                                                                                                              \
+            (void)(expression);                                                                                        \
+        }                                                                                                              \
+        catch (const exception&)                                                                                       \
+        {                                                                                                              \
+            thrown = true;                                                                                             \
+        }                                                                                                              \
+        if (!thrown)                                                                                                   \
+        {                                                                                                              \
+            ::mini::test::Fail(__FILE__, __LINE__, #expression " throws " #exception);                                 \
+        }                                                                                                              \
+    } while (false)
@@ -0,0 +1,104 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "testing.h"
+#include "waterSurfaceSimulation.h"
+#include <bit>
+#include <cmath>
+
+using namespace mini::gk2;
+
+namespace
+{
+constexpr int STORAGE_SAMPLES        = 256;
+constexpr int STORAGE_STEPS          = 200;
+constexpr std::uint32_t STORAGE_SEED = 1234;
+
+// Largest height difference from the float32 run after STORAGE_STEPS steps, about four times the measured 2.2e-4 of
+// float16 and 3.8e-4 of fixed16. A broken conversion is off by a good part of a drop (DROP_HEIGHT).
+constexpr double FLOAT16_MAX_ERROR = 1e-3;
+constexpr double FIXED16_MAX_ERROR = 1.5e-3;
+
+// Heights after STORAGE_STEPS steps from a grid of drops and the random drops of the seed. Tiles are only skipped at
+// exact rest, so every storage does the same steps regardless of its precision.
+template <typename Storage> std::vector<float> RunStorage()
+{
+    BasicWaterSurfaceSimulation<Storage> simulation(STORAGE_SAMPLES);
+    simulation.Seed(STORAGE_SEED);
+    simulation.SetActivityThreshold(0.f);
+    simulation.GeneretateRandomDrops(true);
+    bench::DropGrid(simulation);
+    simulation.Update((STORAGE_STEPS + 0.5) * simulation.StepTime() / simulation.SimSpeed());
+    return bench::Heights(simulation);
+}
+
+double MaxError(const std::vector<float>& heights, const std::vector<float>& reference)
+{
+    auto maxError = 0.0;
+    for (std::size_t k = 0; k < heights.size(); k++)
+    {
+        // NaN fails the check as well
+        const auto error = std::abs(static_cast<double>(heights[k]) - reference[k]);
+        maxError         = std::isnan(error) ? error : std::max(maxError, error);
+    }
+    return maxError;
+}
+} // namespace
+
+TEST(Float32StorageIsReproducible)
+{
+    CHECK(RunStorage<Float32Storage>() == RunStorage<Float32Storage>());
+}
+
+TEST(CompactStoragesStayCloseToFloat32)
+{
+    const auto reference = RunStorage<Float32Storage>();
+    CHECK(MaxError(RunStorage<Float16Storage>(), reference) <= FLOAT16_MAX_ERROR);
+    CHECK(MaxError(RunStorage<Fixed16Storage>(), reference) <= FIXED16_MAX_ERROR);
+}
+
+// The Load and Store kernels of the compact storages, scalar and of the detected level, match the scalar conversions,
+// including the rounding ties of the fixed point steps and every half float pattern
+TEST(StorageConversionsMatchScalar)
+{
+    constexpr auto scale = Fixed16Storage::SCALE;
+    std::vector<float> values;
+    for (auto step = -70000; step <= 70000; step += 7)
+    {
+        values.push_back(static_cast<float>(step) / scale);
+        values.push_back((static_cast<float>(step) + 0.5f) / scale);
+    }
+    values.push_back(-0.f);
+    const auto count = static_cast<int>(values.size());
+
+    std::vector<std::uint16_t> halves(0x10000);
+    std::ranges::generate(halves, [half = 0]() mutable { return static_cast<std::uint16_t>(half++); });
+
+    for (const auto level : bench::SimdLevels())
+    {
+        const auto fixedKernels = Fixed16Storage::SelectKernels(level);
+        std::vector<std::int16_t> fixed(count);
+        std::vector<float> floats(count);
+        Fixed16Storage::Store(fixedKernels, values.data(), fixed.data(), count);
+        Fixed16Storage::Load(fixedKernels, fixed.data(), floats.data(), count);
+        auto failures = 0;
+        for (auto k = 0; k < count; k++)
+        {
+            failures += fixed[k] != Fixed16Storage::FromFloat(values[k]);
+            failures += floats[k] != Fixed16Storage::ToFloat(fixed[k]);
+        }
+        CHECK(failures == 0);
+
+        floats.resize(halves.size());
+        Float16Storage::Load(Float16Storage::SelectKernels(level), halves.data(), floats.data(),
+                             static_cast<int>(halves.size()));
+        failures = 0;
+        for (std::size_t k = 0; k < halves.size(); k++)
+        {
+            const auto expected = Float16Storage::ToFloat(halves[k]);
+            failures += std::bit_cast<std::uint32_t>(floats[k]) != std::bit_cast<std::uint32_t>(expected) &&
+                        !(std::isnan(floats[k]) && std::isnan(expected));
+        }
+        CHECK(failures == 0);
+    }
+}
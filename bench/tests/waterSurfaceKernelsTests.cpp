@@ -0,0 +1,66 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "testing.h"
+#include "waterSurfaceKernels.h"
+#include "waterSurfaceSimulation.h"
+
+using namespace mini::gk2;
+
+namespace
+{
+constexpr std::array<kernels::SimdLevel, 5> ALL_SIMD_LEVELS = {kernels::SimdLevel::Scalar, kernels::SimdLevel::SSE2,
+                                                               kernels::SimdLevel::AVX2, kernels::SimdLevel::AVX512,
+                                                               kernels::SimdLevel::NEON};
+
+// Widest vector of the kernels, 16 floats of AVX-512
+constexpr int MAX_SIMD_WIDTH = 16;
+
+// Grid width that is no multiple of any vector width, the rows of the stencil end in a scalar tail
+constexpr int ODD_GRID_SAMPLES = 201;
+
+std::vector<float> RunLevel(kernels::SimdLevel level)
+{
+    WaterSurfaceSimulation simulation(ODD_GRID_SAMPLES);
+    simulation.Seed(ODD_GRID_SAMPLES);
+    simulation.SetSimdLevel(level);
+    simulation.SetActivityThreshold(0.f);
+    bench::DropGrid(simulation);
+    simulation.Update(50.5 * simulation.StepTime() / simulation.SimSpeed());
+    return bench::Heights(simulation);
+}
+} // namespace
+
+// Every supported level on rows of every tail length up to two vectors of the widest kernels, and on longer ones
+TEST(StencilRowsMatchScalarAtEveryLevel)
+{
+    for (const auto level : ALL_SIMD_LEVELS)
+    {
+        if (!kernels::IsSupported(level))
+        {
+            continue;
+        }
+        const auto stencilRow = kernels::SelectStencilRow(level);
+        auto failures         = 0;
+        for (auto count = 1; count <= 2 * MAX_SIMD_WIDTH + 1; count++)
+        {
+            failures += kernels::VerifyStencilRow(stencilRow, count) ? 0 : 1;
+        }
+        CHECK(failures == 0);
+        CHECK(kernels::VerifyStencilRow(stencilRow));
+        CHECK(kernels::VerifyStencilRow(stencilRow, ODD_GRID_SAMPLES));
+    }
+}
+
+// The same through the simulation, on a grid whose rows end in a tail at every level
+TEST(WaterSimulationMatchesScalarAtEveryLevel)
+{
+    const auto reference = RunLevel(kernels::SimdLevel::Scalar);
+    for (const auto level : ALL_SIMD_LEVELS)
+    {
+        if (kernels::IsSupported(level))
+        {
+            CHECK(RunLevel(level) == reference);
+        }
+    }
+}
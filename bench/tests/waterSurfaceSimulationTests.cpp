@@ -0,0 +1,39 @@
+#include "pch.h"
+
+#include "benchInputs.h"
+#include "testing.h"
+#include "waterSurfaceSimulation.h"
+
+using namespace mini::gk2;
+
+namespace
+{
+// Heights after updates of the given numbers of steps, from a grid of drops on a fully active surface. Random drops
+// would land at other steps within a block, so there are none.
+std::vector<float> RunUpdates(int samplesCount, bool temporalBlocking, std::initializer_list<int> stepsPerUpdate)
+{
+    WaterSurfaceSimulation simulation(samplesCount);
+    simulation.Seed(1234);
+    simulation.SetActivityThreshold(0.f);
+    simulation.SetTemporalBlocking(temporalBlocking);
+    bench::DropGrid(simulation);
+
+    const auto stepDt = bench::PrepareSingleSteps(simulation);
+    for (const auto steps : stepsPerUpdate)
+    {
+        simulation.Update(steps * stepDt);
+    }
+    return bench::Heights(simulation);
+}
+} // namespace
+
+// Whole blocks, a partial one and single steps, on a grid of whole tiles and on one with a partial tile at the edges
+TEST(TemporalBlockingMatchesStepByStep)
+{
+    constexpr auto block = WaterSurfaceSimulation::TEMPORAL_BLOCK_STEPS;
+    for (const auto n : {256, 200})
+    {
+        const auto updates = {block, block, block + 3, 1, 2 * block};
+        CHECK(RunUpdates(n, true, updates) == RunUpdates(n, false, updates));
+    }
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+
+#include "arcLengthTable.h"
+#include "utils/profiling.h"
+#include <cmath>
+
+namespace
+{
+// Segments sampled together, the cumulative lengths of a batch stay in the cache until they are inverted
+constexpr int BUILD_BATCH = 128;
+} // namespace
+
+mini::gk2::ArcLengthTable mini::gk2::BuildArcLengthTable(const float* x, const float* y)
+{
+    const float* xs[4] = {x, x + 1, x + 2, x + 3};
+    const float* ys[4] = {y, y + 1, y + 2, y + 3};
+    ArcLengthTable table;
+    BuildArcLengthTables(kernels::BSplineRowScalar, xs, ys, &table, 1);
+    return table;
+}
+
+void mini::gk2::BuildArcLengthTables(kernels::BSplineRowFn bsplineRow, const float* const* x, const float* const* y,
+                                     ArcLengthTable* tables, int count)
+{
+    PROFILE_ZONE("BuildArcLengthTables");
+    constexpr auto samples = ArcLengthTable::SAMPLES;
+
+    std::array<float, BUILD_BATCH> t, posX, posY, dirX, dirY, previousX, previousY;
+
+    // Cumulative lengths of the polylines, lengths[s][k] at the parameter s / samples of segment k
+    std::array<std::array<float, BUILD_BATCH>, samples + 1> lengths;
+    for (auto begin = 0; begin < count; begin += BUILD_BATCH)
+    {
+        const auto n = std::min(count - begin, BUILD_BATCH);
+
+        const float* bx[4] = {x[0] + begin, x[1] + begin, x[2] + begin, x[3] + begin};
+        const float* by[4] = {y[0] + begin, y[1] + begin, y[2] + begin, y[3] + begin};
+        for (auto s = 0; s <= samples; s++)
+        {
+            std::fill_n(t.begin(), n, static_cast<float>(s) / static_cast<float>(samples));
+            bsplineRow(bx, by, t.data(), posX.data(), posY.data(), dirX.data(), dirY.data(), n);
+            if (s == 0)
+            {
+                std::fill_n(lengths[0].begin(), n, 0.f);
+            }
+            else
+            {
+                for (auto k = 0; k < n; k++)
+                {
+                    const auto dx = posX[k] - previousX[k];
+                    const auto dy = posY[k] - previousY[k];
+                    lengths[s][k] = lengths[s - 1][k] + std::sqrt(dx * dx + dy * dy);
+                }
+            }
+            std::copy_n(posX.begin(), n, previousX.begin());
+            std::copy_n(posY.begin(), n, previousY.begin());
+        }
+
+        // Inverts the cumulative lengths: walks the polyline once while stepping the distance uniformly
+        for (auto k = 0; k < n; k++)
+        {
+            auto& table  = tables[begin + k];
+            table.length = lengths[samples][k];
+            for (auto i = 0, s = 0; i <= samples; i++)
+            {
+                const auto distance = table.length * static_cast<float>(i) / static_cast<float>(samples);
+                while (s < samples - 1 && lengths[s + 1][k] < distance)
+                {
+                    s++;
+                }
+                const auto span     = lengths[s + 1][k] - lengths[s][k];
+                const auto fraction = span > 0.f ? std::clamp((distance - lengths[s][k]) / span, 0.f, 1.f) : 0.f;
+                table.parameters[i] = (static_cast<float>(s) + fraction) / static_cast<float>(samples);
+            }
+            table.parameters[samples] = 1.f;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "waterSurfaceKernels.h"
+#include <array>
+
+namespace mini::gk2
+{
+// Arc length parameterization of a uniform cubic B-spline segment, as evaluated by kernels::BSplineRowFn. The segment
+// is sampled at SAMPLES + 1 uniform parameters and the polyline through the samples is resampled at uniform distances,
+// so that the parameter at a distance along the segment is a single lookup and lerp instead of a root search.
+struct ArcLengthTable
+{
+    static constexpr int SAMPLES = 32;
+
+    float length = 0.f;                          // of the polyline, slightly shorter than the segment
+    std::array<float, SAMPLES + 1> parameters{}; // parameter at the distance i * length / SAMPLES
+
+    // Parameter at `distance` from the start of the segment, clamped to [0, 1]
+    float ParameterAt(float distance) const
+    {
+        if (!(length > 0.f))
+        {
+            return 0.f;
+        }
+        const auto x = std::clamp(distance / length, 0.f, 1.f) * static_cast<float>(SAMPLES);
+        const auto i = std::min(static_cast<int>(x), SAMPLES - 1);
+        return parameters[i] + (x - static_cast<float>(i)) * (parameters[i + 1] - parameters[i]);
+    }
+};
+
+// Table of the segment with the de Boor points (x[i], y[i]), i = 0..3
+ArcLengthTable BuildArcLengthTable(const float* x, const float* y);
+
+// Tables of `count` segments stored as for kernels::BSplineRowFn. The samples of a batch of segments are evaluated by
+// a single call of `bsplineRow` per parameter, the tables are equal whatever the kernel.
+void BuildArcLengthTables(kernels::BSplineRowFn bsplineRow, const float* const* x, const float* const* y,
+                          ArcLengthTable* tables, int count);
+} // namespace mini::gk2
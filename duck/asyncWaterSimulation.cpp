@@ -0,0 +1,135 @@
+#include "pch.h"
+
+#include "asyncWaterSimulation.h"
+#include "utils/profiling.h"
+#include <chrono>
+
+mini::gk2::AsyncWaterSimulation::AsyncWaterSimulation(WaterSurfaceSimulation& simulation)
+    : m_simulation(simulation), m_publishedFrames(0), m_signal(0), m_stop(false)
+{
+    // The current surface is the first frame, so the texture can be filled before the thread produces anything
+    PublishFrame(0.0);
+    m_thread = std::thread([this]() { Run(); });
+}
+
+mini::gk2::AsyncWaterSimulation::~AsyncWaterSimulation()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+void mini::gk2::AsyncWaterSimulation::Update(double dt)
+{
+    Command command;
+    command.type = Command::Type::Update;
+    command.dt   = dt;
+    Post(command);
+}
+
+void mini::gk2::AsyncWaterSimulation::DropAt(float normalizedX, float normalizedY, float chance)
+{
+    Command command;
+    command.type        = Command::Type::Drop;
+    command.normalizedX = normalizedX;
+    command.normalizedY = normalizedY;
+    command.chance      = chance;
+    Post(command);
+}
+
+void mini::gk2::AsyncWaterSimulation::AddImpulses(std::span<const WaterImpulse> impulses)
+{
+    // One command per impulse keeps the commands small, the simulation still splats them all in its next step
+    for (const auto& impulse : impulses)
+    {
+        Command command;
+        command.type    = Command::Type::Impulse;
+        command.impulse = impulse;
+        Post(command);
+    }
+}
+
+void mini::gk2::AsyncWaterSimulation::Resize(int samplesCount)
+{
+    Command command;
+    command.type         = Command::Type::Resize;
+    command.samplesCount = samplesCount;
+    Post(command);
+}
+
+const mini::gk2::WaterSurfaceFrame* mini::gk2::AsyncWaterSimulation::FetchFrame()
+{
+    return m_frames.Fetch() ? &m_frames.ReadBuffer() : nullptr;
+}
+
+void mini::gk2::AsyncWaterSimulation::Post(const Command& command)
+{
+    // Dropping or merging commands would change the step sequence, so a full queue blocks until the simulation catches
+    // up. With QUEUE_CAPACITY frames of backlog the render thread is out of sync anyway.
+    while (!m_commands.TryPush(command))
+    {
+        std::this_thread::yield();
+    }
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+}
+
+void mini::gk2::AsyncWaterSimulation::Run()
+{
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+        // Read the signal before looking at the queue, a post in between changes it and the wait returns immediately
+        const auto signal = m_signal.load(std::memory_order_acquire);
+
+        Command command;
+        if (!m_commands.TryPop(command))
+        {
+            m_signal.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+        Execute(command);
+    }
+}
+
+void mini::gk2::AsyncWaterSimulation::Execute(const Command& command)
+{
+    switch (command.type)
+    {
+    case Command::Type::Update:
+    {
+        PROFILE_ZONE("AsyncWaterSimulation::Update");
+        const auto start = std::chrono::steady_clock::now();
+        if (m_simulation.Update(command.dt))
+        {
+            PublishFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        break;
+    }
+    case Command::Type::Drop:
+        m_simulation.DropAt(command.normalizedX, command.normalizedY, command.chance);
+        break;
+    case Command::Type::Impulse:
+        m_simulation.AddImpulse(command.impulse);
+        break;
+    case Command::Type::Resize:
+        m_simulation.Resize(command.samplesCount);
+        PublishFrame(0.0);
+        break;
+    }
+}
+
+void mini::gk2::AsyncWaterSimulation::PublishFrame(double simulationMs)
+{
+    PROFILE_ZONE("AsyncWaterSimulation::PublishFrame");
+    auto& frame      = m_frames.WriteBuffer();
+    const auto* data = m_simulation.SurfaceTextureData();
+    frame.encoding   = m_simulation.NormalEncoding();
+    frame.rowPitch   = m_simulation.SurfaceTextureRowPitch();
+    frame.rows       = m_simulation.SurfaceTextureRows();
+    frame.textureData.assign(data, data + static_cast<std::size_t>(frame.rowPitch) * frame.rows);
+    frame.samplesCount = m_simulation.SamplesCount();
+    frame.simulationMs = simulationMs;
+    frame.id           = ++m_publishedFrames;
+    m_frames.Publish();
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "spscQueue.h"
+#include "tripleBuffer.h"
+#include "waterSurfaceSimulation.h"
+#include <thread>
+
+namespace mini::gk2
+{
+// Surface texture contents produced by the simulation thread
+struct WaterSurfaceFrame
+{
+    std::vector<std::uint8_t> textureData; // rows of rowPitch bytes in the given encoding
+    NormalMapEncoding encoding = NormalMapEncoding::RGBA8;
+    unsigned int rowPitch      = 0;
+    int rows                   = 0;
+    int samplesCount           = 0;
+    double simulationMs        = 0.0; // time the simulation spent on the Update() producing the frame
+    unsigned long long id      = 0;   // increases with every published frame
+};
+
+// Runs a WaterSurfaceSimulation on a dedicated thread. The render thread posts the frame times, drops and resizes in
+// order through a lock-free queue, so the simulation executes exactly the same sequence of Update() calls (and thus
+// fixed steps) as it would on the render thread. Finished normal maps come back through a triple buffer, the render
+// thread only ever sees the newest one and never waits for the simulation.
+//
+// The simulation must not be accessed directly while this object exists.
+class AsyncWaterSimulation
+{
+  public:
+    static constexpr std::size_t QUEUE_CAPACITY = 1024;
+
+    explicit AsyncWaterSimulation(WaterSurfaceSimulation& simulation);
+    ~AsyncWaterSimulation();
+
+    AsyncWaterSimulation(const AsyncWaterSimulation&)            = delete;
+    AsyncWaterSimulation& operator=(const AsyncWaterSimulation&) = delete;
+
+    void Update(double dt);
+    void DropAt(float normalizedX, float normalizedY, float chance = 1.f);
+    void AddImpulses(std::span<const WaterImpulse> impulses);
+    void Resize(int samplesCount);
+
+    // Returns the newest frame finished since the last call or nullptr. The frame stays valid until the next call.
+    const WaterSurfaceFrame* FetchFrame();
+
+  private:
+    struct Command
+    {
+        enum class Type
+        {
+            Update,
+            Drop,
+            Impulse,
+            Resize,
+        };
+
+        Type type            = Type::Update;
+        double dt            = 0.0;
+        float normalizedX    = 0.f;
+        float normalizedY    = 0.f;
+        float chance         = 0.f;
+        int samplesCount     = 0;
+        WaterImpulse impulse = {};
+    };
+
+    void Post(const Command& command);
+    void Run();
+    void Execute(const Command& command);
+    void PublishFrame(double simulationMs);
+
+    WaterSurfaceSimulation& m_simulation;
+
+    SpscQueue<Command, QUEUE_CAPACITY> m_commands;
+    TripleBuffer<WaterSurfaceFrame> m_frames;
+    unsigned long long m_publishedFrames;
+
+    std::atomic<unsigned int> m_signal; // bumped after every post, the simulation thread sleeps on it
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+} // namespace mini::gk2
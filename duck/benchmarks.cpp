@@ -0,0 +1,83 @@
+#include "pch.h"
+
+#include "benchmarks.h"
+#include "simulationRecording.h"
+#include "waterSurfaceKernels.h"
+
+using namespace mini::gk2;
+
+namespace
+{
+// Index of the first differing hash, or -1 if the sequences are equal
+int FirstMismatch(const std::vector<std::uint64_t>& expected, const std::vector<std::uint64_t>& actual)
+{
+    const auto [e, a] = std::ranges::mismatch(expected, actual);
+    if (e == expected.end() && a == actual.end())
+    {
+        return -1;
+    }
+    return static_cast<int>(e - expected.begin());
+}
+} // namespace
+
+bool mini::gk2::benchmarks::RunReplay(const std::filesystem::path& recordingPath,
+                                      const std::filesystem::path& hashesPath)
+{
+    SimulationRecording recording;
+    if (!SimulationRecording::Load(recordingPath, recording))
+    {
+        std::println("Cannot load the recording {}", recordingPath.string());
+        return false;
+    }
+    std::println("Replay of {}, seed {}, {} x {} cells, {} events", recordingPath.string(), recording.Seed(),
+                 recording.WaterSamples(), recording.WaterSamples(), recording.Events().size());
+
+    const auto level     = kernels::DetectSimdLevel();
+    const auto reference = Replay(recording, kernels::SimdLevel::Scalar);
+    const auto optimized = Replay(recording, level);
+    std::println("  {} frames, {} water steps, {} duck steps", reference.frames, reference.waterHashes.size(),
+                 reference.duckHashes.size());
+
+    auto passed = true;
+    for (const auto& [name, expected, actual] :
+         {std::tuple{"water", &reference.waterHashes, &optimized.waterHashes},
+          std::tuple{"duck", &reference.duckHashes, &optimized.duckHashes}})
+    {
+        const auto step = FirstMismatch(*expected, *actual);
+        if (step >= 0)
+        {
+            std::println("  FAILED: {} state of {} differs from scalar from step {} on", name, kernels::ToString(level),
+                         step);
+            passed = false;
+        }
+    }
+
+    // Without hashing the replay times the simulations alone
+    for (const auto replayLevel : {kernels::SimdLevel::Scalar, level})
+    {
+        const auto timed = Replay(recording, replayLevel, false);
+        std::println("  {:<8} {:10.3f} ms {:10.3f} ms/frame", kernels::ToString(replayLevel), timed.milliseconds,
+                     timed.milliseconds / std::max(timed.frames, 1));
+    }
+
+    if (!hashesPath.empty())
+    {
+        std::ofstream output(hashesPath);
+        for (std::size_t step = 0; step < reference.waterHashes.size(); step++)
+        {
+            output << "water " << step << ' ' << std::hex << reference.waterHashes[step] << std::dec << '\n';
+        }
+        for (std::size_t step = 0; step < reference.duckHashes.size(); step++)
+        {
+            output << "duck " << step << ' ' << std::hex << reference.duckHashes[step] << std::dec << '\n';
+        }
+        if (!output)
+        {
+            std::println("  FAILED: cannot write the hashes to {}", hashesPath.string());
+            passed = false;
+        }
+    }
+
+    std::println("  {}", passed ? "passed" : "FAILED");
+    return passed;
+}
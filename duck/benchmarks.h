@@ -0,0 +1,11 @@
+#pragma once
+#include <filesystem>
+
+namespace mini::gk2::benchmarks
+{
+// Replays a recording of the demo with the scalar and the detected SIMD kernels, compares the state hashes step by step
+// and prints the first step that differs and the replay time without hashing. The hashes of the scalar replay are
+// written to hashesPath (one step per line) unless it is empty, so that the replays of two builds can be compared.
+// Returns false if the recording cannot be loaded or the hashes differ.
+bool RunReplay(const std::filesystem::path& recordingPath, const std::filesystem::path& hashesPath = {});
+} // namespace mini::gk2::benchmarks
@@ -4,6 +4,7 @@
 #include "dxptr.h"
 #include "window.h"
 #include <filesystem>
+#include <span>
 #include <vector>
 
 namespace mini
@@ -86,6 +87,20 @@ class DxDevice
         return CreateBuffer(reinterpret_cast<const void*>(indices.data()), desc);
     }
 
+    // Overloads for data owned elsewhere, e.g. a mapped mesh file, uploaded without an intermediate copy
+
+    template <class T> dx_ptr<ID3D11Buffer> CreateVertexBuffer(std::span<const T> vertices) const
+    {
+        auto desc = BufferDescription::VertexBufferDescription(vertices.size_bytes());
+        return CreateBuffer(reinterpret_cast<const void*>(vertices.data()), desc);
+    }
+
+    template <typename T> dx_ptr<ID3D11Buffer> CreateIndexBuffer(std::span<const T> indices) const
+    {
+        auto desc = BufferDescription::IndexBufferDescription(indices.size_bytes());
+        return CreateBuffer(reinterpret_cast<const void*>(indices.data()), desc);
+    }
+
     template <typename T, size_t N = 1> dx_ptr<ID3D11Buffer> CreateConstantBuffer() const
     {
         BufferDescription desc = BufferDescription::ConstantBufferDescription(N * sizeof(T));
@@ -3,21 +3,25 @@
 #include "mesh.h"
 #include <algorithm>
 #include <fstream>
+#include <system_error>
 
 using namespace std;
 using namespace mini;
 using namespace DirectX;
 
-Mesh::Mesh() : m_indexCount(0), m_primitiveType(D3D_PRIMITIVE_TOPOLOGY_UNDEFINED)
+Mesh::Mesh() : m_indexCount(0), m_primitiveType(D3D_PRIMITIVE_TOPOLOGY_UNDEFINED), m_indexFormat(DXGI_FORMAT_R16_UINT)
 {
 }
 
 Mesh::Mesh(dx_ptr_vector<ID3D11Buffer>&& vbuffers, vector<unsigned int>&& vstrides, vector<unsigned int>&& voffsets,
-           dx_ptr<ID3D11Buffer>&& indices, unsigned int indexCount, D3D_PRIMITIVE_TOPOLOGY primitiveType)
+           dx_ptr<ID3D11Buffer>&& indices, unsigned int indexCount, D3D_PRIMITIVE_TOPOLOGY primitiveType,
+           DXGI_FORMAT indexFormat)
 {
     assert(vbuffers.size() == voffsets.size() && vbuffers.size() == vstrides.size());
+    assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
     m_indexCount    = indexCount;
     m_primitiveType = primitiveType;
+    m_indexFormat   = indexFormat;
     m_indexBuffer   = move(indices);
 
     m_vertexBuffers = std::move(vbuffers);
@@ -28,7 +32,7 @@ Mesh::Mesh(dx_ptr_vector<ID3D11Buffer>&& vbuffers, vector<unsigned int>&& vstrid
 Mesh::Mesh(Mesh&& right) noexcept
     : m_indexBuffer(move(right.m_indexBuffer)), m_vertexBuffers(move(right.m_vertexBuffers)),
       m_strides(move(right.m_strides)), m_offsets(move(right.m_offsets)), m_indexCount(right.m_indexCount),
-      m_primitiveType(right.m_primitiveType)
+      m_primitiveType(right.m_primitiveType), m_indexFormat(right.m_indexFormat)
 {
     right.Release();
 }
@@ -41,6 +45,7 @@ void Mesh::Release()
     m_indexBuffer.reset();
     m_indexCount    = 0;
     m_primitiveType = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    m_indexFormat   = DXGI_FORMAT_R16_UINT;
 }
 
 Mesh& Mesh::operator=(Mesh&& right) noexcept
@@ -52,6 +57,7 @@ Mesh& Mesh::operator=(Mesh&& right) noexcept
     m_offsets       = move(right.m_offsets);
     m_indexCount    = right.m_indexCount;
     m_primitiveType = right.m_primitiveType;
+    m_indexFormat   = right.m_indexFormat;
     right.Release();
     return *this;
 }
@@ -61,7 +67,7 @@ void Mesh::Render(const dx_ptr<ID3D11DeviceContext>& context) const
     if (!m_indexBuffer || m_vertexBuffers.empty())
         return;
     context->IASetPrimitiveTopology(m_primitiveType);
-    context->IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+    context->IASetIndexBuffer(m_indexBuffer.get(), m_indexFormat, 0);
     context->IASetVertexBuffers(0, m_vertexBuffers.size(), m_vertexBuffers.data(), m_strides.data(), m_offsets.data());
     context->DrawIndexed(m_indexCount, 0, 0);
 }
@@ -449,157 +455,73 @@ std::vector<unsigned short> mini::Mesh::DiskIdx(unsigned int slices)
 
 Mesh mini::Mesh::LoadMesh(const DxDevice& device, const std::filesystem::path& meshPath)
 {
-    // File format for VN vertices and IN indices (IN divisible by 3, i.e. IN/3 triangles):
-    // VN IN
-    // pos.x pos.y pos.z norm.x norm.y norm.z tex.x tex.y [VN times, i.e. for each vertex]
-    // t.i1 t.i2 t.i3 [IN/3 times, i.e. for each triangle]
-
-    ifstream input;
-    // In general we shouldn't throw exceptions on end-of-file,
-    // however, in case of this file format if we reach the end
-    // of a file before we read all values, the file is
-    // ill-formated and we would need to throw an exception anyway
-    input.exceptions(ios::badbit | ios::failbit | ios::eofbit);
-    input.open(meshPath);
-
-    int vn;
-    input >> vn;
-
-    vector<VertexFrameTexCoords> verts(vn);
-    for (auto i = 0; i < vn; ++i)
+    if (meshPath.extension() == MESH_FILE_EXTENSION)
     {
-        input >> verts[i].position.x >> verts[i].position.y >> verts[i].position.z >> verts[i].normal.x >>
-            verts[i].normal.y >> verts[i].normal.z >> verts[i].tex.x >> verts[i].tex.y;
+        return FromMeshFile(device, MappedMeshFile(meshPath));
     }
 
-    int in;
-    input >> in;
-    vector<unsigned short> inds(3 * in);
-    for (auto i = 0; i < in; ++i)
+    const auto cachePath = MeshCachePath(meshPath);
+    if (!cachePath.empty() && IsMeshFileCurrent(cachePath, meshPath))
     {
-        input >> inds[3 * i] >> inds[3 * i + 1] >> inds[3 * i + 2];
+        try
+        {
+            return FromMeshFile(device, MappedMeshFile(cachePath));
+        }
+        catch (const ios_base::failure&)
+        {
+            // A damaged conversion, replaced below
+        }
     }
 
-    // From: https://www.cs.upc.edu/~virtual/G/1.%20Teoria/06.%20Textures/Tangent%20Space%20Calculation.pdf
-    for (auto i = 0; i < in; ++i)
-    {
-        auto idx1 = inds[3 * i];
-        auto idx2 = inds[3 * i + 1];
-        auto idx3 = inds[3 * i + 2];
-
-        const auto& v1 = verts[idx1].position;
-        const auto& v2 = verts[idx2].position;
-        const auto& v3 = verts[idx3].position;
-
-        const auto& w1 = verts[idx1].tex;
-        const auto& w2 = verts[idx2].tex;
-        const auto& w3 = verts[idx3].tex;
-
-        const float x1 = v2.x - v1.x;
-        const float x2 = v3.x - v1.x;
-        const float y1 = v2.y - v1.y;
-        const float y2 = v3.y - v1.y;
-        const float z1 = v2.z - v1.z;
-        const float z2 = v3.z - v1.z;
-
-        const float s1 = w2.x - w1.x;
-        const float s2 = w3.x - w1.x;
-        const float t1 = w2.y - w1.y;
-        const float t2 = w3.y - w1.y;
-
-        const float r = 1.0F / (s1 * t2 - s2 * t1);
-
-        XMFLOAT3 sdir = {0.f, 0.f, 0.f};
-        sdir.x += (t2 * x1 - t1 * x2) * r;
-        sdir.y += (t2 * y1 - t1 * y2) * r;
-        sdir.z += (t2 * z1 - t1 * z2) * r;
-
-        verts[idx1].tangent.x += sdir.x;
-        verts[idx1].tangent.y += sdir.y;
-        verts[idx1].tangent.z += sdir.z;
-
-        verts[idx2].tangent.x += sdir.x;
-        verts[idx2].tangent.y += sdir.y;
-        verts[idx2].tangent.z += sdir.z;
-
-        verts[idx3].tangent.x += sdir.x;
-        verts[idx3].tangent.y += sdir.y;
-        verts[idx3].tangent.z += sdir.z;
-    }
-    for (auto i = 0; i < vn; ++i)
+    auto mesh = LoadMeshData(meshPath);
+    OptimizeMesh(mesh.vertices, mesh.indices);
+    if (!cachePath.empty())
     {
-        auto normal  = DirectX::XMLoadFloat3(&verts[i].normal);
-        auto tangent = DirectX::XMLoadFloat3(&verts[i].tangent);
-
-        // gram-smidt
-        tangent = DirectX::XMVector3Normalize(tangent - normal * DirectX::XMVector3Dot(normal, tangent));
-        DirectX::XMStoreFloat3(&verts[i].tangent, tangent);
+        try
+        {
+            std::filesystem::create_directories(cachePath.parent_path());
+            WriteMeshFile(cachePath, mesh, MESH_CONVERSION_VERSION);
+        }
+        catch (const std::system_error&)
+        {
+            // No cache (filesystem_error or ios_base::failure), the text is parsed again by the next run
+        }
     }
-
-    return SimpleTriMesh(device, verts, inds);
+    return FromMeshData(device, mesh);
 }
 
-std::vector<unsigned short> mini::Mesh::ConvertTriangleListIdxToTriangleListAdjIdx(
-    const std::vector<VertexPositionNormal>& vertices, const std::vector<unsigned short>& indices)
+Mesh mini::Mesh::FromMeshData(const DxDevice& device, const MeshData& mesh)
 {
-    // Create unique indices mapping: It's required as there may be more than one vertex for one position
-    // which results in multiple indices representing exactly the same position
-    auto posToUniqueIdx = std::unordered_map<Position, unsigned short>();
-    for (auto i = 0U; i < indices.size(); ++i)
+    static_assert(sizeof(MeshVertex) == sizeof(VertexFrameTexCoords));
+    vector<VertexFrameTexCoords> verts;
+    verts.reserve(mesh.vertices.size());
+    for (const auto& v : mesh.vertices)
     {
-        auto f3  = vertices[indices[i]].position;
-        auto pos = Position(f3.x, f3.y, f3.z);
-        if (!posToUniqueIdx.contains(pos))
-        {
-            posToUniqueIdx.insert({pos, indices[i]});
-        }
+        verts.push_back({v.position, v.tangent, v.normal, v.tex});
     }
-
-    // Each edge is associated with 2 adjacent positions represented by unique indices
-    auto uniqueEdgeToAdjacentIdx = std::unordered_map<Edge, unsigned short>();
-    for (auto i = 0U; i < indices.size(); i += 3)
+    assert(IndicesInRange(mesh.indices, mesh.vertices.size()));
+    if (SelectIndexFormat(verts.size()) == IndexFormat::UInt16)
     {
-        for (auto j = 0U; j < 3; ++j)
-        {
-            auto idx       = indices[i + j];
-            auto f3        = vertices[idx].position;
-            auto pos       = Position(f3.x, f3.y, f3.z);
-            auto uniqueIdx = posToUniqueIdx[pos];
-
-            auto nextIdx       = indices[i + (j + 1) % 3];
-            auto nextf3        = vertices[nextIdx].position;
-            auto nextPos       = Position(nextf3.x, nextf3.y, nextf3.z);
-            auto nextUniqueIdx = posToUniqueIdx[nextPos];
-
-            auto adjacentIdx       = indices[i + (j + 2) % 3];
-            auto adjacentf3        = vertices[adjacentIdx].position;
-            auto adjacentPos       = Position(adjacentf3.x, adjacentf3.y, adjacentf3.z);
-            auto adjacentUniqueIdx = posToUniqueIdx[adjacentPos];
-
-            uniqueEdgeToAdjacentIdx.insert({Edge(uniqueIdx, nextUniqueIdx), adjacentUniqueIdx});
-        }
+        return SimpleTriMesh(device, verts, NarrowIndices(mesh.indices));
     }
+    return SimpleTriMesh(device, verts, mesh.indices);
+}
 
-    auto indicesAdj = std::vector<unsigned short>();
-    indicesAdj.reserve(indices.size() * 2);
-    for (auto i = 0U; i < indices.size(); i += 3)
+Mesh mini::Mesh::FromMeshFile(const DxDevice& device, const MappedMeshFile& file)
+{
+    static_assert(sizeof(MeshVertex) == sizeof(VertexFrameTexCoords));
+    if (file.Header().indexCount == 0)
     {
-        for (auto j = 0U; j < 3; ++j)
-        {
-            auto idx       = indices[i + j];
-            auto f3        = vertices[idx].position;
-            auto pos       = Position(f3.x, f3.y, f3.z);
-            auto uniqueIdx = posToUniqueIdx[pos];
-
-            auto nextIdx       = indices[i + (j + 1) % 3];
-            auto nextf3        = vertices[nextIdx].position;
-            auto nextPos       = Position(nextf3.x, nextf3.y, nextf3.z);
-            auto nextUniqueIdx = posToUniqueIdx[nextPos];
-
-            indicesAdj.push_back(idx);
-            indicesAdj.push_back(uniqueEdgeToAdjacentIdx[Edge(nextUniqueIdx, uniqueIdx)]); // reversed winding order
-        }
+        return {};
     }
-
-    return indicesAdj;
+    Mesh result;
+    result.m_indexBuffer = device.CreateIndexBuffer(file.IndexBytes());
+    result.m_vertexBuffers.push_back(device.CreateVertexBuffer(file.Vertices()));
+    result.m_strides.push_back(sizeof(VertexFrameTexCoords));
+    result.m_offsets.push_back(0);
+    result.m_indexCount    = file.Header().indexCount;
+    result.m_primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    result.m_indexFormat   = file.IndicesFormat() == IndexFormat::UInt16 ? IndexBufferFormat<unsigned short>()
+                                                                         : IndexBufferFormat<unsigned int>();
+    return result;
 }
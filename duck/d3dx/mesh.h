@@ -2,78 +2,16 @@
 
 #include "dxDevice.h"
 #include "dxptr.h"
-#include "hashCombine.h"
+#include "meshFile.h"
 #include "vertexTypes.h"
 #include <D3D11.h>
 #include <DirectXMath.h>
+#include <type_traits>
 #include <vector>
 
 namespace mini
 {
 
-struct Edge
-{
-    unsigned short v1;
-    unsigned short v2;
-
-    Edge(unsigned short v1_ind, unsigned short v2_ind) : v1(v1_ind), v2(v2_ind)
-    {
-    }
-
-    friend bool operator==(const Edge& left, const Edge& right)
-    {
-        return left.v1 == right.v1 && left.v2 == right.v2;
-    }
-};
-
-struct Position
-{
-    float x, y, z;
-
-    Position(float _x, float _y, float _z) : x(_x), y(_y), z(_z)
-    {
-    }
-
-    bool operator==(const Position& other) const
-    {
-        return x == other.x && y == other.y && z == other.z;
-    }
-};
-
-} // namespace mini
-
-namespace std
-{
-
-template <> struct hash<mini::Edge>
-{
-    std::size_t operator()(const mini::Edge edge) const noexcept
-    {
-        std::size_t h1 = hash<uint32_t>{}(edge.v1);
-        std::size_t h2 = hash<uint32_t>{}(edge.v2);
-        mini::HashCombine(h1, h2);
-        return h1;
-    }
-};
-
-template <> struct hash<mini::Position>
-{
-    std::size_t operator()(const mini::Position pos) const noexcept
-    {
-        std::size_t h1 = hash<float>{}(pos.x);
-        std::size_t h2 = hash<float>{}(pos.y);
-        std::size_t h3 = hash<float>{}(pos.z);
-        mini::HashCombine(h1, h2);
-        mini::HashCombine(h1, h3);
-        return h1;
-    }
-};
-
-} // namespace std
-
-namespace mini
-{
-
 template <CVertexLayout Layout> struct CPUMesh
 {
     std::vector<Layout> vertices;
@@ -98,14 +36,16 @@ class Mesh
   public:
     Mesh();
     Mesh(dx_ptr_vector<ID3D11Buffer>&& vbuffers, std::vector<unsigned int>&& vstrides, dx_ptr<ID3D11Buffer>&& indices,
-         unsigned int indexCount, D3D_PRIMITIVE_TOPOLOGY primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+         unsigned int indexCount, D3D_PRIMITIVE_TOPOLOGY primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+         DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT)
         : Mesh(std::move(vbuffers), std::move(vstrides), std::vector<unsigned>(vbuffers.size(), 0U), std::move(indices),
-               indexCount, primitiveType)
+               indexCount, primitiveType, indexFormat)
     {
     }
     Mesh(dx_ptr_vector<ID3D11Buffer>&& vbuffers, std::vector<unsigned int>&& vstrides,
          std::vector<unsigned int>&& voffsets, dx_ptr<ID3D11Buffer>&& indices, unsigned int indexCount,
-         D3D_PRIMITIVE_TOPOLOGY primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+         D3D_PRIMITIVE_TOPOLOGY primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+         DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT);
 
     Mesh(Mesh&& right) noexcept;
     Mesh(const Mesh& right) = delete;
@@ -116,9 +56,16 @@ class Mesh
     Mesh& operator=(Mesh&& right) noexcept;
     void Render(const dx_ptr<ID3D11DeviceContext>& context) const;
 
-    template <typename VertexType>
+    // Format of an index buffer of IndexType, unsigned short or unsigned int
+    template <typename IndexType> static constexpr DXGI_FORMAT IndexBufferFormat()
+    {
+        static_assert(std::is_same_v<IndexType, unsigned short> || std::is_same_v<IndexType, unsigned int>);
+        return sizeof(IndexType) == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    }
+
+    template <typename VertexType, typename IndexType>
     static Mesh SimpleTriMesh(const DxDevice& device, const std::vector<VertexType> verts,
-                              const std::vector<unsigned short> idxs)
+                              const std::vector<IndexType> idxs)
     {
         if (idxs.empty())
             return {};
@@ -129,17 +76,18 @@ class Mesh
         result.m_offsets.push_back(0);
         result.m_indexCount    = idxs.size();
         result.m_primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        result.m_indexFormat   = IndexBufferFormat<IndexType>();
         return result;
     }
 
     /** Creates a mesh with adjacent triangles from SimpleTriMesh data
      *
      */
-    template <typename VertexType>
+    template <typename VertexType, typename IndexType>
     static Mesh SimpleTriAdjMesh(const DxDevice& device, const std::vector<VertexType> verts,
-                                 const std::vector<unsigned short> idxs)
+                                 const std::vector<IndexType> idxs)
     {
-        auto idxsAdj = ConvertTriangleListIdxToTriangleListAdjIdx(verts, idxs);
+        auto idxsAdj = TriangleListAdjacency(verts, idxs);
         if (idxsAdj.empty())
             return {};
         Mesh result;
@@ -149,6 +97,7 @@ class Mesh
         result.m_offsets.push_back(0);
         result.m_indexCount    = idxsAdj.size();
         result.m_primitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ;
+        result.m_indexFormat   = IndexBufferFormat<IndexType>();
         return result;
     }
 
@@ -278,11 +227,23 @@ class Mesh
         return SimpleTriMesh(device, DiskVerts(slices, radius), DiskIdx(slices));
     }
 
-    // Mesh Loading
+    // Mesh Loading: a .mesh file is mapped, a text file is parsed by LoadMeshData of meshData.h unless its cached
+    // conversion at MeshCachePath is current. A parsed text file is reordered by OptimizeMesh of meshOptimizer.h for
+    // the vertex caches and cached if possible, so that the following runs only map it; the resources are never
+    // written. The indices are 16 bit up to MAX_16BIT_VERTICES vertices and 32 bit above, so that large meshes are
+    // drawn at once.
     static Mesh LoadMesh(const DxDevice& device, const std::filesystem::path& meshPath);
 
+    static Mesh FromMeshData(const DxDevice& device, const MeshData& mesh);
+
+    // Uploads the vertices and indices straight from the mapping
+    static Mesh FromMeshFile(const DxDevice& device, const MappedMeshFile& file);
+
     static std::vector<unsigned short> ConvertTriangleListIdxToTriangleListAdjIdx(
-        const std::vector<VertexPositionNormal>& vertices, const std::vector<unsigned short>& indices);
+        const std::vector<VertexPositionNormal>& vertices, const std::vector<unsigned short>& indices)
+    {
+        return TriangleListAdjacency(vertices, indices);
+    }
 
   private:
     dx_ptr<ID3D11Buffer> m_indexBuffer;
@@ -291,6 +252,7 @@ class Mesh
     std::vector<unsigned int> m_offsets;
     unsigned int m_indexCount;
     D3D_PRIMITIVE_TOPOLOGY m_primitiveType;
+    DXGI_FORMAT m_indexFormat;
 };
 
 } // namespace mini
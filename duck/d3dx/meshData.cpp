@@ -0,0 +1,321 @@
+#include "pch.h"
+
+#include "meshData.h"
+#include "profiling.h"
+#include "threadPool.h"
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+
+using namespace std;
+using namespace mini;
+using namespace DirectX;
+
+namespace
+{
+// Vertex lines parsed by a task of the thread pool
+constexpr int VERTEX_CHUNK = 8192;
+
+constexpr int VERTEX_VALUES = 8; // position, normal and texture coordinates
+
+// Position in the text of a mesh file
+struct Cursor
+{
+    const char* p;
+    const char* end;
+    int line; // 1-based
+};
+
+// First error of a parse, line 0 if there was none
+struct ParseError
+{
+    int line = 0;
+    std::string_view reason;
+};
+
+bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void SkipBlanks(Cursor& cursor)
+{
+    while (cursor.p != cursor.end && IsBlank(*cursor.p))
+    {
+        cursor.p++;
+    }
+}
+
+void SkipWhitespace(Cursor& cursor)
+{
+    for (; cursor.p != cursor.end && (IsBlank(*cursor.p) || *cursor.p == '\n'); cursor.p++)
+    {
+        cursor.line += *cursor.p == '\n';
+    }
+}
+
+// Steps over the line break ending the current line, false if anything but blanks is left on the line
+bool EndLine(Cursor& cursor)
+{
+    SkipBlanks(cursor);
+    if (cursor.p == cursor.end)
+    {
+        return true;
+    }
+    if (*cursor.p != '\n')
+    {
+        return false;
+    }
+    cursor.p++;
+    cursor.line++;
+    return true;
+}
+
+// Steps over blank lines to the start of the next line with any value on it
+void SkipBlankLines(Cursor& cursor)
+{
+    for (auto next = cursor; EndLine(next) && next.p != cursor.p; next = cursor)
+    {
+        cursor = next;
+    }
+}
+
+// A number of type T ending at a blank, a line break or the end of the text. Unlike operator>> from_chars does not
+// depend on the locale.
+template <typename T> bool Parse(Cursor& cursor, T& value)
+{
+    const auto [next, error] = std::from_chars(cursor.p, cursor.end, value);
+    if (error != std::errc{} || (next != cursor.end && !IsBlank(*next) && *next != '\n'))
+    {
+        return false;
+    }
+    cursor.p = next;
+    return true;
+}
+
+// Vertex lines from `cursor` on, one vertex per line with blank lines in between allowed
+ParseError ParseVertices(Cursor cursor, std::span<MeshVertex> vertices)
+{
+    for (auto& v : vertices)
+    {
+        SkipBlankLines(cursor);
+        std::array<float, VERTEX_VALUES> values;
+        for (auto& value : values)
+        {
+            SkipBlanks(cursor);
+            if (!Parse(cursor, value))
+            {
+                return {cursor.line, "expected 8 numbers of a vertex: position, normal and texture coordinates"};
+            }
+        }
+        if (!EndLine(cursor))
+        {
+            return {cursor.line, "more than 8 numbers on a vertex line"};
+        }
+        v.position = {values[0], values[1], values[2]};
+        v.normal   = {values[3], values[4], values[5]};
+        v.tex      = {values[6], values[7]};
+    }
+    return {};
+}
+
+[[noreturn]] void Fail(const std::filesystem::path& meshPath, int line, std::string_view reason)
+{
+    throw MeshParseError(meshPath, line, reason);
+}
+} // namespace
+
+mini::MeshParseError::MeshParseError(const std::filesystem::path& meshPath, int line, std::string_view reason)
+    : ios_base::failure(std::format("{}:{}: {}", meshPath.string(), line, reason)), m_line(line)
+{
+}
+
+MeshData mini::LoadMeshData(const std::filesystem::path& meshPath)
+{
+    // File format for VN vertices and IN indices (IN divisible by 3, i.e. IN/3 triangles):
+    // VN IN
+    // pos.x pos.y pos.z norm.x norm.y norm.z tex.x tex.y [VN times, i.e. for each vertex]
+    // t.i1 t.i2 t.i3 [IN/3 times, i.e. for each triangle]
+    //
+    // Every vertex is on its own line, so that the vertex lines are split into chunks parsed in parallel. The counts
+    // and the indices may be separated by any whitespace.
+    PROFILE_ZONE("LoadMeshData");
+
+    string text;
+    {
+        ifstream input;
+        input.exceptions(ios::badbit | ios::failbit);
+        input.open(meshPath, ios::binary);
+        text.resize(static_cast<size_t>(std::filesystem::file_size(meshPath)));
+        input.read(text.data(), static_cast<streamsize>(text.size()));
+    }
+
+    Cursor cursor{text.data(), text.data() + text.size(), 1};
+    int vn;
+    SkipWhitespace(cursor);
+    if (!Parse(cursor, vn) || vn < 0 || !EndLine(cursor))
+    {
+        Fail(meshPath, cursor.line, "expected the number of vertices alone on a line");
+    }
+
+    // Finds the first line of every chunk, walking the lines is much faster than parsing them
+    std::vector<Cursor> chunks;
+    chunks.reserve(vn / VERTEX_CHUNK + 1);
+    for (auto i = 0; i < vn; i++)
+    {
+        SkipBlankLines(cursor);
+        if (cursor.p == cursor.end)
+        {
+            Fail(meshPath, cursor.line, std::format("expected {} vertices, the file ends after {}", vn, i));
+        }
+        if (i % VERTEX_CHUNK == 0)
+        {
+            chunks.push_back(cursor);
+        }
+        const auto lineEnd = static_cast<const char*>(std::memchr(cursor.p, '\n', cursor.end - cursor.p));
+        cursor.p           = lineEnd != nullptr ? lineEnd + 1 : cursor.end;
+        cursor.line++;
+    }
+
+    MeshData mesh;
+    mesh.vertices.resize(vn);
+    std::vector<ParseError> errors(chunks.size());
+    const auto parseChunks = [&](int begin, int end)
+    {
+        for (auto c = begin; c < end; c++)
+        {
+            const auto first = static_cast<size_t>(c) * VERTEX_CHUNK;
+            const auto count = std::min<size_t>(VERTEX_CHUNK, vn - first);
+            errors[c]        = ParseVertices(chunks[c], {&mesh.vertices[first], count});
+        }
+    };
+    ThreadPool::Shared().ParallelFor(static_cast<int>(chunks.size()), 1, parseChunks);
+    for (const auto& error : errors)
+    {
+        if (error.line != 0)
+        {
+            Fail(meshPath, error.line, error.reason);
+        }
+    }
+
+    int in;
+    SkipWhitespace(cursor);
+    if (!Parse(cursor, in) || in < 0)
+    {
+        Fail(meshPath, cursor.line, "expected the number of triangles");
+    }
+    auto& inds = mesh.indices;
+    inds.resize(3 * static_cast<size_t>(in));
+    for (auto& index : inds)
+    {
+        SkipWhitespace(cursor);
+        if (!Parse(cursor, index))
+        {
+            const auto reason = cursor.p == cursor.end ? std::format("expected {} triangles", in)
+                                                       : std::string("expected a vertex index");
+            Fail(meshPath, cursor.line, reason);
+        }
+        if (index >= static_cast<unsigned int>(vn))
+        {
+            Fail(meshPath, cursor.line, std::format("vertex index {} out of the {} vertices", index, vn));
+        }
+    }
+
+    ComputeTangents(mesh);
+    return mesh;
+}
+
+mini::IndexFormat mini::SelectIndexFormat(std::size_t vertexCount)
+{
+    return vertexCount <= MAX_16BIT_VERTICES ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+std::size_t mini::IndexSize(IndexFormat format)
+{
+    return format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+bool mini::IndicesInRange(std::span<const unsigned int> indices, std::size_t vertexCount)
+{
+    return std::ranges::all_of(indices, [vertexCount](unsigned int index) { return index < vertexCount; });
+}
+
+std::vector<unsigned short> mini::NarrowIndices(std::span<const unsigned int> indices)
+{
+    if (!IndicesInRange(indices, MAX_16BIT_VERTICES))
+    {
+        throw std::out_of_range("index too large for a 16 bit index buffer");
+    }
+    std::vector<unsigned short> narrowed(indices.size());
+    const auto narrow = [](unsigned int index) { return static_cast<unsigned short>(index); };
+    std::ranges::transform(indices, narrowed.begin(), narrow);
+    return narrowed;
+}
+
+void mini::ComputeTangents(MeshData& mesh)
+{
+    auto& verts      = mesh.vertices;
+    const auto& inds = mesh.indices;
+    for (auto& v : verts)
+    {
+        v.tangent = {0.f, 0.f, 0.f};
+    }
+
+    // From: https://www.cs.upc.edu/~virtual/G/1.%20Teoria/06.%20Textures/Tangent%20Space%20Calculation.pdf
+    for (auto i = 0U; i + 2 < inds.size(); i += 3)
+    {
+        auto idx1 = inds[i];
+        auto idx2 = inds[i + 1];
+        auto idx3 = inds[i + 2];
+
+        const auto& v1 = verts[idx1].position;
+        const auto& v2 = verts[idx2].position;
+        const auto& v3 = verts[idx3].position;
+
+        const auto& w1 = verts[idx1].tex;
+        const auto& w2 = verts[idx2].tex;
+        const auto& w3 = verts[idx3].tex;
+
+        const float x1 = v2.x - v1.x;
+        const float x2 = v3.x - v1.x;
+        const float y1 = v2.y - v1.y;
+        const float y2 = v3.y - v1.y;
+        const float z1 = v2.z - v1.z;
+        const float z2 = v3.z - v1.z;
+
+        const float s1 = w2.x - w1.x;
+        const float s2 = w3.x - w1.x;
+        const float t1 = w2.y - w1.y;
+        const float t2 = w3.y - w1.y;
+
+        const float r = 1.0F / (s1 * t2 - s2 * t1);
+
+        XMFLOAT3 sdir = {0.f, 0.f, 0.f};
+        sdir.x += (t2 * x1 - t1 * x2) * r;
+        sdir.y += (t2 * y1 - t1 * y2) * r;
+        sdir.z += (t2 * z1 - t1 * z2) * r;
+
+        verts[idx1].tangent.x += sdir.x;
+        verts[idx1].tangent.y += sdir.y;
+        verts[idx1].tangent.z += sdir.z;
+
+        verts[idx2].tangent.x += sdir.x;
+        verts[idx2].tangent.y += sdir.y;
+        verts[idx2].tangent.z += sdir.z;
+
+        verts[idx3].tangent.x += sdir.x;
+        verts[idx3].tangent.y += sdir.y;
+        verts[idx3].tangent.z += sdir.z;
+    }
+    for (auto& v : verts)
+    {
+        auto normal  = XMLoadFloat3(&v.normal);
+        auto tangent = XMLoadFloat3(&v.tangent);
+
+        // gram-smidt
+        tangent = XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent));
+        XMStoreFloat3(&v.tangent, tangent);
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "hashCombine.h"
+#include <DirectXMath.h>
+#include <filesystem>
+#include <ios>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mini
+{
+
+struct Edge
+{
+    unsigned int v1;
+    unsigned int v2;
+
+    Edge(unsigned int v1_ind, unsigned int v2_ind) : v1(v1_ind), v2(v2_ind)
+    {
+    }
+
+    friend bool operator==(const Edge& left, const Edge& right)
+    {
+        return left.v1 == right.v1 && left.v2 == right.v2;
+    }
+};
+
+struct Position
+{
+    float x, y, z;
+
+    Position(float _x, float _y, float _z) : x(_x), y(_y), z(_z)
+    {
+    }
+
+    bool operator==(const Position& other) const
+    {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+} // namespace mini
+
+namespace std
+{
+
+template <> struct hash<mini::Edge>
+{
+    std::size_t operator()(const mini::Edge edge) const noexcept
+    {
+        std::size_t h1 = hash<uint32_t>{}(edge.v1);
+        std::size_t h2 = hash<uint32_t>{}(edge.v2);
+        mini::HashCombine(h1, h2);
+        return h1;
+    }
+};
+
+template <> struct hash<mini::Position>
+{
+    std::size_t operator()(const mini::Position pos) const noexcept
+    {
+        std::size_t h1 = hash<float>{}(pos.x);
+        std::size_t h2 = hash<float>{}(pos.y);
+        std::size_t h3 = hash<float>{}(pos.z);
+        mini::HashCombine(h1, h2);
+        mini::HashCombine(h1, h3);
+        return h1;
+    }
+};
+
+} // namespace std
+
+namespace mini
+{
+
+// Vertex of the meshes loaded from files, the same layout as VertexFrameTexCoords
+struct MeshVertex
+{
+    DirectX::XMFLOAT3 position;
+    DirectX::XMFLOAT3 tangent;
+    DirectX::XMFLOAT3 normal;
+    DirectX::XMFLOAT2 tex;
+};
+
+// Triangle list of a mesh on the CPU side. Mesh turns it into the D3D11 buffers, everything here builds without a
+// device. The indices are 32 bit here and narrowed for the upload when the vertices allow it.
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Formats of index buffers, 16 bit indices address at most MAX_16BIT_VERTICES vertices
+enum class IndexFormat
+{
+    UInt16,
+    UInt32
+};
+
+inline constexpr std::size_t MAX_16BIT_VERTICES = 65536;
+
+// The smaller format addressing `vertexCount` vertices
+IndexFormat SelectIndexFormat(std::size_t vertexCount);
+
+// Bytes per index
+std::size_t IndexSize(IndexFormat format);
+
+// Whether every index addresses one of `vertexCount` vertices
+bool IndicesInRange(std::span<const unsigned int> indices, std::size_t vertexCount);
+
+// 16 bit copy of the indices, throws std::out_of_range if any of them does not fit
+std::vector<unsigned short> NarrowIndices(std::span<const unsigned int> indices);
+
+// Ill-formed mesh file, what() names the file and the line of the first error
+class MeshParseError : public std::ios_base::failure
+{
+  public:
+    MeshParseError(const std::filesystem::path& meshPath, int line, std::string_view reason);
+
+    int Line() const
+    {
+        return m_line;
+    }
+
+  private:
+    int m_line;
+};
+
+// Reads a mesh file and computes the tangents, throws MeshParseError on an ill-formed file and std::ios_base::failure
+// if it cannot be read. The vertex lines are parsed in parallel on ThreadPool::Shared().
+MeshData LoadMeshData(const std::filesystem::path& meshPath);
+
+// Computes the per vertex tangents from the texture coordinates, orthogonal to the normals
+void ComputeTangents(MeshData& mesh);
+
+// Index buffer of a D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ mesh for a triangle list. Vertex is any type with an
+// XMFLOAT3 position, Index unsigned short or unsigned int.
+template <typename Vertex, typename Index>
+std::vector<Index> TriangleListAdjacency(const std::vector<Vertex>& vertices, const std::vector<Index>& indices)
+{
+    // Create unique indices mapping: It's required as there may be more than one vertex for one position
+    // which results in multiple indices representing exactly the same position
+    auto posToUniqueIdx = std::unordered_map<Position, Index>();
+    for (auto i = 0U; i < indices.size(); ++i)
+    {
+        auto f3  = vertices[indices[i]].position;
+        auto pos = Position(f3.x, f3.y, f3.z);
+        if (!posToUniqueIdx.contains(pos))
+        {
+            posToUniqueIdx.insert({pos, indices[i]});
+        }
+    }
+
+    // Each edge is associated with 2 adjacent positions represented by unique indices
+    auto uniqueEdgeToAdjacentIdx = std::unordered_map<Edge, Index>();
+    for (auto i = 0U; i < indices.size(); i += 3)
+    {
+        for (auto j = 0U; j < 3; ++j)
+        {
+            auto idx       = indices[i + j];
+            auto f3        = vertices[idx].position;
+            auto pos       = Position(f3.x, f3.y, f3.z);
+            auto uniqueIdx = posToUniqueIdx[pos];
+
+            auto nextIdx       = indices[i + (j + 1) % 3];
+            auto nextf3        = vertices[nextIdx].position;
+            auto nextPos       = Position(nextf3.x, nextf3.y, nextf3.z);
+            auto nextUniqueIdx = posToUniqueIdx[nextPos];
+
+            auto adjacentIdx       = indices[i + (j + 2) % 3];
+            auto adjacentf3        = vertices[adjacentIdx].position;
+            auto adjacentPos       = Position(adjacentf3.x, adjacentf3.y, adjacentf3.z);
+            auto adjacentUniqueIdx = posToUniqueIdx[adjacentPos];
+
+            uniqueEdgeToAdjacentIdx.insert({Edge(uniqueIdx, nextUniqueIdx), adjacentUniqueIdx});
+        }
+    }
+
+    auto indicesAdj = std::vector<Index>();
+    indicesAdj.reserve(indices.size() * 2);
+    for (auto i = 0U; i < indices.size(); i += 3)
+    {
+        for (auto j = 0U; j < 3; ++j)
+        {
+            auto idx       = indices[i + j];
+            auto f3        = vertices[idx].position;
+            auto pos       = Position(f3.x, f3.y, f3.z);
+            auto uniqueIdx = posToUniqueIdx[pos];
+
+            auto nextIdx       = indices[i + (j + 1) % 3];
+            auto nextf3        = vertices[nextIdx].position;
+            auto nextPos       = Position(nextf3.x, nextf3.y, nextf3.z);
+            auto nextUniqueIdx = posToUniqueIdx[nextPos];
+
+            indicesAdj.push_back(idx);
+            indicesAdj.push_back(uniqueEdgeToAdjacentIdx[Edge(nextUniqueIdx, uniqueIdx)]); // reversed winding order
+        }
+    }
+
+    return indicesAdj;
+}
+
+} // namespace mini
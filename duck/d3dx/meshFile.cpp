@@ -0,0 +1,247 @@
+#include "pch.h"
+
+#include "meshFile.h"
+#include "hashCombine.h"
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace mini;
+using namespace DirectX;
+
+namespace
+{
+std::uint64_t AlignUp(std::uint64_t offset)
+{
+    return (offset + MeshFileHeader::ALIGNMENT - 1) / MeshFileHeader::ALIGNMENT * MeshFileHeader::ALIGNMENT;
+}
+
+// The blocks lie inside the file and are aligned, so that the views of the mapping are valid
+bool IsValid(const MeshFileHeader& header, std::size_t fileSize)
+{
+    const auto fitsAt = [fileSize](std::uint64_t offset, std::uint64_t bytes)
+    {
+        return offset % MeshFileHeader::ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset;
+    };
+
+    return header.magic == MeshFileHeader::MAGIC && header.version == MeshFileHeader::VERSION &&
+           header.vertexSize == sizeof(MeshVertex) &&
+           (header.indexSize == sizeof(unsigned short) || header.indexSize == sizeof(unsigned int)) &&
+           header.indexCount % 3 == 0 &&
+           fitsAt(header.vertexOffset, static_cast<std::uint64_t>(header.vertexCount) * header.vertexSize) &&
+           fitsAt(header.indexOffset, static_cast<std::uint64_t>(header.indexCount) * header.indexSize);
+}
+
+ios_base::failure MappingFailure(const std::filesystem::path& meshPath, std::string_view reason)
+{
+    return ios_base::failure(std::format("{}: {}", meshPath.string(), reason));
+}
+} // namespace
+
+void mini::WriteMeshFile(const std::filesystem::path& meshPath, const MeshData& mesh, std::uint32_t conversionVersion)
+{
+    assert(IndicesInRange(mesh.indices, mesh.vertices.size()));
+    const auto indexFormat = SelectIndexFormat(mesh.vertices.size());
+
+    MeshFileHeader header{};
+    header.magic             = MeshFileHeader::MAGIC;
+    header.version           = MeshFileHeader::VERSION;
+    header.vertexSize        = sizeof(MeshVertex);
+    header.indexSize         = static_cast<std::uint32_t>(IndexSize(indexFormat));
+    header.vertexCount       = static_cast<std::uint32_t>(mesh.vertices.size());
+    header.indexCount        = static_cast<std::uint32_t>(mesh.indices.size());
+    header.vertexOffset      = AlignUp(sizeof(MeshFileHeader));
+    header.indexOffset       = AlignUp(header.vertexOffset + mesh.vertices.size() * sizeof(MeshVertex));
+    header.conversionVersion = conversionVersion;
+    if (!mesh.vertices.empty())
+    {
+        header.boundsMin = header.boundsMax = mesh.vertices.front().position;
+    }
+    for (const auto& v : mesh.vertices)
+    {
+        XMStoreFloat3(&header.boundsMin, XMVectorMin(XMLoadFloat3(&header.boundsMin), XMLoadFloat3(&v.position)));
+        XMStoreFloat3(&header.boundsMax, XMVectorMax(XMLoadFloat3(&header.boundsMax), XMLoadFloat3(&v.position)));
+    }
+
+    ofstream output;
+    output.exceptions(ios::badbit | ios::failbit);
+    output.open(meshPath, ios::binary | ios::trunc);
+
+    const auto padTo = [&output](std::uint64_t offset)
+    {
+        static constexpr std::array<char, MeshFileHeader::ALIGNMENT> zeros{};
+        output.write(zeros.data(), static_cast<std::streamsize>(offset - static_cast<std::uint64_t>(output.tellp())));
+    };
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.vertexOffset);
+    output.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                 static_cast<std::streamsize>(mesh.vertices.size() * sizeof(MeshVertex)));
+    padTo(header.indexOffset);
+    const auto writeIndices = [&output](const auto& indices)
+    {
+        output.write(reinterpret_cast<const char*>(indices.data()),
+                     static_cast<std::streamsize>(indices.size() * sizeof(indices[0])));
+    };
+    if (indexFormat == IndexFormat::UInt16)
+    {
+        writeIndices(NarrowIndices(mesh.indices));
+    }
+    else
+    {
+        writeIndices(mesh.indices);
+    }
+}
+
+MeshOptimizationReport mini::ConvertMeshFile(const std::filesystem::path& textPath,
+                                             const std::filesystem::path& meshPath, bool overdraw)
+{
+    auto mesh         = LoadMeshData(textPath);
+    const auto report = OptimizeMesh(mesh.vertices, mesh.indices, overdraw);
+    WriteMeshFile(meshPath, mesh, MESH_CONVERSION_VERSION);
+    return report;
+}
+
+bool mini::IsMeshFileCurrent(const std::filesystem::path& meshPath, const std::filesystem::path& textPath)
+{
+    std::error_code error;
+    const auto meshTime = std::filesystem::last_write_time(meshPath, error);
+    if (error)
+    {
+        return false;
+    }
+    const auto textTime = std::filesystem::last_write_time(textPath, error);
+    if (error || meshTime < textTime)
+    {
+        return false;
+    }
+
+    // The header alone, a damaged file is left to MappedMeshFile
+    ifstream input(meshPath, ios::binary);
+    MeshFileHeader header;
+    return input.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == MeshFileHeader::MAGIC &&
+           header.version == MeshFileHeader::VERSION && header.conversionVersion == MESH_CONVERSION_VERSION;
+}
+
+std::filesystem::path mini::MeshCachePath(const std::filesystem::path& textPath)
+{
+    std::error_code error;
+    const auto directory = std::filesystem::temp_directory_path(error);
+    if (error)
+    {
+        return {};
+    }
+    // Text files of the same name in different directories get different conversions
+    const auto absolute = std::filesystem::absolute(textPath, error).generic_string();
+    const auto hash     = HashBytes(absolute.data(), absolute.size());
+    return directory / "duck" / "meshes" /
+           std::format("{}-{:016x}{}", textPath.stem().string(), hash, MESH_FILE_EXTENSION);
+}
+
+mini::MappedMeshFile::MappedMeshFile(const std::filesystem::path& meshPath) : m_data(nullptr), m_size(0)
+{
+#ifdef _WIN32
+    const auto file = CreateFileW(meshPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw MappingFailure(meshPath, "cannot open the mesh file");
+    }
+    LARGE_INTEGER size;
+    const auto mapping = GetFileSizeEx(file, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(MeshFileHeader))
+                             ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)
+                             : nullptr;
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+        throw MappingFailure(meshPath, "cannot map the mesh file");
+    }
+    // The view keeps the mapping alive on its own
+    m_data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (m_data == nullptr)
+    {
+        throw MappingFailure(meshPath, "cannot map the mesh file");
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+    const auto file = open(meshPath.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw MappingFailure(meshPath, "cannot open the mesh file");
+    }
+    struct stat status;
+    const auto size = fstat(file, &status) == 0 ? static_cast<std::size_t>(status.st_size) : 0;
+    const auto view =
+        size >= sizeof(MeshFileHeader) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        throw MappingFailure(meshPath, "cannot map the mesh file");
+    }
+    m_data = static_cast<const std::byte*>(view);
+    m_size = size;
+#endif
+    if (!IsValid(Header(), m_size))
+    {
+        Unmap();
+        throw MappingFailure(meshPath, "not a mesh file of this version");
+    }
+}
+
+mini::MappedMeshFile::~MappedMeshFile()
+{
+    Unmap();
+}
+
+mini::MappedMeshFile::MappedMeshFile(MappedMeshFile&& right) noexcept
+    : m_data(std::exchange(right.m_data, nullptr)), m_size(std::exchange(right.m_size, 0))
+{
+}
+
+mini::MappedMeshFile& mini::MappedMeshFile::operator=(MappedMeshFile&& right) noexcept
+{
+    if (this != &right)
+    {
+        Unmap();
+        m_data = std::exchange(right.m_data, nullptr);
+        m_size = std::exchange(right.m_size, 0);
+    }
+    return *this;
+}
+
+MeshData mini::MappedMeshFile::ToMeshData() const
+{
+    const auto vertices = Vertices();
+    MeshData mesh{{vertices.begin(), vertices.end()}, std::vector<unsigned int>(Header().indexCount)};
+    if (IndicesFormat() == IndexFormat::UInt32)
+    {
+        std::memcpy(mesh.indices.data(), IndexBytes().data(), IndexBytes().size());
+        return mesh;
+    }
+    const auto indices = reinterpret_cast<const unsigned short*>(IndexBytes().data());
+    std::copy_n(indices, mesh.indices.size(), mesh.indices.begin());
+    return mesh;
+}
+
+void mini::MappedMeshFile::Unmap()
+{
+    if (m_data == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
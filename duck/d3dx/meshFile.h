@@ -0,0 +1,106 @@
+#pragma once
+
+#include "meshData.h"
+#include "meshOptimizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace mini
+{
+
+// Binary mesh file, a MeshFileHeader followed by
+//   vertexCount MeshVertex at vertexOffset, with the tangents computed and in the layout of VertexFrameTexCoords
+//   indexCount indices of indexSize bytes at indexOffset, 16 bit if there are at most MAX_16BIT_VERTICES vertices
+// Little-endian, both blocks are aligned to MeshFileHeader::ALIGNMENT, so that a mapping of the file is handed to the
+// buffer creation as it is. Since version 2 the conversions are in the order of OptimizeMesh of meshOptimizer.h.
+struct MeshFileHeader
+{
+    static constexpr std::uint32_t MAGIC     = 0x48534d44; // "DMSH"
+    static constexpr std::uint32_t VERSION   = 3;
+    static constexpr std::uint64_t ALIGNMENT = 16;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t vertexSize; // bytes per vertex, sizeof(MeshVertex)
+    std::uint32_t indexSize;  // bytes per index, 2 or 4
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    std::uint64_t vertexOffset; // from the start of the file
+    std::uint64_t indexOffset;
+    DirectX::XMFLOAT3 boundsMin; // of the positions
+    DirectX::XMFLOAT3 boundsMax;
+    std::uint32_t conversionVersion; // MESH_CONVERSION_VERSION of ConvertMeshFile, 0 for other meshes
+    std::uint32_t reserved;          // zero
+};
+static_assert(sizeof(MeshFileHeader) == 72);
+
+inline constexpr auto MESH_FILE_EXTENSION = ".mesh";
+
+// Version of the conversion of the text format, LoadMeshData followed by OptimizeMesh. Every change of their output
+// bumps it, so that the conversions by an older one are no longer current even if their file is newer than the text.
+inline constexpr std::uint32_t MESH_CONVERSION_VERSION = 1;
+
+// Writes the mesh and its bounding box, throws std::ios_base::failure if the file cannot be written
+void WriteMeshFile(const std::filesystem::path& meshPath, const MeshData& mesh, std::uint32_t conversionVersion = 0);
+
+// Converts a mesh file in the text format of LoadMeshData, with its triangles and vertices reordered by OptimizeMesh.
+// Throws std::ios_base::failure like both of them.
+MeshOptimizationReport ConvertMeshFile(const std::filesystem::path& textPath, const std::filesystem::path& meshPath,
+                                       bool overdraw = false);
+
+// Whether meshPath is a conversion of the current version of textPath by the current ConvertMeshFile: it was written
+// after textPath with MESH_CONVERSION_VERSION
+bool IsMeshFileCurrent(const std::filesystem::path& meshPath, const std::filesystem::path& textPath);
+
+// Where Mesh::LoadMesh caches the conversion of textPath: a file named after the text file and a hash of its absolute
+// path in a duck/meshes directory of the temporary directory. Empty if there is no temporary directory.
+std::filesystem::path MeshCachePath(const std::filesystem::path& textPath);
+
+// Read-only mapping of a mesh file. The vertices and indices are views of the mapped file, nothing is parsed or copied
+// and the pages are read in when they are first touched, e.g. by the upload to the GPU.
+class MappedMeshFile
+{
+  public:
+    // Throws std::ios_base::failure if the file cannot be mapped or its header and sizes do not match
+    explicit MappedMeshFile(const std::filesystem::path& meshPath);
+    ~MappedMeshFile();
+
+    MappedMeshFile(MappedMeshFile&& right) noexcept;
+    MappedMeshFile& operator=(MappedMeshFile&& right) noexcept;
+    MappedMeshFile(const MappedMeshFile&)            = delete;
+    MappedMeshFile& operator=(const MappedMeshFile&) = delete;
+
+    const MeshFileHeader& Header() const
+    {
+        return *reinterpret_cast<const MeshFileHeader*>(m_data);
+    }
+
+    std::span<const MeshVertex> Vertices() const
+    {
+        return {reinterpret_cast<const MeshVertex*>(m_data + Header().vertexOffset), Header().vertexCount};
+    }
+
+    IndexFormat IndicesFormat() const
+    {
+        return Header().indexSize == sizeof(unsigned short) ? IndexFormat::UInt16 : IndexFormat::UInt32;
+    }
+
+    // The indices in IndicesFormat()
+    std::span<const std::byte> IndexBytes() const
+    {
+        return {m_data + Header().indexOffset, static_cast<std::size_t>(Header().indexCount) * Header().indexSize};
+    }
+
+    // Copy of the mesh for the CPU side algorithms, with 32 bit indices
+    MeshData ToMeshData() const;
+
+  private:
+    void Unmap();
+
+    const std::byte* m_data;
+    std::size_t m_size;
+};
+
+} // namespace mini
@@ -0,0 +1,354 @@
+#include "pch.h"
+
+#include "meshOptimizer.h"
+#include "profiling.h"
+#include <cmath>
+#include <numeric>
+
+using namespace std;
+using namespace mini;
+using namespace DirectX;
+
+namespace
+{
+// Simulated LRU cache of OptimizeVertexCache, larger than the hardware cache so that the scores look a little ahead
+constexpr int CACHE_SIZE            = 32;
+constexpr float CACHE_DECAY_POWER   = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+// Vertices with more triangles left than that share the valence score of the last entry of the table
+constexpr unsigned int MAX_VALENCE = 32;
+
+constexpr unsigned int NO_TRIANGLE = ~0U;
+
+struct ScoreTables
+{
+    std::array<float, CACHE_SIZE> cache;
+    std::array<float, MAX_VALENCE + 1> valence;
+};
+
+const ScoreTables& Scores()
+{
+    static const auto tables = []
+    {
+        ScoreTables result;
+        for (auto i = 0; i < CACHE_SIZE; i++)
+        {
+            // The last triangle is scored equally whatever the order of its vertices
+            result.cache[i] =
+                i < 3 ? LAST_TRIANGLE_SCORE
+                      : std::pow(1.f - static_cast<float>(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        result.valence[0] = 0.f;
+        for (auto i = 1U; i <= MAX_VALENCE; i++)
+        {
+            result.valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+        return result;
+    }();
+    return tables;
+}
+
+// Vertices with few triangles left are boosted, so that no lone triangles are left behind to be drawn cold later
+float VertexScore(int cachePosition, unsigned int trianglesLeft)
+{
+    if (trianglesLeft == 0)
+    {
+        return -1.f;
+    }
+    const auto& scores = Scores();
+    return (cachePosition < 0 ? 0.f : scores.cache[cachePosition]) +
+           scores.valence[std::min(trianglesLeft, MAX_VALENCE)];
+}
+
+// FIFO cache of the hardware, a vertex is cached while fewer than cacheSize vertices were transformed after it
+class FifoCache
+{
+  public:
+    FifoCache(std::size_t vertexCount, int cacheSize)
+        : m_timestamps(vertexCount, 0), m_cacheSize(static_cast<unsigned int>(cacheSize)), m_time(m_cacheSize + 1)
+    {
+    }
+
+    // Whether the vertex was transformed
+    bool Miss(unsigned int v)
+    {
+        if (m_time - m_timestamps[v] <= m_cacheSize)
+        {
+            return false;
+        }
+        m_timestamps[v] = m_time++;
+        return true;
+    }
+
+    void Flush()
+    {
+        m_time += m_cacheSize + 1;
+    }
+
+  private:
+    std::vector<unsigned int> m_timestamps;
+    unsigned int m_cacheSize;
+    unsigned int m_time;
+};
+} // namespace
+
+VertexCacheStatistics mini::AnalyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertexCount,
+                                               int cacheSize)
+{
+    assert(IndicesInRange(indices, vertexCount));
+    FifoCache cache(vertexCount, cacheSize);
+    const auto misses = std::ranges::count_if(indices, [&cache](unsigned int v) { return cache.Miss(v); });
+    const auto triangleCount = indices.size() / 3;
+    return {triangleCount > 0 ? static_cast<float>(misses) / static_cast<float>(triangleCount) : 0.f,
+            vertexCount > 0 ? static_cast<float>(misses) / static_cast<float>(vertexCount) : 0.f};
+}
+
+void mini::OptimizeVertexCache(std::span<unsigned int> indices, std::size_t vertexCount)
+{
+    PROFILE_ZONE("OptimizeVertexCache");
+    assert(IndicesInRange(indices, vertexCount));
+    const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+
+    // Triangles of every vertex, the first trianglesLeft[v] from offsets[v] are the ones not emitted yet
+    std::vector<unsigned int> trianglesLeft(vertexCount, 0);
+    for (const auto v : indices.first(triangleCount * 3))
+    {
+        trianglesLeft[v]++;
+    }
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    std::inclusive_scan(trianglesLeft.begin(), trianglesLeft.end(), offsets.begin() + 1);
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    {
+        auto next = offsets;
+        for (auto t = 0U; t < triangleCount; t++)
+        {
+            for (auto k = 0; k < 3; k++)
+            {
+                adjacency[next[indices[t * 3 + k]]++] = t;
+            }
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (auto v = 0U; v < vertexCount; v++)
+    {
+        vertexScores[v] = VertexScore(-1, trianglesLeft[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    for (auto t = 0U; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> result(triangleCount * 3);
+
+    std::array<unsigned int, CACHE_SIZE + 3> cache, nextCache;
+    auto cacheCount = 0;
+    auto best       = static_cast<unsigned int>(std::ranges::max_element(triangleScores) - triangleScores.begin());
+    // Where the search for a triangle starts when none of the cached vertices has triangles left
+    auto nextUnemitted = 0U;
+    for (auto n = 0U; n < triangleCount; n++)
+    {
+        if (best == NO_TRIANGLE)
+        {
+            while (emitted[nextUnemitted])
+            {
+                nextUnemitted++;
+            }
+            best = nextUnemitted;
+        }
+        emitted[best]         = 1;
+        const auto* const tri = &indices[best * 3];
+        std::copy_n(tri, 3, &result[n * 3]);
+
+        // Removes the triangle from the triangles left of its vertices and moves them to the front of the cache
+        auto nextCount = 0;
+        for (auto k = 0; k < 3; k++)
+        {
+            const auto v     = tri[k];
+            const auto begin = adjacency.begin() + offsets[v];
+            const auto end   = begin + trianglesLeft[v];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            trianglesLeft[v]--;
+            if (std::find(nextCache.begin(), nextCache.begin() + nextCount, v) == nextCache.begin() + nextCount)
+            {
+                nextCache[nextCount++] = v;
+            }
+        }
+        for (auto i = 0; i < cacheCount; i++)
+        {
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+            {
+                nextCache[nextCount++] = cache[i];
+            }
+        }
+        std::swap(cache, nextCache);
+        cacheCount = std::min(nextCount, CACHE_SIZE);
+
+        // Rescores the vertices that moved or fell out of the cache and the triangles they have left
+        for (auto i = 0; i < nextCount; i++)
+        {
+            const auto v     = cache[i];
+            cachePosition[v] = i < CACHE_SIZE ? i : -1;
+            const auto score = VertexScore(cachePosition[v], trianglesLeft[v]);
+            const auto delta = score - vertexScores[v];
+            vertexScores[v]  = score;
+            const auto begin = adjacency.begin() + offsets[v];
+            for (auto it = begin; it != begin + trianglesLeft[v]; ++it)
+            {
+                triangleScores[*it] += delta;
+            }
+        }
+
+        // The next triangle is the best one with a cached vertex
+        best           = NO_TRIANGLE;
+        auto bestScore = -1.f;
+        for (auto i = 0; i < cacheCount; i++)
+        {
+            const auto v     = cache[i];
+            const auto begin = adjacency.begin() + offsets[v];
+            for (auto it = begin; it != begin + trianglesLeft[v]; ++it)
+            {
+                if (triangleScores[*it] > bestScore)
+                {
+                    best      = *it;
+                    bestScore = triangleScores[*it];
+                }
+            }
+        }
+    }
+    std::ranges::copy(result, indices.begin());
+}
+
+void mini::OptimizeOverdraw(std::span<unsigned int> indices, std::span<const XMFLOAT3> positions, float threshold)
+{
+    PROFILE_ZONE("OptimizeOverdraw");
+    assert(IndicesInRange(indices, positions.size()));
+    const auto triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Misses of every triangle in the current order, a triangle missing all its vertices restarts the cache
+    std::vector<unsigned int> misses(triangleCount, 0);
+    {
+        FifoCache cache(positions.size(), ANALYZED_CACHE_SIZE);
+        for (auto t = 0U; t < triangleCount; t++)
+        {
+            for (auto k = 0; k < 3; k++)
+            {
+                misses[t] += cache.Miss(indices[t * 3 + k]) ? 1 : 0;
+            }
+        }
+    }
+    std::vector<unsigned int> hardStarts;
+    for (auto t = 0U; t < triangleCount; t++)
+    {
+        if (t == 0 || misses[t] == 3)
+        {
+            hardStarts.push_back(t);
+        }
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Splits the hard clusters further where the part so far, drawn after any other cluster, is within the threshold
+    // of the ACMR of the whole hard cluster
+    std::vector<unsigned int> clusterStarts;
+    FifoCache cache(positions.size(), ANALYZED_CACHE_SIZE);
+    for (auto c = 0U; c + 1 < hardStarts.size(); c++)
+    {
+        const auto begin      = hardStarts[c];
+        const auto end        = hardStarts[c + 1];
+        const auto hardMisses = std::accumulate(misses.begin() + begin, misses.begin() + end, 0U);
+        const auto acmr       = static_cast<float>(hardMisses) / static_cast<float>(end - begin);
+
+        clusterStarts.push_back(begin);
+        cache.Flush();
+        auto clusterMisses = 0U;
+        for (auto t = begin; t < end; t++)
+        {
+            for (auto k = 0; k < 3; k++)
+            {
+                clusterMisses += cache.Miss(indices[t * 3 + k]) ? 1 : 0;
+            }
+            const auto size = t + 1 - clusterStarts.back();
+            if (t + 1 < end && static_cast<float>(clusterMisses) <= threshold * acmr * static_cast<float>(size))
+            {
+                clusterStarts.push_back(t + 1);
+                cache.Flush();
+                clusterMisses = 0;
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    const auto clusterCount = clusterStarts.size() - 1;
+
+    // Area weighted centroids and normals of the clusters and the centroid of the mesh
+    const auto load = [positions](unsigned int v) { return XMLoadFloat3(&positions[v]); };
+    std::vector<XMFLOAT3> centroids(clusterCount), normals(clusterCount);
+    auto meshCentroid = XMVectorZero();
+    auto meshArea     = 0.f;
+    for (auto c = 0U; c < clusterCount; c++)
+    {
+        auto centroid = XMVectorZero();
+        auto normal   = XMVectorZero();
+        auto area     = 0.f;
+        for (auto t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const auto p0 = load(indices[t * 3]), p1 = load(indices[t * 3 + 1]), p2 = load(indices[t * 3 + 2]);
+            const auto cross        = XMVector3Cross(p1 - p0, p2 - p0);
+            const auto triangleArea = XMVectorGetX(XMVector3Length(cross));
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        XMStoreFloat3(&centroids[c], area > 0.f ? centroid / area : centroid);
+        XMStoreFloat3(&normals[c], normal);
+    }
+    meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : meshCentroid;
+
+    // Clusters far out along their normal are drawn first, they face away from the rest of the mesh and occlude it
+    std::vector<float> sortKeys(clusterCount);
+    for (auto c = 0U; c < clusterCount; c++)
+    {
+        const auto normal = XMLoadFloat3(&normals[c]);
+        const auto length = XMVectorGetX(XMVector3Length(normal));
+        const auto offset = XMLoadFloat3(&centroids[c]) - meshCentroid;
+        sortKeys[c]       = length > 0.f ? XMVectorGetX(XMVector3Dot(offset, normal)) / length : 0.f;
+    }
+    std::vector<unsigned int> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0U);
+    std::ranges::stable_sort(order, [&sortKeys](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    for (const auto c : order)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    std::ranges::copy(result, indices.begin());
+}
+
+std::vector<unsigned int> mini::OptimizeVertexFetchRemap(std::span<unsigned int> indices, std::size_t vertexCount)
+{
+    PROFILE_ZONE("OptimizeVertexFetch");
+    assert(IndicesInRange(indices, vertexCount));
+    std::vector<unsigned int> remap(vertexCount, UNUSED_VERTEX);
+    auto next = 0U;
+    for (auto& v : indices)
+    {
+        if (remap[v] == UNUSED_VERTEX)
+        {
+            remap[v] = next++;
+        }
+        v = remap[v];
+    }
+    return remap;
+}
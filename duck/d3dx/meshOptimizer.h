@@ -0,0 +1,88 @@
+#pragma once
+
+#include "meshData.h"
+#include <span>
+#include <vector>
+
+namespace mini
+{
+
+// Post-transform vertex cache efficiency of a triangle list, measured on a FIFO cache
+struct VertexCacheStatistics
+{
+    float acmr; // average cache miss ratio: transformed vertices per triangle, from about 0.5 to 3
+    float atvr; // average transformed vertex ratio: transformed vertices per vertex, 1 at best
+};
+
+struct MeshOptimizationReport
+{
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+};
+
+// Size of the FIFO cache of AnalyzeVertexCache, about the post-transform cache of current GPUs
+inline constexpr int ANALYZED_CACHE_SIZE = 16;
+
+// Vertex index of the vertices no triangle uses in the remap of OptimizeVertexFetchRemap
+inline constexpr unsigned int UNUSED_VERTEX = ~0U;
+
+VertexCacheStatistics AnalyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertexCount,
+                                         int cacheSize = ANALYZED_CACHE_SIZE);
+
+// Reorders the triangles for the post-transform vertex cache with the linear-speed algorithm of Tom Forsyth: greedily
+// emits the triangle whose vertices score best on a simulated LRU cache and on the number of their triangles left
+void OptimizeVertexCache(std::span<unsigned int> indices, std::size_t vertexCount);
+
+// Reorders clusters of the triangles left by OptimizeVertexCache, so that the clusters facing out of the mesh are drawn
+// first and occlude the rest from most directions. A cluster ends where the cache restarts, or earlier where its ACMR
+// is within `threshold` times the ACMR up to the restart, so a larger threshold gives finer clusters and a worse cache.
+void OptimizeOverdraw(std::span<unsigned int> indices, std::span<const DirectX::XMFLOAT3> positions,
+                      float threshold = 1.05f);
+
+// Renumbers the vertices in the order of their first use, so that the vertex fetch reads the vertex buffer forward.
+// Rewrites the indices and returns the new index of every vertex, UNUSED_VERTEX for the vertices no triangle uses.
+std::vector<unsigned int> OptimizeVertexFetchRemap(std::span<unsigned int> indices, std::size_t vertexCount);
+
+// Vertex is any type with an XMFLOAT3 position
+template <typename Vertex>
+void OptimizeOverdraw(std::span<unsigned int> indices, const std::vector<Vertex>& vertices, float threshold = 1.05f)
+{
+    std::vector<DirectX::XMFLOAT3> positions(vertices.size());
+    std::ranges::transform(vertices, positions.begin(), [](const Vertex& v) { return v.position; });
+    OptimizeOverdraw(indices, std::span<const DirectX::XMFLOAT3>(positions), threshold);
+}
+
+// Reorders the vertices as OptimizeVertexFetchRemap, dropping the unused ones
+template <typename Vertex> void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::span<unsigned int> indices)
+{
+    const auto remap = OptimizeVertexFetchRemap(indices, vertices.size());
+    std::vector<Vertex> reordered(vertices.size() - std::ranges::count(remap, UNUSED_VERTEX));
+    for (auto v = 0U; v < vertices.size(); v++)
+    {
+        if (remap[v] != UNUSED_VERTEX)
+        {
+            reordered[remap[v]] = vertices[v];
+        }
+    }
+    vertices = std::move(reordered);
+}
+
+// The whole pass for a CPUMesh or a MeshData: vertex cache order, optionally the overdraw order, then the vertex fetch
+// order. The statistics are those of the triangle order before and after.
+template <typename Vertex>
+MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                    bool overdraw = false)
+{
+    MeshOptimizationReport report;
+    report.before = AnalyzeVertexCache(indices, vertices.size());
+    OptimizeVertexCache(indices, vertices.size());
+    if (overdraw)
+    {
+        OptimizeOverdraw(std::span<unsigned int>(indices), vertices);
+    }
+    OptimizeVertexFetch(vertices, indices);
+    report.after = AnalyzeVertexCache(indices, vertices.size());
+    return report;
+}
+
+} // namespace mini
@@ -3,8 +3,10 @@
 #include "duckDemo.h"
 #include "mesh.h"
 #include "path.h"
+#include "surfaceUpload.h"
 
 #include <iostream>
+#include <random>
 
 using namespace mini;
 using namespace gk2;
@@ -13,8 +15,30 @@ using namespace std;
 
 const XMFLOAT4 DuckDemo::LIGHT_POS[2]     = {{0.0f, 4.f, 2.0f, 1.0f}, {3.f, 4.f, 0.0f, 1.0f}};
 const XMFLOAT4 DuckDemo::ROOM_WALLS_COLOR = {0.8f, 0.8f, 0.4f, 1.f};
+const XMFLOAT2 DuckDemo::DUCK_AREA_MIN    = {-ROOM_SIZE / 3.f, -ROOM_SIZE / 3.f};
+const XMFLOAT2 DuckDemo::DUCK_AREA_MAX    = {ROOM_SIZE / 3.f, ROOM_SIZE / 3.f};
 
-DuckDemo::DuckDemo(HINSTANCE appInstance)
+namespace
+{
+DXGI_FORMAT WaterNormalMapFormat(NormalMapEncoding encoding)
+{
+    switch (encoding)
+    {
+    case NormalMapEncoding::RG8:
+        return DXGI_FORMAT_R8G8_UNORM;
+    case NormalMapEncoding::BC5:
+        return DXGI_FORMAT_BC5_UNORM;
+    case NormalMapEncoding::R16F:
+        return DXGI_FORMAT_R16_FLOAT;
+    case NormalMapEncoding::R32F:
+        return DXGI_FORMAT_R32_FLOAT;
+    default:
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+} // namespace
+
+DuckDemo::DuckDemo(HINSTANCE appInstance, const DuckDemoOptions& options)
     : DxApplication(appInstance, 1280, 720, L"Kaczucha"),
       // Constant Buffers
       m_cbWorldMtx(m_device->CreateConstantBuffer<XMFLOAT4X4>()),   //
@@ -23,9 +47,55 @@ DuckDemo::DuckDemo(HINSTANCE appInstance)
       m_cbViewMtx(m_device->CreateConstantBuffer<XMFLOAT4X4, 2>()), //
       m_cbSurfaceColor(m_device->CreateConstantBuffer<XMFLOAT4>()), //
       m_cbLightPos(m_device->CreateConstantBuffer<XMFLOAT4, 2>()),  //
-      m_orbitCamera(XMFLOAT3(0, 0, 0.f)),
-      m_duckSimulation({-ROOM_SIZE / 3.f, -ROOM_SIZE / 3.f}, {ROOM_SIZE / 3.f, ROOM_SIZE / 3.f})
+      m_cbWaterParams(m_device->CreateConstantBuffer<XMINT4>()),    //
+      m_orbitCamera(XMFLOAT3(0, 0, 0.f)), m_waterSimulation(options.waterSamples),
+      m_duckSimulation(DUCK_AREA_MIN, DUCK_AREA_MAX),
+      m_partialWaterUpload(options.partialWaterUpload && !options.asyncWaterSimulation && !options.oceanWater &&
+                           !options.shallowWater)
 {
+    m_waterSimulation.SetNormalEncoding(options.waterNormalEncoding);
+    m_waterSimulation.SetTemporalBlocking(options.temporalWaterBlocking);
+
+    const auto seed = options.seed.value_or(std::random_device{}());
+    m_waterSimulation.Seed(seed);
+    m_duckSimulation.Seed(seed);
+    if (options.oceanWater)
+    {
+        // The ocean is synthesized from scratch every frame, it has no drops, dirty regions or a thread of its own
+        OceanParameters parameters;
+        parameters.spectrum = options.oceanSpectrum;
+        m_oceanSimulation.emplace(options.waterSamples, parameters);
+        m_oceanSimulation->SetNormalEncoding(options.waterNormalEncoding);
+    }
+    else if (options.shallowWater)
+    {
+        // The duck is a floating body of the shallow water instead of a source of drops
+        m_shallowWaterSimulation.emplace(options.waterSamples);
+        m_shallowWaterSimulation->SetNormalEncoding(options.waterNormalEncoding);
+        m_duckBody = m_shallowWaterSimulation->AddFloatingBody(DUCK_RADIUS / ROOM_SIZE, DUCK_DRAFT / ROOM_SIZE);
+    }
+    else if (options.adaptiveWaterQuality)
+    {
+        m_waterQualityGovernor.emplace(m_waterSimulation.SamplesCount());
+        if (m_waterQualityGovernor->SamplesCount() != m_waterSimulation.SamplesCount())
+        {
+            m_waterSimulation.Resize(m_waterQualityGovernor->SamplesCount());
+        }
+    }
+
+    if (!options.recordPath.empty())
+    {
+        if (m_oceanSimulation || m_shallowWaterSimulation)
+        {
+            std::println("Only the wave equation water can be recorded, the recording is off");
+        }
+        else
+        {
+            m_recordPath = options.recordPath;
+            m_recording.emplace(seed, m_waterSimulation.SamplesCount(), options.temporalWaterBlocking, DUCK_AREA_MIN,
+                                DUCK_AREA_MAX);
+        }
+    }
 
     // Projection matrix
     auto s  = m_window.getClientSize();
@@ -56,7 +126,19 @@ DuckDemo::DuckDemo(HINSTANCE appInstance)
     auto texturesDir  = Path::TexturesDir();
     m_envTextureView  = m_device->CreateShaderResourceView(texturesDir / "output_skybox.dds");
     m_duckTextureView = m_device->CreateShaderResourceView(texturesDir / "ducktex.jpg");
-    CreateWaterSurfaceTexture();
+    if (m_oceanSimulation)
+    {
+        CreateWaterSurfaceTexture(m_oceanSimulation->SamplesCount(), m_oceanSimulation->NormalEncoding());
+    }
+    else if (m_shallowWaterSimulation)
+    {
+        CreateWaterSurfaceTexture(m_shallowWaterSimulation->SamplesCount(),
+                                  m_shallowWaterSimulation->NormalEncoding());
+    }
+    else
+    {
+        CreateWaterSurfaceTexture(m_waterSimulation.SamplesCount(), m_waterSimulation.NormalEncoding());
+    }
 
     //  Shaders
     auto shadersDir = Path::ShadersDir();
@@ -97,23 +179,47 @@ DuckDemo::DuckDemo(HINSTANCE appInstance)
         vsb); // Vertex Shaders - 0: worldMtx, 1: viewMtx,invViewMtx, 2: projMtx, 3: texMtx
     ID3D11Buffer* gsb[] = {m_cbProjMtx.get(), m_cbViewMtx.get(), m_cbLightPos.get()};
     m_device->context()->GSSetConstantBuffers(0, 3, gsb); // Geometry Shaders - 0: projMtx, 1: viewMtx, 2: lightPos[2]
-    ID3D11Buffer* psb[] = {m_cbSurfaceColor.get(), m_cbLightPos.get(), m_cbViewMtx.get()};
-    m_device->context()->PSSetConstantBuffers(0, 3, psb); // Pixel Shaders - 0: surfaceColor, 1: lightPos[2], 2: ViewMtx
+    ID3D11Buffer* psb[] = {m_cbSurfaceColor.get(), m_cbLightPos.get(), m_cbViewMtx.get(), m_cbWaterParams.get()};
+    m_device->context()->PSSetConstantBuffers(
+        0, 4, psb); // Pixel Shaders - 0: surfaceColor, 1: lightPos[2], 2: ViewMtx, 3: waterParams
+
+    if (options.asyncWaterSimulation && !m_oceanSimulation && !m_shallowWaterSimulation)
+    {
+        m_asyncWaterSimulation.emplace(m_waterSimulation);
+    }
+    ScheduleSimulations();
 }
 
-void mini::gk2::DuckDemo::CreateWaterSurfaceTexture()
+mini::gk2::DuckDemo::~DuckDemo()
+{
+    if (!m_recording)
+    {
+        return;
+    }
+    if (m_recording->Save(m_recordPath))
+    {
+        std::println("Recorded {} events with seed {} to {}", m_recording->Events().size(), m_recording->Seed(),
+                     m_recordPath.string());
+    }
+    else
+    {
+        std::println("Failed to save the recording to {}", m_recordPath.string());
+    }
+}
+
+void mini::gk2::DuckDemo::CreateWaterSurfaceTexture(int samplesCount, NormalMapEncoding encoding)
 {
     D3D11_TEXTURE2D_DESC desc = {};
-    desc.Width                = WaterSurfaceSimulation::SAMPLES_DEFAULT_SIZE;
-    desc.Height               = WaterSurfaceSimulation::SAMPLES_DEFAULT_SIZE;
+    desc.Width                = samplesCount;
+    desc.Height               = samplesCount;
     desc.MipLevels            = 1;
     desc.ArraySize            = 1;
-    desc.Format               = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.Format               = WaterNormalMapFormat(encoding);
     desc.SampleDesc.Count     = 1;
     desc.SampleDesc.Quality   = 0;
-    desc.Usage                = D3D11_USAGE_DYNAMIC;
+    desc.Usage                = m_partialWaterUpload ? D3D11_USAGE_DEFAULT : D3D11_USAGE_DYNAMIC;
     desc.BindFlags            = D3D11_BIND_SHADER_RESOURCE;
-    desc.CPUAccessFlags       = D3D11_CPU_ACCESS_WRITE;
+    desc.CPUAccessFlags       = m_partialWaterUpload ? 0 : D3D11_CPU_ACCESS_WRITE;
     desc.MiscFlags            = 0;
 
     m_waterSurfaceTexture = m_device->CreateTexture(desc);
@@ -124,6 +230,174 @@ void mini::gk2::DuckDemo::CreateWaterSurfaceTexture()
     srvDesc.Texture2D.MipLevels             = 1;
 
     m_waterSurfaceTextureView = m_device->CreateShaderResourceView(m_waterSurfaceTexture);
+    m_waterTextureSamples     = samplesCount;
+    m_waterTextureEncoding    = encoding;
+
+    // The shaders rebuild the normals from the two channel and the height formats
+    UpdateBuffer(m_cbWaterParams, XMINT4(static_cast<int>(encoding), 0, 0, 0));
+
+    // The new texture is empty, so the next upload has to cover all of it
+    if (m_partialWaterUpload)
+    {
+        m_waterSimulation.SurfaceDirtyRegions().MarkAll();
+    }
+}
+
+void mini::gk2::DuckDemo::ScheduleSimulations()
+{
+    if (m_oceanSimulation)
+    {
+        m_waterHandle = m_scheduler.Add(*m_oceanSimulation);
+    }
+    else if (m_shallowWaterSimulation)
+    {
+        m_waterHandle = m_scheduler.Add(*m_shallowWaterSimulation);
+    }
+    else if (!m_asyncWaterSimulation)
+    {
+        m_waterHandle = m_scheduler.Add(m_waterSimulation);
+    }
+
+    if (m_shallowWaterSimulation)
+    {
+        // The duck bobs and tilts with the water under it, so it waits for the step of the water
+        const auto sampleWater = [this]()
+        {
+            const auto& f      = m_duckSimulation.GetCurrentFrame();
+            const auto x       = (XMVectorGetX(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE;
+            const auto y       = (XMVectorGetZ(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE;
+            const auto surface = m_shallowWaterSimulation->SampleSurface(x, y, DUCK_RADIUS / ROOM_SIZE);
+            m_duckSimulation.SetWaterSurface(surface.height * ROOM_SIZE, {surface.slopeX, surface.slopeY});
+        };
+        m_duckHandle = m_scheduler.Add(m_duckSimulation, {m_waterHandle});
+        m_scheduler.SetBeforeUpdate(m_duckHandle, sampleWater);
+    }
+    else
+    {
+        // The other waters only hear from the duck through its drops, the two run side by side
+        m_duckHandle = m_scheduler.Add(m_duckSimulation);
+    }
+
+    // The drop reaches the water once both finished the frame, in time for the next step of the water as before
+    const auto drop = [this](float dropX, float dropY)
+    {
+        if (m_recording)
+        {
+            m_recording->RecordDrop(dropX, dropY, DUCK_DROP_CHANCE);
+        }
+        if (m_asyncWaterSimulation)
+        {
+            m_asyncWaterSimulation->DropAt(dropX, dropY, DUCK_DROP_CHANCE);
+        }
+        else if (m_shallowWaterSimulation)
+        {
+            m_shallowWaterSimulation->MoveFloatingBody(m_duckBody, dropX, dropY);
+        }
+        else if (!m_oceanSimulation)
+        {
+            m_waterSimulation.DropAt(dropX, dropY, DUCK_DROP_CHANCE);
+        }
+    };
+    const auto postDrop = [this, drop](bool updated)
+    {
+        if (!updated)
+        {
+            return;
+        }
+        const auto& f    = m_duckSimulation.GetCurrentFrame();
+        const auto dropX = (XMVectorGetX(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE;
+        const auto dropY = (XMVectorGetZ(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE;
+        m_scheduler.Post(m_duckHandle, [drop, dropX, dropY]() { drop(dropX, dropY); });
+    };
+    m_scheduler.SetAfterUpdate(m_duckHandle, postDrop);
+}
+
+void mini::gk2::DuckDemo::UpdateWaterTexture()
+{
+    if (m_asyncWaterSimulation)
+    {
+        const auto* frame = m_asyncWaterSimulation->FetchFrame();
+        if (frame == nullptr)
+        {
+            return;
+        }
+
+        UpdateWaterQuality(frame->simulationMs);
+        if (frame->samplesCount != m_waterTextureSamples || frame->encoding != m_waterTextureEncoding)
+        {
+            CreateWaterSurfaceTexture(frame->samplesCount, frame->encoding);
+        }
+        MapSurfaceTexture(*m_device, m_waterSurfaceTexture, frame->textureData.data(), frame->rowPitch, frame->rows);
+        return;
+    }
+
+    const auto waterUpdated = m_scheduler.Updated(m_waterHandle);
+    if (m_oceanSimulation)
+    {
+        if (waterUpdated)
+        {
+            MapSurfaceTexture(*m_device, m_waterSurfaceTexture, *m_oceanSimulation);
+        }
+        return;
+    }
+
+    if (m_shallowWaterSimulation)
+    {
+        if (waterUpdated)
+        {
+            MapSurfaceTexture(*m_device, m_waterSurfaceTexture, *m_shallowWaterSimulation);
+        }
+        return;
+    }
+
+    // The governor is fed the time of the water alone, the duck running next to it does not count
+    if (UpdateWaterQuality(m_scheduler.UpdateMs(m_waterHandle)) || waterUpdated)
+    {
+        if (m_partialWaterUpload)
+        {
+            UploadSurfaceTexture(*m_device, m_waterSurfaceTexture, m_waterSimulation);
+        }
+        else
+        {
+            MapSurfaceTexture(*m_device, m_waterSurfaceTexture, m_waterSimulation);
+        }
+    }
+}
+
+bool mini::gk2::DuckDemo::UpdateWaterQuality(double simulationMs)
+{
+    if (!m_waterQualityGovernor)
+    {
+        return false;
+    }
+
+    const auto previousSamplesCount = m_waterQualityGovernor->SamplesCount();
+    const auto samplesCount         = m_waterQualityGovernor->Update(simulationMs);
+    if (samplesCount == previousSamplesCount)
+    {
+        return false;
+    }
+
+    std::println("Water resolution: {} -> {} (simulation {:.2f} ms)", previousSamplesCount, samplesCount, simulationMs);
+    if (m_asyncWaterSimulation)
+    {
+        // The texture is recreated once the first frame of the new size arrives
+        m_asyncWaterSimulation->Resize(samplesCount);
+        if (m_recording)
+        {
+            m_recording->RecordResize(samplesCount);
+        }
+        return false;
+    }
+
+    // BC5 falls back to RG8 for sizes that are not a multiple of the block size
+    m_waterSimulation.Resize(samplesCount);
+    if (m_recording)
+    {
+        m_recording->RecordResize(samplesCount);
+    }
+    CreateWaterSurfaceTexture(m_waterSimulation.SamplesCount(), m_waterSimulation.NormalEncoding());
+    return true;
 }
 
 void mini::gk2::DuckDemo::CreateRenderStates()
@@ -209,25 +483,29 @@ void DuckDemo::HandleControls(double dt)
 void DuckDemo::Update(const Clock& c)
 {
     double dt = c.getFrameTime();
-    if (m_waterSimulation.Update(dt))
+    if (m_recording)
     {
-        m_waterSimulation.MapToSurfaceTexture(*m_device, m_waterSurfaceTexture);
+        m_recording->RecordFrame(dt);
     }
-    if (m_duckSimulation.Update(dt))
-    {
-        const auto& f = m_duckSimulation.GetCurrentFrame();
-        XMMATRIX transformation =
-            XMMatrixScaling(DUCK_SCALE, DUCK_SCALE, DUCK_SCALE) *
-            XMMATRIX(-f.tangent,             //
-                     f.normal, f.bitangent,  //
-                     XMVectorSet(0, 0, 0, 1) //
-                     ) *
-            XMMatrixTranslation(XMVectorGetX(f.pos), WATER_LEVEL + DUCK_HEIGHT, XMVectorGetZ(f.pos));
-        DirectX::XMStoreFloat4x4(&m_duckMtx, transformation);
 
-        m_waterSimulation.DropAt((XMVectorGetX(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE,
-                                 (XMVectorGetZ(f.pos) + ROOM_SIZE / 2.f) / ROOM_SIZE, 0.8f);
+    // The water and the duck run concurrently, the asynchronous water only receives the frame time here
+    if (m_asyncWaterSimulation)
+    {
+        m_asyncWaterSimulation->Update(dt);
     }
+    m_scheduler.Update(dt);
+    UpdateWaterTexture();
+
+    // Drawn between the last two steps, so that the duck moves smoothly whatever the ratio of the frame and step rates
+    const auto f = m_duckSimulation.InterpolatedFrame();
+    XMMATRIX transformation =
+        XMMatrixScaling(DUCK_SCALE, DUCK_SCALE, DUCK_SCALE) *
+        XMMATRIX(-f.tangent,             //
+                 f.normal, f.bitangent,  //
+                 XMVectorSet(0, 0, 0, 1) //
+                 ) *
+        XMMatrixTranslation(XMVectorGetX(f.pos), WATER_LEVEL + DUCK_HEIGHT + XMVectorGetY(f.pos), XMVectorGetZ(f.pos));
+    DirectX::XMStoreFloat4x4(&m_duckMtx, transformation);
 
     HandleCameraInput(dt);
     HandleControls(dt);
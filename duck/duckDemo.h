@@ -1,29 +1,61 @@
 #pragma once
+#include "asyncWaterSimulation.h"
 #include "duckSimulation.h"
 #include "dxApplication.h"
 #include "mesh.h"
+#include "oceanSimulation.h"
 #include "shaderPass.h"
+#include "shallowWaterSimulation.h"
+#include "simulationRecording.h"
+#include "simulationScheduler.h"
+#include "waterQualityGovernor.h"
 #include "waterSurfaceSimulation.h"
+#include <filesystem>
+#include <optional>
 
 namespace mini::gk2
 {
 
+struct DuckDemoOptions
+{
+    int waterSamples                      = WaterSurfaceSimulation::SAMPLES_DEFAULT_SIZE;
+    bool adaptiveWaterQuality             = false; // let WaterQualityGovernor change the resolution at runtime
+    bool partialWaterUpload               = false; // default-usage normal map updated with dirty rectangles
+    bool asyncWaterSimulation             = false; // simulate the water on its own thread, implies full uploads
+    bool temporalWaterBlocking            = false; // step the water tiles several steps at a time
+    bool oceanWater                       = false; // spectral ocean instead of the wave equation, full uploads only
+    OceanSpectrum oceanSpectrum           = OceanSpectrum::Phillips;
+    bool shallowWater                     = false; // shallow water the duck pushes and rides on, full uploads only
+    NormalMapEncoding waterNormalEncoding = NormalMapEncoding::RGBA8; // format of the water normal map texture
+    std::optional<std::uint32_t> seed;    // of the water and the duck, random when not set
+    std::filesystem::path recordPath;     // the inputs of the simulations are saved there on exit when not empty
+};
+
 class DuckDemo : public DxApplication
 {
   public:
     using Base = DxApplication;
 
-    explicit DuckDemo(HINSTANCE appInstance);
-    ~DuckDemo() final = default;
+    explicit DuckDemo(HINSTANCE appInstance, const DuckDemoOptions& options = {});
+    ~DuckDemo() final;
 
   protected:
     void Update(const Clock& c) override;
     void Render() override;
 
   private:
-    void CreateWaterSurfaceTexture();
+    void CreateWaterSurfaceTexture(int samplesCount, NormalMapEncoding encoding);
     void CreateRenderStates();
 
+    // Adds the water and the duck to m_scheduler with the callbacks coupling them
+    void ScheduleSimulations();
+
+    // Uploads the normal map of the water when the last frame changed it
+    void UpdateWaterTexture();
+
+    // Feeds the governor, returns true if the water grid (and its texture) has been resized
+    bool UpdateWaterQuality(double simulationMs);
+
     void HandleControls(double dt);
     bool HandleCameraInput(double dt);
 
@@ -54,14 +86,19 @@ class DuckDemo : public DxApplication
     // can't have in-class initializer since XMFLOAT... types' constructors are not constexpr
     static const DirectX::XMFLOAT4 LIGHT_POS[2];
     static const DirectX::XMFLOAT4 ROOM_WALLS_COLOR;
-    static constexpr size_t PUMA_PARTS    = 6;
-    static constexpr size_t ANGLE_COUNT   = 5;
-    static constexpr float ROOM_SIZE      = 10.f;
-    static constexpr float ROTATION_SPEED = 7.f;
-    static constexpr float ZOOM_SPEED     = 5.f;
-    static constexpr float DUCK_SCALE     = 1.f / 200.f;
-    static constexpr float WATER_LEVEL    = -2.6f; // REMEMBER TO MODIFY waterVS
-    static constexpr float DUCK_HEIGHT    = 1.24f;
+    static const DirectX::XMFLOAT2 DUCK_AREA_MIN; // the duck swims within the middle third of the room
+    static const DirectX::XMFLOAT2 DUCK_AREA_MAX;
+    static constexpr size_t PUMA_PARTS      = 6;
+    static constexpr size_t ANGLE_COUNT     = 5;
+    static constexpr float ROOM_SIZE        = 10.f;
+    static constexpr float ROTATION_SPEED   = 7.f;
+    static constexpr float ZOOM_SPEED       = 5.f;
+    static constexpr float DUCK_SCALE       = 1.f / 200.f;
+    static constexpr float WATER_LEVEL      = -2.6f; // REMEMBER TO MODIFY waterVS
+    static constexpr float DUCK_HEIGHT      = 1.24f;
+    static constexpr float DUCK_RADIUS      = 0.4f;  // footprint of the duck on the shallow water
+    static constexpr float DUCK_DRAFT       = 0.03f; // depth of the water the duck pushes aside
+    static constexpr float DUCK_DROP_CHANCE = 0.8f;  // of a drop under the duck every duck update
 
 #pragma endregion
 
@@ -73,6 +110,7 @@ class DuckDemo : public DxApplication
 
     dx_ptr<ID3D11Buffer> m_cbSurfaceColor; // pixel shader constant buffer slot 0
     dx_ptr<ID3D11Buffer> m_cbLightPos;     // pixel shader constant buffer slot 1
+    dx_ptr<ID3D11Buffer> m_cbWaterParams;  // pixel shader constant buffer slot 3
 #pragma endregion
 
 #pragma region MESHES
@@ -104,6 +142,8 @@ class DuckDemo : public DxApplication
     dx_ptr<ID3D11ShaderResourceView> m_envTextureView;
     dx_ptr<ID3D11ShaderResourceView> m_waterSurfaceTextureView;
     dx_ptr<ID3D11Texture2D> m_waterSurfaceTexture;
+    int m_waterTextureSamples                 = 0;
+    NormalMapEncoding m_waterTextureEncoding = NormalMapEncoding::RGBA8;
 
     dx_ptr<ID3D11VertexShader> m_phongVS;
     dx_ptr<ID3D11PixelShader> m_phongPS;
@@ -126,7 +166,25 @@ class DuckDemo : public DxApplication
 #pragma endregion
 
     WaterSurfaceSimulation m_waterSimulation;
+    std::optional<OceanSimulation> m_oceanSimulation;               // replaces m_waterSimulation when present
+    std::optional<ShallowWaterSimulation> m_shallowWaterSimulation; // replaces m_waterSimulation when present
+    int m_duckBody = 0;                                             // floating body of the duck in the shallow water
     DuckSimulation m_duckSimulation;
+
+    // Updates the water and the duck concurrently, the asynchronous water runs on its own thread and is not part of it
+    SimulationScheduler m_scheduler;
+    SimulationScheduler::Handle m_waterHandle = -1;
+    SimulationScheduler::Handle m_duckHandle  = -1;
+
+    std::optional<WaterQualityGovernor> m_waterQualityGovernor;
+    bool m_partialWaterUpload;
+
+    // Inputs of the water and the duck, saved to m_recordPath when the demo closes
+    std::optional<SimulationRecording> m_recording;
+    std::filesystem::path m_recordPath;
+
+    // Owns the thread running m_waterSimulation, declared last so it stops before anything else is destroyed
+    std::optional<AsyncWaterSimulation> m_asyncWaterSimulation;
 };
 
 } // namespace mini::gk2
\ No newline at end of file
@@ -1,15 +1,28 @@
 #include "pch.h"
 
 #include "duckSimulation.h"
+#include "utils/hashCombine.h"
 #include "utils/profiling.h"
 #include <algorithm>
 #include <ranges>
 
+namespace
+{
+mini::gk2::ArcLengthTable ArcLengthOf(const std::array<DirectX::XMFLOAT2, 4>& points)
+{
+    const float x[4] = {points[0].x, points[1].x, points[2].x, points[3].x};
+    const float y[4] = {points[0].y, points[1].y, points[2].y, points[3].y};
+    return mini::gk2::BuildArcLengthTable(x, y);
+}
+} // namespace
+
 mini::gk2::DuckSimulation::DuckSimulation(DirectX::XMFLOAT2 min, DirectX::XMFLOAT2 max)
-    : m_uniformDistX(min.x, max.x), m_uniformDistY(min.y, max.y)
+    : m_tParam(0.0), m_distance(0.0), m_waterHeight(0.f), m_uniformDistX(min.x, max.x), m_uniformDistY(min.y, max.y)
 {
     InitDeBoorPoints();
     m_frame.normal = DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f);
+    EvaluateFrame();
+    m_previousFrame = m_frame;
 }
 
 const mini::gk2::DuckSimulation::Frame& mini::gk2::DuckSimulation::GetCurrentFrame()
@@ -17,9 +30,61 @@ const mini::gk2::DuckSimulation::Frame& mini::gk2::DuckSimulation::GetCurrentFra
     return m_frame;
 }
 
+mini::gk2::DuckSimulation::Frame mini::gk2::DuckSimulation::InterpolatedFrame() const
+{
+    using namespace DirectX;
+    const auto alpha = static_cast<float>(InterpolationAlpha());
+
+    // Normalized linear blend, the tangent is made orthogonal to the normal again as in Step()
+    Frame frame;
+    frame.pos       = XMVectorLerp(m_previousFrame.pos, m_frame.pos, alpha);
+    frame.normal    = XMVector3Normalize(XMVectorLerp(m_previousFrame.normal, m_frame.normal, alpha));
+    const auto t    = XMVectorLerp(m_previousFrame.tangent, m_frame.tangent, alpha);
+    frame.tangent   = XMVector3Normalize(t - XMVector3Dot(t, frame.normal) * frame.normal);
+    frame.bitangent = XMVector3Normalize(XMVector3Cross(frame.normal, frame.tangent));
+    return frame;
+}
+
+void mini::gk2::DuckSimulation::SetWaterSurface(float height, DirectX::XMFLOAT2 slope)
+{
+    m_waterHeight  = height;
+    m_frame.normal = DirectX::XMVector3Normalize(DirectX::XMVectorSet(-slope.x, 1.f, -slope.y, 0.f));
+}
+
+void mini::gk2::DuckSimulation::Seed(std::uint32_t seed)
+{
+    m_randGenerator.seed(seed);
+    m_uniformDistX.reset();
+    m_uniformDistY.reset();
+    m_tParam   = 0.0;
+    m_distance = 0.0;
+    InitDeBoorPoints();
+    EvaluateFrame();
+    m_previousFrame = m_frame;
+}
+
+std::uint64_t mini::gk2::DuckSimulation::StateHash() const
+{
+    auto hash = HashBytes(m_points.data(), sizeof(m_points));
+    hash      = HashBytes(&m_tParam, sizeof(m_tParam), hash);
+    hash      = HashBytes(&m_distance, sizeof(m_distance), hash);
+    return HashBytes(&m_frame, sizeof(m_frame), hash);
+}
+
 void mini::gk2::DuckSimulation::Step()
 {
     PROFILE_ZONE("DuckSimulation::Step");
+    m_previousFrame = m_frame;
+    EvaluateFrame();
+
+    // Constant speed along the path: the distance advances uniformly and the table maps it to the parameter
+    m_distance += SWIM_SPEED * StepTime();
+    UpdateDeBoorPoints();
+    m_tParam = m_arcLength.ParameterAt(static_cast<float>(m_distance));
+}
+
+void mini::gk2::DuckSimulation::EvaluateFrame()
+{
     using namespace DirectX;
 
     const auto p0 = XMLoadFloat2(&m_points[0]);
@@ -43,38 +108,35 @@ void mini::gk2::DuckSimulation::Step()
     const auto b0 = u * u * u;
 
     const auto pos = bp0 * b0 + bp1 * b1 + bp2 * b2 + bp3 * b3;
-    m_frame.pos    = XMVectorSet(XMVectorGetX(pos), 0.f, XMVectorGetY(pos), 1.f);
+    m_frame.pos    = XMVectorSet(XMVectorGetX(pos), m_waterHeight, XMVectorGetY(pos), 1.f);
 
     // Find derivative (https://en.wikipedia.org/wiki/B%C3%A9zier_curve#Cubic_B%C3%A9zier_curves)
     const auto c23 = 3.f * t * t;
     const auto c12 = 6.f * u * t;
     const auto c01 = 3.f * u * u;
 
-    const auto v      = c01 * (bp1 - bp0) + c12 * (bp2 - bp1) + c23 * (bp3 - bp2);
-    m_frame.tangent   = XMVector3Normalize(XMVectorSet(XMVectorGetX(v), 0.f, XMVectorGetY(v), 0.f));
-    m_frame.bitangent = XMVector3Normalize(XMVector3Cross(m_frame.normal, m_frame.tangent));
+    const auto v = c01 * (bp1 - bp0) + c12 * (bp2 - bp1) + c23 * (bp3 - bp2);
 
-    m_tParam += ANIMATION_SPEED * StepTime();
-}
-
-void mini::gk2::DuckSimulation::PostUpdate()
-{
-    UpdateDeBoorPoints();
+    // The duck swims along the water surface, the tangent is the direction of the path projected onto it
+    const auto direction = XMVectorSet(XMVectorGetX(v), 0.f, XMVectorGetY(v), 0.f);
+    m_frame.tangent      = XMVector3Normalize(direction - XMVector3Dot(direction, m_frame.normal) * m_frame.normal);
+    m_frame.bitangent    = XMVector3Normalize(XMVector3Cross(m_frame.normal, m_frame.tangent));
 }
 
 void mini::gk2::DuckSimulation::UpdateDeBoorPoints()
 {
     PROFILE_ZONE("DuckSimulation::UpdateDeBoorPoints");
-    if (m_tParam < 1.f)
+    while (m_distance >= m_arcLength.length)
     {
-        return;
-    }
-    m_tParam -= 1.f;
+        m_distance -= m_arcLength.length;
 
-    std::ranges::rotate(m_points, m_points.begin() + 1);
-    m_points.back().x = m_uniformDistX(m_randGenerator);
-    m_points.back().y = m_uniformDistY(m_randGenerator);
+        std::ranges::rotate(m_points, m_points.begin() + 1);
+        m_points.back().x = m_uniformDistX(m_randGenerator);
+        m_points.back().y = m_uniformDistY(m_randGenerator);
+        m_arcLength       = ArcLengthOf(m_points);
+    }
 }
+
 void mini::gk2::DuckSimulation::InitDeBoorPoints()
 {
     for (auto i = 0; i < MAX_POINTS; i++)
@@ -82,4 +144,5 @@ void mini::gk2::DuckSimulation::InitDeBoorPoints()
         m_points[i].x = m_uniformDistX(m_randGenerator);
         m_points[i].y = m_uniformDistY(m_randGenerator);
     }
+    m_arcLength = ArcLengthOf(m_points);
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "arcLengthTable.h"
 #include "simulation.h"
 #include <random>
 
@@ -22,24 +23,46 @@ class DuckSimulation final : public Simulation
 
     const Frame& GetCurrentFrame();
 
-    static constexpr double ANIMATION_SPEED = 0.2;
+    // Frame between the last two steps at InterpolationAlpha(), for drawing the duck between the steps
+    Frame InterpolatedFrame() const;
+
+    // Water under the duck: height above the rest level and slope (dh/dx, dh/dz) in world units. The duck rides on it
+    // from the next step on.
+    void SetWaterSurface(float height, DirectX::XMFLOAT2 slope);
+
+    // Restarts the path from new random points, equal seeds give equal paths
+    void Seed(std::uint32_t seed);
+
+    // Hash of the path and the current frame, equal on every machine for equal states
+    std::uint64_t StateHash() const;
+
+    // World units per second along the path, whatever the spacing of the de Boor points. 0.4 is about the pace of the
+    // former 0.2 segments per second on the paths of the demo.
+    static constexpr double SWIM_SPEED = 0.4;
 
   private:
     void Step() final;
-    void PostUpdate() final;
+
+    // Frame at m_tParam on the current segment of the path
+    void EvaluateFrame();
 
     void InitDeBoorPoints();
+    // Moves on to the next segments while the distance is past the end of the current one
     void UpdateDeBoorPoints();
 
   private:
     static constexpr size_t MAX_POINTS = 4;
     std::array<DirectX::XMFLOAT2, MAX_POINTS> m_points;
-    double m_tParam;
+    double m_tParam;   // of the current segment, at m_distance along it
+    double m_distance; // from the start of the current segment
+    ArcLengthTable m_arcLength;
+    float m_waterHeight;
 
     std::mt19937 m_randGenerator;
     std::uniform_real_distribution<float> m_uniformDistX;
     std::uniform_real_distribution<float> m_uniformDistY;
 
     Frame m_frame;
+    Frame m_previousFrame; // frame before the last step
 };
 } // namespace mini::gk2
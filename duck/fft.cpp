@@ -0,0 +1,151 @@
+#include "pch.h"
+
+#include "fft.h"
+#include "utils/profiling.h"
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+mini::gk2::InverseFft2D::InverseFft2D(int size)
+    : m_size(0), m_log2Size(0), m_stride(0), m_radix2(kernels::SelectFftRadix2(kernels::DetectSimdLevel())),
+      m_radix4(kernels::SelectFftRadix4(kernels::DetectSimdLevel()))
+{
+    Resize(size);
+}
+
+void mini::gk2::InverseFft2D::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_radix2 = kernels::SelectFftRadix2(level);
+    m_radix4 = kernels::SelectFftRadix4(level);
+}
+
+void mini::gk2::InverseFft2D::Resize(int size)
+{
+    assert(size == 0 || (size > 0 && std::has_single_bit(static_cast<unsigned int>(size))));
+    m_size     = size;
+    m_log2Size = size > 0 ? std::countr_zero(static_cast<unsigned int>(size)) : 0;
+    m_stride   = size >= COLUMN_BLOCK ? size + ROW_PADDING : size;
+
+    m_bitReversed.resize(size);
+    for (auto i = 0; i < size; i++)
+    {
+        auto reversed = 0;
+        for (auto bit = 0; bit < m_log2Size; bit++)
+        {
+            reversed |= ((i >> bit) & 1) << (m_log2Size - 1 - bit);
+        }
+        m_bitReversed[i] = reversed;
+    }
+
+    // W_len^j = e^(2 pi i j / len), computed in double so that the large sizes do not accumulate rounding errors
+    const auto twiddle = [](int j, int len, float* w)
+    {
+        const auto angle = 2.0 * std::numbers::pi * j / len;
+        w[0]             = static_cast<float>(std::cos(angle));
+        w[1]             = static_cast<float>(std::sin(angle));
+    };
+    m_twiddles.clear();
+    for (auto h = m_log2Size % 2 ? 2 : 1; h < size; h *= 4)
+    {
+        for (auto k = 0; k < h; k++)
+        {
+            float w[6];
+            twiddle(k, 2 * h, w);
+            twiddle(k, 4 * h, w + 2);
+            twiddle(k + h, 4 * h, w + 4);
+            m_twiddles.insert(m_twiddles.end(), std::begin(w), std::end(w));
+        }
+    }
+
+    const auto cells = static_cast<std::size_t>(size) * m_stride;
+    m_scratchRe.assign(cells, 0.f);
+    m_scratchIm.assign(cells, 0.f);
+}
+
+void mini::gk2::InverseFft2D::Transform(float* re, float* im, ThreadPool& workers)
+{
+    PROFILE_ZONE("InverseFft2D::Transform");
+    const auto n = m_size;
+    if (n <= 1)
+    {
+        return;
+    }
+
+    auto* scratchRe = m_scratchRe.data();
+    auto* scratchIm = m_scratchIm.data();
+    ForEachBlock(n, COLUMN_BLOCK, workers, [&](int begin, int end) { TransformColumns(re, im, begin, end); });
+    Transpose(re, scratchRe, workers);
+    Transpose(im, scratchIm, workers);
+    ForEachBlock(n, COLUMN_BLOCK, workers,
+                 [&](int begin, int end) { TransformColumns(scratchRe, scratchIm, begin, end); });
+    Transpose(scratchRe, re, workers);
+    Transpose(scratchIm, im, workers);
+}
+
+void mini::gk2::InverseFft2D::TransformColumns(float* re, float* im, int begin, int end) const
+{
+    const auto n      = m_size;
+    const auto stride = static_cast<std::size_t>(m_stride);
+    const auto count  = end - begin;
+    const auto row    = [&](float* values, int i) { return values + i * stride + begin; };
+
+    // Decimation in time takes the input in bit reversed order
+    for (auto i = 0; i < n; i++)
+    {
+        const auto reversed = m_bitReversed[i];
+        if (i < reversed)
+        {
+            std::swap_ranges(row(re, i), row(re, i) + count, row(re, reversed));
+            std::swap_ranges(row(im, i), row(im, i) + count, row(im, reversed));
+        }
+    }
+
+    auto h = 1;
+    if (m_log2Size % 2)
+    {
+        for (auto group = 0; group < n; group += 2)
+        {
+            m_radix2(row(re, group), row(im, group), row(re, group + 1), row(im, group + 1), 1.f, 0.f, count);
+        }
+        h = 2;
+    }
+
+    const auto* w = m_twiddles.data();
+    for (; h < n; h *= 4)
+    {
+        for (auto group = 0; group < n; group += 4 * h)
+        {
+            for (auto k = 0; k < h; k++)
+            {
+                const auto first   = group + k;
+                float* const re4[] = {row(re, first), row(re, first + h), row(re, first + 2 * h),
+                                      row(re, first + 3 * h)};
+                float* const im4[] = {row(im, first), row(im, first + h), row(im, first + 2 * h),
+                                      row(im, first + 3 * h)};
+                m_radix4(re4, im4, w + 6 * k, count);
+            }
+        }
+        w += 6 * h;
+    }
+}
+
+void mini::gk2::InverseFft2D::Transpose(const float* src, float* dest, ThreadPool& workers) const
+{
+    const auto n      = m_size;
+    const auto stride = static_cast<std::size_t>(m_stride);
+    ForEachBlock(n, TRANSPOSE_BLOCK, workers,
+                 [&](int rowBegin, int rowEnd)
+                 {
+                     for (auto colBegin = 0; colBegin < n; colBegin += TRANSPOSE_BLOCK)
+                     {
+                         const auto colEnd = std::min(colBegin + TRANSPOSE_BLOCK, n);
+                         for (auto i = rowBegin; i < rowEnd; i++)
+                         {
+                             for (auto j = colBegin; j < colEnd; j++)
+                             {
+                                 dest[j * stride + i] = src[i * stride + j];
+                             }
+                         }
+                     }
+                 });
+}
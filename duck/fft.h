@@ -0,0 +1,76 @@
+#pragma once
+#include "threadPool.h"
+#include "waterSurfaceKernels.h"
+#include <vector>
+
+namespace mini::gk2
+{
+// Unnormalized inverse 2-D discrete Fourier transform of a size x size grid of complex values, size a power of two:
+//
+//   out(x, y) = sum over (m, n) of in(m, n) * e^(2 pi i (m x + n y) / size)
+//
+// with (m, n) and (x, y) as (column, row). The grids are row-major with separate real and imaginary arrays, the rows
+// are Stride() floats apart. The transform runs along the columns first, every butterfly processing whole rows with the
+// SIMD kernels, then the grid is transposed, transformed along the columns again and transposed back. The stages are
+// fused in pairs into radix-4 butterflies, a single radix-2 stage is left for odd powers of two.
+class InverseFft2D
+{
+  public:
+    explicit InverseFft2D(int size = 0);
+
+    // Grids of at least PARALLEL_MIN_SIZE are transformed with the thread pool
+    static constexpr int PARALLEL_MIN_SIZE = 256;
+    // Columns transformed together by one task, 2 * COLUMN_BLOCK floats of every row stay in the cache
+    static constexpr int COLUMN_BLOCK    = 64;
+    static constexpr int TRANSPOSE_BLOCK = 32;
+    // Floats added to every row of the larger grids. A power of two row stride puts the same column of all rows into
+    // the same cache set, which the column transforms would keep evicting.
+    static constexpr int ROW_PADDING = 16;
+
+    // Precomputes the twiddles and the bit reversal for the size, which has to be a power of two (or 0)
+    void Resize(int size);
+
+    int Size() const
+    {
+        return m_size;
+    }
+
+    // Distance between the rows of the transformed grids in floats
+    int Stride() const
+    {
+        return m_stride;
+    }
+
+    // Selects the butterfly kernels, unsupported instruction sets fall back to the scalar kernels
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    // Transforms the Size() x Size() grid in place, the padding of the rows is left untouched
+    void Transform(float* re, float* im, ThreadPool& workers);
+
+  private:
+    // 1-D transforms of the columns [begin, end) along the rows
+    void TransformColumns(float* re, float* im, int begin, int end) const;
+    void Transpose(const float* src, float* dest, ThreadPool& workers) const;
+
+    template <typename Func> void ForEachBlock(int count, int block, ThreadPool& workers, Func&& func) const
+    {
+        if (m_size < PARALLEL_MIN_SIZE)
+        {
+            func(0, count);
+            return;
+        }
+        workers.ParallelFor(count, block, func);
+    }
+
+    int m_size;
+    int m_log2Size;
+    int m_stride;
+    std::vector<int> m_bitReversed;
+    std::vector<float> m_twiddles; // w[0..5] of every radix-4 butterfly, stage after stage
+    std::vector<float> m_scratchRe;
+    std::vector<float> m_scratchIm;
+
+    kernels::FftRadix2Fn m_radix2;
+    kernels::FftRadix4Fn m_radix4;
+};
+} // namespace mini::gk2
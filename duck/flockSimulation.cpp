@@ -0,0 +1,176 @@
+#include "pch.h"
+
+#include "flockSimulation.h"
+#include "utils/profiling.h"
+
+mini::gk2::FlockSimulation::FlockSimulation(int count, DirectX::XMFLOAT2 min, DirectX::XMFLOAT2 max)
+    : m_count(std::max(count, 0)), m_simdLevel(kernels::DetectSimdLevel()),
+      m_bsplineRow(kernels::SelectBSplineRow(m_simdLevel)), m_uniformDistX(min.x, max.x), m_uniformDistY(min.y, max.y),
+      m_uniformSpeed(static_cast<float>(SWIM_SPEED * MIN_SPEED_FACTOR),
+                     static_cast<float>(SWIM_SPEED * MAX_SPEED_FACTOR))
+{
+    assert(kernels::VerifyBSplineRow(m_bsplineRow));
+
+    for (auto i = 0; i < 4; i++)
+    {
+        m_pointsX[i].resize(m_count);
+        m_pointsY[i].resize(m_count);
+        m_expiredX[i].reserve(m_count);
+        m_expiredY[i].reserve(m_count);
+    }
+    m_distances.resize(m_count);
+    m_arcLengths.resize(m_count);
+    m_speeds.resize(m_count);
+    m_instances.resize(m_count);
+    m_expired.reserve(m_count);
+    m_expiredArcLengths.reserve(m_count);
+
+    InitPaths();
+    EvaluateFrames();
+}
+
+void mini::gk2::FlockSimulation::Seed(std::uint32_t seed)
+{
+    m_randGenerator.seed(seed);
+    m_uniformDistX.reset();
+    m_uniformDistY.reset();
+    m_uniformSpeed.reset();
+    InitPaths();
+    EvaluateFrames();
+}
+
+void mini::gk2::FlockSimulation::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_simdLevel  = kernels::IsSupported(level) ? level : kernels::SimdLevel::Scalar;
+    m_bsplineRow = kernels::SelectBSplineRow(m_simdLevel);
+    assert(kernels::VerifyBSplineRow(m_bsplineRow));
+}
+
+void mini::gk2::FlockSimulation::InitPaths()
+{
+    // Object by object, so that a path does not depend on the number of objects after it. The objects start at random
+    // fractions of their segments, as if the flock had been swimming for a while.
+    std::uniform_real_distribution<float> uniformFraction(0.f, 1.f);
+    for (auto k = 0; k < m_count; k++)
+    {
+        for (auto i = 0; i < 4; i++)
+        {
+            m_pointsX[i][k] = m_uniformDistX(m_randGenerator);
+            m_pointsY[i][k] = m_uniformDistY(m_randGenerator);
+        }
+        m_distances[k] = uniformFraction(m_randGenerator);
+        m_speeds[k]    = m_uniformSpeed(m_randGenerator);
+    }
+
+    const float* x[4] = {m_pointsX[0].data(), m_pointsX[1].data(), m_pointsX[2].data(), m_pointsX[3].data()};
+    const float* y[4] = {m_pointsY[0].data(), m_pointsY[1].data(), m_pointsY[2].data(), m_pointsY[3].data()};
+    BuildArcLengthTables(m_bsplineRow, x, y, m_arcLengths.data(), m_count);
+    for (auto k = 0; k < m_count; k++)
+    {
+        m_distances[k] *= m_arcLengths[k].length;
+    }
+}
+
+void mini::gk2::FlockSimulation::Step()
+{
+    PROFILE_ZONE("FlockSimulation::Step");
+    const auto stepTime = static_cast<float>(StepTime());
+    auto* distances     = m_distances.data();
+    const auto* speeds  = m_speeds.data();
+    for (auto k = 0; k < m_count; k++)
+    {
+        distances[k] += speeds[k] * stepTime;
+    }
+    RefillExpiredSegments();
+}
+
+void mini::gk2::FlockSimulation::RefillExpiredSegments()
+{
+    m_expired.clear();
+    for (auto k = 0; k < m_count; k++)
+    {
+        if (m_distances[k] >= m_arcLengths[k].length)
+        {
+            m_expired.push_back(k);
+        }
+    }
+    if (m_expired.empty())
+    {
+        return;
+    }
+
+    // Each array is shifted for all the expired objects at once, then the new points are drawn in the order of the
+    // objects
+    for (auto i = 0; i < 3; i++)
+    {
+        for (const auto k : m_expired)
+        {
+            m_pointsX[i][k] = m_pointsX[i + 1][k];
+            m_pointsY[i][k] = m_pointsY[i + 1][k];
+        }
+    }
+    for (const auto k : m_expired)
+    {
+        m_distances[k] -= m_arcLengths[k].length;
+        m_pointsX[3][k] = m_uniformDistX(m_randGenerator);
+        m_pointsY[3][k] = m_uniformDistY(m_randGenerator);
+    }
+
+    // The tables of the new segments are built in SIMD batches from the gathered points. A segment shorter than a step
+    // waits at its end for the next step.
+    const auto expiredCount = static_cast<int>(m_expired.size());
+    for (auto i = 0; i < 4; i++)
+    {
+        m_expiredX[i].resize(expiredCount);
+        m_expiredY[i].resize(expiredCount);
+        for (auto e = 0; e < expiredCount; e++)
+        {
+            m_expiredX[i][e] = m_pointsX[i][m_expired[e]];
+            m_expiredY[i][e] = m_pointsY[i][m_expired[e]];
+        }
+    }
+    m_expiredArcLengths.resize(expiredCount);
+    const float* x[4] = {m_expiredX[0].data(), m_expiredX[1].data(), m_expiredX[2].data(), m_expiredX[3].data()};
+    const float* y[4] = {m_expiredY[0].data(), m_expiredY[1].data(), m_expiredY[2].data(), m_expiredY[3].data()};
+    BuildArcLengthTables(m_bsplineRow, x, y, m_expiredArcLengths.data(), expiredCount);
+    for (auto e = 0; e < expiredCount; e++)
+    {
+        m_arcLengths[m_expired[e]] = m_expiredArcLengths[e];
+    }
+}
+
+void mini::gk2::FlockSimulation::PostUpdate()
+{
+    EvaluateFrames();
+}
+
+void mini::gk2::FlockSimulation::EvaluateFrames()
+{
+    PROFILE_ZONE("FlockSimulation::EvaluateFrames");
+    Workers().ParallelFor(
+        m_count, EVALUATION_GRAIN,
+        [&](int begin, int end)
+        {
+            // Positions and directions of the chunk, still in the cache while they are interleaved into the instances
+            std::array<std::array<float, EVALUATION_GRAIN>, 5> evaluated;
+            auto& [t, posX, posY, dirX, dirY] = evaluated;
+            for (auto k = begin; k < end; k++)
+            {
+                t[k - begin] = m_arcLengths[k].ParameterAt(m_distances[k]);
+            }
+
+            const float* x[4] = {m_pointsX[0].data() + begin, m_pointsX[1].data() + begin,
+                                 m_pointsX[2].data() + begin, m_pointsX[3].data() + begin};
+            const float* y[4] = {m_pointsY[0].data() + begin, m_pointsY[1].data() + begin,
+                                 m_pointsY[2].data() + begin, m_pointsY[3].data() + begin};
+            m_bsplineRow(x, y, t.data(), posX.data(), posY.data(), dirX.data(), dirY.data(),
+                         end - begin);
+
+            // The bitangent is normal x tangent with the normal (0, 1, 0)
+            for (auto k = begin; k < end; k++)
+            {
+                const auto j   = k - begin;
+                m_instances[k] = {{posX[j], 0.f, posY[j]}, {dirX[j], 0.f, dirY[j]}, {dirY[j], 0.f, -dirX[j]}};
+            }
+        });
+}
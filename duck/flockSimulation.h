@@ -0,0 +1,95 @@
+#pragma once
+#include "arcLengthTable.h"
+#include "simulation.h"
+#include "waterSurfaceKernels.h"
+#include <random>
+#include <span>
+
+namespace mini::gk2
+{
+// Thousands of objects floating along random paths like the duck of DuckSimulation: uniform cubic B-splines through de
+// Boor points in a rectangle, whose oldest point is replaced by a new random one whenever a segment ends. The objects
+// are kept as a structure of arrays, so that their segments are evaluated in SIMD batches, and every Update() writes
+// their frames to a contiguous instance buffer for instanced drawing. The objects swim at constant speeds through the
+// arc length tables of their segments, the tables of the segments ending in a step are built together.
+//
+// The objects float on a flat surface, the normal of every frame is +Y. The frames are those of the last step, there
+// is no interpolation between the steps.
+class FlockSimulation final : public Simulation
+{
+  public:
+    // Per instance data: the world matrix of an object is built like the one of the duck in DuckDemo, from the rows
+    // -tangent, (0, 1, 0), bitangent and the translation by position
+    struct Instance
+    {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 tangent;
+        DirectX::XMFLOAT3 bitangent;
+    };
+
+    static constexpr double SWIM_SPEED = 0.4; // world units per second, as the duck
+
+    // Every object gets a random speed in this range around SWIM_SPEED, so that the segments do not all end in the same
+    // step
+    static constexpr float MIN_SPEED_FACTOR = 0.5f;
+    static constexpr float MAX_SPEED_FACTOR = 1.5f;
+
+    // Objects evaluated by a task of the thread pool, a multiple of the widest SIMD batch
+    static constexpr int EVALUATION_GRAIN = 2048;
+
+    FlockSimulation(int count, DirectX::XMFLOAT2 min, DirectX::XMFLOAT2 max);
+
+    // Restarts every path from new random points, equal seeds give equal paths
+    void Seed(std::uint32_t seed);
+
+    int Count() const
+    {
+        return m_count;
+    }
+
+    // Frames of the objects after the last Update()
+    std::span<const Instance> Instances() const
+    {
+        return m_instances;
+    }
+
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    kernels::SimdLevel SimdLevel() const
+    {
+        return m_simdLevel;
+    }
+
+  private:
+    void Step() final;
+    void PostUpdate() final;
+
+    void InitPaths();
+    void RefillExpiredSegments();
+    void EvaluateFrames();
+
+    int m_count;
+
+    // Structure of arrays: de Boor point i of object k is (m_pointsX[i][k], m_pointsY[i][k])
+    std::array<std::vector<float>, 4> m_pointsX;
+    std::array<std::vector<float>, 4> m_pointsY;
+    std::vector<float> m_distances; // from the start of the current segment
+    std::vector<ArcLengthTable> m_arcLengths;
+    std::vector<float> m_speeds; // world units per second of simulated time
+    std::vector<int> m_expired;  // objects whose segment ended in the current step
+
+    // De Boor points of the new segments of the expired objects, gathered for BuildArcLengthTables()
+    std::array<std::vector<float>, 4> m_expiredX;
+    std::array<std::vector<float>, 4> m_expiredY;
+    std::vector<ArcLengthTable> m_expiredArcLengths;
+    std::vector<Instance> m_instances;
+
+    kernels::SimdLevel m_simdLevel;
+    kernels::BSplineRowFn m_bsplineRow;
+
+    std::mt19937 m_randGenerator;
+    std::uniform_real_distribution<float> m_uniformDistX;
+    std::uniform_real_distribution<float> m_uniformDistY;
+    std::uniform_real_distribution<float> m_uniformSpeed;
+};
+} // namespace mini::gk2
@@ -0,0 +1,44 @@
+#include "pch.h"
+
+#include "gaussianBrush.h"
+#include <cmath>
+
+mini::gk2::GaussianBrush::GaussianBrush()
+{
+    for (auto i = 0; i < TABLE_SIZE - 1; i++)
+    {
+        const auto u = static_cast<double>(i) / TABLE_RESOLUTION;
+        m_table[i]   = static_cast<float>(std::exp(-0.5 * u * u));
+    }
+    m_table[TABLE_SIZE - 1] = m_table[TABLE_SIZE - 2];
+}
+
+float mini::gk2::GaussianBrush::Evaluate(float u) const
+{
+    const auto position = std::abs(u) * TABLE_RESOLUTION;
+    if (!(position <= CUTOFF * TABLE_RESOLUTION))
+    {
+        return 0.f;
+    }
+    const auto index = static_cast<int>(position);
+    const auto t     = position - static_cast<float>(index);
+    return m_table[index] + t * (m_table[index + 1] - m_table[index]);
+}
+
+mini::gk2::GaussianBrush::Span mini::gk2::GaussianBrush::Weights(float center, float radius, int begin, int end,
+                                                                 float scale, std::vector<float>& weights) const
+{
+    // Cells whose centers lie within the cutoff
+    radius           = std::max(radius, MIN_RADIUS);
+    const auto reach = static_cast<float>(CUTOFF) * radius;
+    const auto first = std::max(begin, static_cast<int>(std::ceil(center - reach - 0.5f)));
+    const auto last  = std::min(end, static_cast<int>(std::floor(center + reach - 0.5f)) + 1);
+
+    const Span span = {first, std::max(last - first, 0), weights.size()};
+    const auto unit = 1.f / radius;
+    for (auto k = first; k < last; k++)
+    {
+        weights.push_back(scale * Evaluate((static_cast<float>(k) + 0.5f - center) * unit));
+    }
+    return span;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace mini::gk2
+{
+// Disturbance of the water surface, a Gaussian bump added to the heights
+struct WaterImpulse
+{
+    float x;         // center, normalized
+    float y;
+    float radius;    // standard deviation in pool widths
+    float amplitude; // height added at the center
+};
+
+// Separable Gaussian kernel: the weight of a cell is the product of the weights of its row and its column, so a bump
+// is two short lines of weights and the splat is an outer product along the rows of the grid. The weights come from a
+// table of exp(-u^2 / 2), a bump costs no exp() per cell.
+class GaussianBrush
+{
+  public:
+    static constexpr int CUTOFF           = 3;    // the bump ends CUTOFF standard deviations from the center
+    static constexpr int TABLE_RESOLUTION = 32;   // table entries per standard deviation
+    static constexpr float MIN_RADIUS     = 0.5f; // cells, narrower bumps alias like single cell spikes
+
+    // Cells [first, first + count) of a line, their weights start at `offset` of the weights buffer
+    struct Span
+    {
+        int first;
+        int count;
+        std::size_t offset;
+    };
+
+    GaussianBrush();
+
+    // Appends the weights times `scale` of the cells of a line within [begin, end) for a bump centered at `center`
+    // with the standard deviation `radius` (both in cells, cell k spans [k, k + 1))
+    Span Weights(float center, float radius, int begin, int end, float scale, std::vector<float>& weights) const;
+
+    // exp(-u^2 / 2) interpolated from the table, 0 beyond CUTOFF
+    float Evaluate(float u) const;
+
+  private:
+    static constexpr int TABLE_SIZE = CUTOFF * TABLE_RESOLUTION + 2; // the last entry is the end of the interpolation
+
+    std::array<float, TABLE_SIZE> m_table;
+};
+} // namespace mini::gk2
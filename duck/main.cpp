@@ -1,11 +1,111 @@
 ﻿#include "pch.h"
 
+#include "benchmarks.h"
 #include "duckDemo.h"
 #include "exceptions.h"
+#include <iostream>
 
 using namespace std;
 using namespace mini;
 using namespace gk2;
+
+// Recognized arguments:
+//   --water-samples <N>     water grid resolution (N x N)
+//   --adaptive-water        adjust the water resolution to the measured simulation time
+//   --partial-water-upload  upload only the changed regions of the water normal map
+//   --async-water           simulate the water on a separate thread
+//   --temporal-water        advance the water tiles by several steps at once when a frame needs more than one step
+//   --ocean                 synthesize the water from a wave spectrum with an inverse FFT (power of two sizes)
+//   --ocean-spectrum <S>    wave spectrum of the ocean: phillips (default), jonswap
+//   --shallow-water         simulate the water with the shallow water equations, the duck pushes it and rides the waves
+//   --water-normals <E>     water normal map encoding: rgba8 (default), rg8, bc5, or heights only with the normals
+//                           computed in the shaders: r16f, r32f
+//   --seed <N>              seed of the water and the duck, random by default
+//   --record <file>         save the inputs of the water and the duck (seed, frame times, drops) to the file on exit
+//   --replay <file>         replay a recording headless, check the SIMD kernels against the scalar ones step by step
+//   --replay-hashes <file>  with --replay, write the state hash of every step to the file
+struct CommandLine
+{
+    DuckDemoOptions options;
+    filesystem::path replayPath;
+    filesystem::path replayHashesPath;
+};
+
+CommandLine ParseCommandLine()
+{
+    CommandLine commandLine;
+    auto& options = commandLine.options;
+    for (auto i = 1; i < __argc; ++i)
+    {
+        const wstring_view arg = __wargv[i];
+        if (arg == L"--water-samples" && i + 1 < __argc)
+        {
+            options.waterSamples = _wtoi(__wargv[++i]);
+        }
+        else if (arg == L"--adaptive-water")
+        {
+            options.adaptiveWaterQuality = true;
+        }
+        else if (arg == L"--partial-water-upload")
+        {
+            options.partialWaterUpload = true;
+        }
+        else if (arg == L"--async-water")
+        {
+            options.asyncWaterSimulation = true;
+        }
+        else if (arg == L"--temporal-water")
+        {
+            options.temporalWaterBlocking = true;
+        }
+        else if (arg == L"--ocean")
+        {
+            options.oceanWater = true;
+        }
+        else if (arg == L"--ocean-spectrum" && i + 1 < __argc)
+        {
+            const wstring_view spectrum = __wargv[++i];
+            if (!TryParse(spectrum, options.oceanSpectrum))
+            {
+                wcerr << L"Unknown ocean spectrum: " << spectrum << endl;
+            }
+        }
+        else if (arg == L"--shallow-water")
+        {
+            options.shallowWater = true;
+        }
+        else if (arg == L"--water-normals" && i + 1 < __argc)
+        {
+            const wstring_view encoding = __wargv[++i];
+            if (!TryParse(encoding, options.waterNormalEncoding))
+            {
+                wcerr << L"Unknown water normal encoding: " << encoding << endl;
+            }
+        }
+        else if (arg == L"--seed" && i + 1 < __argc)
+        {
+            options.seed = static_cast<uint32_t>(wcstoul(__wargv[++i], nullptr, 10));
+        }
+        else if (arg == L"--record" && i + 1 < __argc)
+        {
+            options.recordPath = __wargv[++i];
+        }
+        else if (arg == L"--replay" && i + 1 < __argc)
+        {
+            commandLine.replayPath = __wargv[++i];
+        }
+        else if (arg == L"--replay-hashes" && i + 1 < __argc)
+        {
+            commandLine.replayHashesPath = __wargv[++i];
+        }
+        else
+        {
+            wcerr << L"Unknown argument: " << arg << endl;
+        }
+    }
+    return commandLine;
+}
+
 void CreateConsole()
 {
     AllocConsole();
@@ -31,7 +131,15 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE prevInstance, LPWSTR cmdLine,
     CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
     try
     {
-        DuckDemo app(hInstance);
+        const auto commandLine = ParseCommandLine();
+        if (!commandLine.replayPath.empty())
+        {
+            const auto passed = benchmarks::RunReplay(commandLine.replayPath, commandLine.replayHashesPath);
+            exitCode          = passed ? EXIT_SUCCESS : EXIT_FAILURE;
+            return exitCode;
+        }
+
+        DuckDemo app(hInstance, commandLine.options);
         exitCode = app.Run();
     }
     catch (Exception& e)
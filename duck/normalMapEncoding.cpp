@@ -0,0 +1,255 @@
+#include "pch.h"
+
+#include "normalMapEncoding.h"
+#include <bit>
+
+using namespace mini::gk2;
+
+const char* mini::gk2::ToString(NormalMapEncoding encoding)
+{
+    switch (encoding)
+    {
+    case NormalMapEncoding::RGBA8:
+        return "rgba8";
+    case NormalMapEncoding::RG8:
+        return "rg8";
+    case NormalMapEncoding::BC5:
+        return "bc5";
+    case NormalMapEncoding::R16F:
+        return "r16f";
+    case NormalMapEncoding::R32F:
+        return "r32f";
+    }
+    return "unknown";
+}
+
+bool mini::gk2::TryParse(std::wstring_view name, NormalMapEncoding& encoding)
+{
+    for (const auto candidate : NORMAL_MAP_ENCODINGS)
+    {
+        if (std::ranges::equal(name, std::string_view(ToString(candidate))))
+        {
+            encoding = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace
+{
+constexpr int BLOCK_SIZE = normalEncoding::BC_BLOCK_SIZE;
+
+// BC4 block with the 8 value palette: red0 > red1, indices 2..7 interpolate from red0 towards red1
+void EncodeBC4Block(const std::uint8_t* values, std::size_t stride, std::size_t rowPitch, std::uint8_t* block)
+{
+    std::array<int, 16> texels;
+    auto lo = 255;
+    auto hi = 0;
+    for (auto i = 0; i < 16; i++)
+    {
+        const auto v = values[(i / BLOCK_SIZE) * rowPitch + (i % BLOCK_SIZE) * stride];
+        texels[i]    = v;
+        lo           = std::min<int>(lo, v);
+        hi           = std::max<int>(hi, v);
+    }
+
+    block[0] = static_cast<std::uint8_t>(hi);
+    block[1] = static_cast<std::uint8_t>(lo);
+
+    // The palette is evenly spaced, so the closest entry is the rounded position of the value between the endpoints.
+    // Positions 0 and 7 are the endpoints themselves (indices 0 and 1), position p in between has index p + 1.
+    static constexpr std::array<std::uint64_t, 8> POSITION_TO_INDEX = {0, 2, 3, 4, 5, 6, 7, 1};
+
+    const auto range     = hi - lo;
+    std::uint64_t packed = 0;
+    if (range > 0)
+    {
+        for (auto i = 0; i < 16; i++)
+        {
+            const auto position = ((hi - texels[i]) * 7 + range / 2) / range;
+            packed |= POSITION_TO_INDEX[position] << (3 * i);
+        }
+    }
+    for (auto i = 0; i < 6; i++)
+    {
+        block[2 + i] = static_cast<std::uint8_t>(packed >> (8 * i));
+    }
+}
+
+void DecodeBC4Block(const std::uint8_t* block, std::uint8_t* values, std::size_t stride, std::size_t rowPitch)
+{
+    const int red0 = block[0];
+    const int red1 = block[1];
+
+    std::array<int, 8> palette = {red0, red1};
+    if (red0 > red1)
+    {
+        for (auto i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * red0 + i * red1 + 3) / 7;
+        }
+    }
+    else
+    {
+        for (auto i = 1; i < 5; i++)
+        {
+            palette[i + 1] = ((5 - i) * red0 + i * red1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    std::uint64_t packed = 0;
+    for (auto i = 0; i < 6; i++)
+    {
+        packed |= static_cast<std::uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (auto i = 0; i < 16; i++)
+    {
+        const auto value = static_cast<std::uint8_t>(palette[(packed >> (3 * i)) & 7]);
+        values[(i / BLOCK_SIZE) * rowPitch + (i % BLOCK_SIZE) * stride] = value;
+    }
+}
+} // namespace
+
+bool normalEncoding::Supports(NormalMapEncoding encoding, int width, int height)
+{
+    if (encoding == NormalMapEncoding::BC5)
+    {
+        return width % BC_BLOCK_SIZE == 0 && height % BC_BLOCK_SIZE == 0;
+    }
+    return true;
+}
+
+NormalMapEncoding normalEncoding::Resolve(NormalMapEncoding requested, int width, int height)
+{
+    return Supports(requested, width, height) ? requested : NormalMapEncoding::RG8;
+}
+
+std::size_t normalEncoding::RowPitch(NormalMapEncoding encoding, int width)
+{
+    switch (encoding)
+    {
+    case NormalMapEncoding::RGBA8:
+    case NormalMapEncoding::R32F:
+        return 4 * static_cast<std::size_t>(width);
+    case NormalMapEncoding::RG8:
+    case NormalMapEncoding::R16F:
+        return 2 * static_cast<std::size_t>(width);
+    case NormalMapEncoding::BC5:
+        return BC5_BLOCK_BYTES * static_cast<std::size_t>((width + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE);
+    }
+    return 0;
+}
+
+int normalEncoding::PitchRows(NormalMapEncoding encoding, int height)
+{
+    return encoding == NormalMapEncoding::BC5 ? (height + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE : height;
+}
+
+std::size_t normalEncoding::EncodedSize(NormalMapEncoding encoding, int width, int height)
+{
+    return RowPitch(encoding, width) * PitchRows(encoding, height);
+}
+
+std::size_t normalEncoding::Offset(NormalMapEncoding encoding, int width, int x, int y)
+{
+    if (encoding == NormalMapEncoding::BC5)
+    {
+        return RowPitch(encoding, width) * (y / BC_BLOCK_SIZE) + BC5_BLOCK_BYTES * (x / BC_BLOCK_SIZE);
+    }
+    return RowPitch(encoding, width) * y + RowPitch(encoding, x);
+}
+
+void normalEncoding::EncodeBC5Block(const std::uint8_t* rg, std::size_t rowPitch, std::uint8_t* block)
+{
+    EncodeBC4Block(rg, 2, rowPitch, block);
+    EncodeBC4Block(rg + 1, 2, rowPitch, block + BC5_BLOCK_BYTES / 2);
+}
+
+void normalEncoding::EncodeBC5(const std::uint8_t* rg, int width, int blockRowBegin, int blockRowEnd,
+                               int blockColBegin, int blockColEnd, std::uint8_t* blocks)
+{
+    const auto srcPitch   = RowPitch(NormalMapEncoding::RG8, width);
+    const auto blockPitch = RowPitch(NormalMapEncoding::BC5, width);
+    for (auto blockRow = blockRowBegin; blockRow < blockRowEnd; blockRow++)
+    {
+        const auto* src = rg + blockRow * BC_BLOCK_SIZE * srcPitch;
+        auto* dest      = blocks + blockRow * blockPitch;
+        for (auto blockCol = blockColBegin; blockCol < blockColEnd; blockCol++)
+        {
+            EncodeBC5Block(src + 2 * BC_BLOCK_SIZE * blockCol, srcPitch, dest + BC5_BLOCK_BYTES * blockCol);
+        }
+    }
+}
+
+void normalEncoding::EncodeBC5(const std::uint8_t* rg, int width, int height, std::uint8_t* blocks)
+{
+    EncodeBC5(rg, width, 0, height / BC_BLOCK_SIZE, 0, width / BC_BLOCK_SIZE, blocks);
+}
+
+void normalEncoding::DecodeBC5Block(const std::uint8_t* block, std::uint8_t* rg, std::size_t rowPitch)
+{
+    DecodeBC4Block(block, rg, 2, rowPitch);
+    DecodeBC4Block(block + BC5_BLOCK_BYTES / 2, rg + 1, 2, rowPitch);
+}
+
+std::uint16_t normalEncoding::FloatToHalf(float value)
+{
+    auto bits       = std::bit_cast<std::uint32_t>(value);
+    const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+
+    if (bits >= 0x7F800000)
+    {
+        // Infinity stays infinity, NaN stays a quiet NaN with the top of its payload
+        return sign | 0x7C00 | (bits > 0x7F800000 ? 0x0200 | ((bits >> 13) & 0x03FF) : 0);
+    }
+    if (bits >= 0x477FF000)
+    {
+        // 65520 and above round to infinity
+        return sign | 0x7C00;
+    }
+    if (bits >= 0x38800000)
+    {
+        // Normal half: rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even
+        bits -= (127 - 15) << 23;
+        return sign | static_cast<std::uint16_t>((bits + 0x0FFF + ((bits >> 13) & 1)) >> 13);
+    }
+    if (bits < 0x33000000)
+    {
+        // Below half of the smallest subnormal (2^-25 ties to the even 0)
+        return sign;
+    }
+
+    // Subnormal half: the value in units of 2^-24 is the full mantissa shifted right by 126 - exponent
+    const auto shift     = 126 - static_cast<int>(bits >> 23);
+    const auto mantissa  = (bits & 0x007FFFFF) | 0x00800000;
+    const auto remainder = mantissa & ((1u << shift) - 1);
+    const auto halfway   = 1u << (shift - 1);
+    auto half            = mantissa >> shift;
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+    {
+        half++;
+    }
+    return sign | static_cast<std::uint16_t>(half);
+}
+
+float normalEncoding::HalfToFloat(std::uint16_t half)
+{
+    const auto sign     = static_cast<std::uint32_t>(half & 0x8000) << 16;
+    const auto exponent = (half >> 10) & 0x1F;
+    const auto mantissa = static_cast<std::uint32_t>(half & 0x03FF);
+    if (exponent == 0x1F)
+    {
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    }
+    if (exponent == 0)
+    {
+        // Zero or subnormal, exact in float
+        const auto magnitude = static_cast<float>(mantissa) * (1.f / 16777216.f);
+        return sign ? -magnitude : magnitude;
+    }
+    return std::bit_cast<float>(sign | (static_cast<std::uint32_t>(exponent + 127 - 15) << 23) | (mantissa << 13));
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace mini::gk2
+{
+// Storage of the water normal map. The surface is a height field y = f(x, z), so the y component of its normals is
+// always positive and can be rebuilt from x and z in the shader: the two channel encodings store only (x, z).
+// The height encodings skip the normals altogether, the shaders derive them from the neighbouring heights.
+enum class NormalMapEncoding
+{
+    RGBA8, // (x, y, z, 1), 4 bytes per texel
+    RG8,   // (x, z), 2 bytes per texel
+    BC5,   // (x, z) block compressed, 16 bytes per 4x4 block
+    R16F,  // heights as half floats
+    R32F,  // heights as floats
+};
+
+constexpr std::array<NormalMapEncoding, 5> NORMAL_MAP_ENCODINGS = {
+    NormalMapEncoding::RGBA8, NormalMapEncoding::RG8, NormalMapEncoding::BC5, NormalMapEncoding::R16F,
+    NormalMapEncoding::R32F};
+
+const char* ToString(NormalMapEncoding encoding);
+
+// Inverse of ToString, returns false for an unknown name
+bool TryParse(std::wstring_view name, NormalMapEncoding& encoding);
+
+namespace normalEncoding
+{
+constexpr int BC_BLOCK_SIZE   = 4;
+constexpr int BC5_BLOCK_BYTES = 16;
+
+// Largest BC5 error of a channel in 8 bit units: half the distance between two of the 8 evenly spaced palette entries,
+// plus one for the rounding of the palette itself
+constexpr int BC5_MAX_ERROR = 255 / 7 / 2 + 1;
+
+// Whether a width x height map can be stored with the encoding (block compression needs whole blocks)
+bool Supports(NormalMapEncoding encoding, int width, int height);
+
+// The requested encoding if the map can be stored with it, otherwise the closest one that can (BC5 -> RG8)
+NormalMapEncoding Resolve(NormalMapEncoding requested, int width, int height);
+
+// Whether the texture holds heights instead of normals
+constexpr bool StoresHeights(NormalMapEncoding encoding)
+{
+    return encoding == NormalMapEncoding::R16F || encoding == NormalMapEncoding::R32F;
+}
+
+// Bytes of one row of texels, or of one row of blocks for BC5
+std::size_t RowPitch(NormalMapEncoding encoding, int width);
+
+// Number of texel rows, or block rows for BC5
+int PitchRows(NormalMapEncoding encoding, int height);
+
+std::size_t EncodedSize(NormalMapEncoding encoding, int width, int height);
+
+// Offset of the texel (x, y) (of the block containing it for BC5) in the encoded data
+std::size_t Offset(NormalMapEncoding encoding, int width, int x, int y);
+
+// Encodes one 4x4 block of an RG8 image into BC5 (two BC4 blocks, red then green). `rg` points at the top left texel,
+// `rowPitch` is the distance between the rows of the image in bytes.
+void EncodeBC5Block(const std::uint8_t* rg, std::size_t rowPitch, std::uint8_t* block);
+
+// Encodes the block rows [blockRowBegin, blockRowEnd) and block columns [blockColBegin, blockColEnd) of a width x
+// height RG8 image into `blocks`, which is laid out as the whole BC5 image
+void EncodeBC5(const std::uint8_t* rg, int width, int blockRowBegin, int blockRowEnd, int blockColBegin,
+               int blockColEnd, std::uint8_t* blocks);
+
+// Encodes a whole RG8 image, width and height have to be multiples of 4
+void EncodeBC5(const std::uint8_t* rg, int width, int height, std::uint8_t* blocks);
+
+// Reference decoder, writes the 4x4 RG8 texels of a BC5 block
+void DecodeBC5Block(const std::uint8_t* block, std::uint8_t* rg, std::size_t rowPitch);
+
+// IEEE 754 binary16 conversion rounding to nearest even, the same as the F16C instructions
+std::uint16_t FloatToHalf(float value);
+
+float HalfToFloat(std::uint16_t half);
+} // namespace normalEncoding
+} // namespace mini::gk2
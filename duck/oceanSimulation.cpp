@@ -0,0 +1,226 @@
+#include "pch.h"
+
+#include "oceanSimulation.h"
+#include "utils/profiling.h"
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+const char* mini::gk2::ToString(OceanSpectrum spectrum)
+{
+    switch (spectrum)
+    {
+    case OceanSpectrum::Phillips:
+        return "phillips";
+    case OceanSpectrum::Jonswap:
+        return "jonswap";
+    }
+    return "unknown";
+}
+
+bool mini::gk2::TryParse(std::wstring_view name, OceanSpectrum& spectrum)
+{
+    for (const auto candidate : {OceanSpectrum::Phillips, OceanSpectrum::Jonswap})
+    {
+        if (std::ranges::equal(name, std::string_view(ToString(candidate))))
+        {
+            spectrum = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+mini::gk2::OceanSimulation::OceanSimulation(int samplesCount, const OceanParameters& parameters)
+    : Simulation(), m_parameters(parameters), m_samplesCount(0), m_time(0.0), m_textureScale(1.f),
+      m_simdLevel(kernels::DetectSimdLevel())
+{
+    SetStepTime(STEP_TIME);
+    m_fft.SetSimdLevel(m_simdLevel);
+    Resize(samplesCount);
+}
+
+void mini::gk2::OceanSimulation::Resize(int samplesCount)
+{
+    PROFILE_ZONE("OceanSimulation::Resize");
+    const auto clamped = static_cast<unsigned int>(std::clamp(samplesCount, MIN_SAMPLES, MAX_SAMPLES));
+    m_samplesCount     = static_cast<int>(std::bit_floor(clamped));
+    m_fft.Resize(m_samplesCount);
+
+    const auto cells = static_cast<std::size_t>(m_samplesCount) * m_fft.Stride();
+    m_heightsRe.assign(cells, 0.f);
+    m_heightsIm.assign(cells, 0.f);
+
+    InitSpectrum();
+    m_surfaceTexture.Resize(m_samplesCount);
+    Synthesize();
+}
+
+void mini::gk2::OceanSimulation::SetParameters(const OceanParameters& parameters)
+{
+    m_parameters = parameters;
+    InitSpectrum();
+    Synthesize();
+}
+
+void mini::gk2::OceanSimulation::SetNormalEncoding(NormalMapEncoding encoding)
+{
+    m_surfaceTexture.SetEncoding(encoding);
+    m_surfaceTexture.Build(m_heightsRe.data(), m_fft.Stride(), true, Workers());
+}
+
+void mini::gk2::OceanSimulation::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_simdLevel = level;
+    m_fft.SetSimdLevel(m_simdLevel);
+    m_surfaceTexture.SetSimdLevel(m_simdLevel);
+}
+
+void mini::gk2::OceanSimulation::Step()
+{
+    m_time += StepTime();
+}
+
+void mini::gk2::OceanSimulation::PostUpdate()
+{
+    Synthesize();
+}
+
+void mini::gk2::OceanSimulation::InitSpectrum()
+{
+    PROFILE_ZONE("OceanSimulation::InitSpectrum");
+    const auto n     = m_samplesCount;
+    const auto cells = static_cast<std::size_t>(n) * n;
+    m_spectrum.resize(cells);
+    m_omega.resize(cells);
+
+    // Heights in units of two grid cells, the central differences of the normal kernels become the slopes
+    m_textureScale = m_parameters.heightScale * static_cast<float>(n) / (2.f * m_parameters.patchSize);
+
+    // Frequency index m stands for the wave number 2 pi m' / patchSize with m' in [-n / 2, n / 2)
+    const auto dk        = 2.0 * std::numbers::pi / m_parameters.patchSize;
+    const auto frequency = [n](int index) { return index < n / 2 ? index : index - n; };
+
+    std::mt19937 generator(m_parameters.seed);
+    std::normal_distribution<float> gaussian;
+    for (auto i = 0; i < n; i++)
+    {
+        const auto ky = dk * frequency(i);
+        for (auto j = 0; j < n; j++)
+        {
+            const auto kx    = dk * frequency(j);
+            const auto index = static_cast<std::size_t>(i) * n + j;
+
+            // h0(k) = (xi_r + i xi_i) sqrt(Psi(k) dk^2 / 2) with xi_r, xi_i drawn from N(0, 1)
+            const auto variance  = DirectionalSpectrum(kx, ky) * dk * dk;
+            const auto amplitude = static_cast<float>(std::sqrt(variance / 2.0)) * m_textureScale;
+            const auto real      = gaussian(generator);
+            const auto imaginary = gaussian(generator);
+            m_spectrum[index]    = {real * amplitude, imaginary * amplitude};
+            m_omega[index]       = static_cast<float>(std::sqrt(GRAVITY * std::hypot(kx, ky)));
+        }
+    }
+}
+
+double mini::gk2::OceanSimulation::DirectionalSpectrum(double kx, double ky) const
+{
+    const auto k = std::hypot(kx, ky);
+    if (k == 0.0)
+    {
+        return 0.0;
+    }
+
+    // cos^2 spreading over the half plane facing the wind, normalized to 1 over all directions
+    const auto cosine = (kx * std::cos(m_parameters.windDirection) + ky * std::sin(m_parameters.windDirection)) / k;
+    if (cosine <= 0.0)
+    {
+        return 0.0;
+    }
+    const auto spreading = 2.0 / std::numbers::pi * cosine * cosine;
+
+    // Omnidirectional spectrum F(k), the variance per unit of wave number
+    const double g         = GRAVITY;
+    const double windSpeed = m_parameters.windSpeed;
+    double omnidirectional = 0.0;
+    switch (m_parameters.spectrum)
+    {
+    case OceanSpectrum::Phillips:
+    {
+        // alpha / 2 k^-3, cut off around the largest wave L = U^2 / g raised by the wind
+        const auto largestWave = windSpeed * windSpeed / g;
+        omnidirectional = PHILLIPS_ALPHA / (2.0 * k * k * k) * std::exp(-1.0 / (k * largestWave * k * largestWave));
+        break;
+    }
+    case OceanSpectrum::Jonswap:
+    {
+        // S(w) = alpha g^2 w^-5 e^(-5/4 (wp / w)^4) gamma^r, with alpha and the peak frequency wp given by the fetch,
+        // turned into F(k) = S(w) dw/dk by the deep water dispersion relation
+        const double fetch   = m_parameters.fetch;
+        const auto omega     = std::sqrt(g * k);
+        const auto alpha     = 0.076 * std::pow(windSpeed * windSpeed / (fetch * g), 0.22);
+        const auto omegaPeak = 22.0 * std::cbrt(g * g / (windSpeed * fetch));
+        const auto sigma     = omega <= omegaPeak ? 0.07 : 0.09;
+        const auto offset    = (omega - omegaPeak) / (sigma * omegaPeak);
+        const auto peak      = std::pow(JONSWAP_GAMMA, std::exp(-0.5 * offset * offset));
+        const auto ratio     = omegaPeak / omega;
+        const auto spectrum  = alpha * g * g / std::pow(omega, 5.0) * std::exp(-1.25 * std::pow(ratio, 4.0)) * peak;
+        omnidirectional      = spectrum * g / (2.0 * omega);
+        break;
+    }
+    }
+
+    // Waves much shorter than the grid cells would only alias
+    const auto smallWave = k * SMALL_WAVE_LENGTH;
+    omnidirectional *= std::exp(-smallWave * smallWave);
+
+    // Psi(k) = F(k) / k D(theta), so that the integral over the plane is the variance of the heights
+    return omnidirectional / k * spreading;
+}
+
+void mini::gk2::OceanSimulation::Synthesize()
+{
+    PROFILE_ZONE("OceanSimulation::Synthesize");
+    SynthesizeSpectrum();
+    m_fft.Transform(m_heightsRe.data(), m_heightsIm.data(), Workers());
+
+    // The patch is periodic, the rows wrap around
+    m_surfaceTexture.Build(m_heightsRe.data(), m_fft.Stride(), true, Workers());
+}
+
+void mini::gk2::OceanSimulation::SynthesizeSpectrum()
+{
+    PROFILE_ZONE("OceanSimulation::SynthesizeSpectrum");
+    const auto n      = m_samplesCount;
+    const auto stride = static_cast<std::size_t>(m_fft.Stride());
+
+    // h(-k, t) = conj(h(k, t)), which makes the heights real. Every pair is evaluated once by the rows [0, n / 2], the
+    // two rows mirrored onto themselves evaluate half of their columns.
+    ForEachRowBand(n / 2 + 1,
+                   [&](int begin, int end)
+                   {
+                       for (auto i = begin; i < end; i++)
+                       {
+                           const auto mirrorRow = (n - i) % n;
+                           const auto columns   = mirrorRow == i ? n / 2 + 1 : n;
+                           for (auto j = 0; j < columns; j++)
+                           {
+                               const auto mirrorCol = (n - j) % n;
+                               const auto index     = static_cast<std::size_t>(i) * n + j;
+                               const auto mirror    = static_cast<std::size_t>(mirrorRow) * n + mirrorCol;
+
+                               // The phase is reduced in double, w t loses the fraction of a turn in float
+                               const auto phase = static_cast<float>(
+                                   std::fmod(m_omega[index] * m_time, 2.0 * std::numbers::pi));
+                               const std::complex<float> rotation(std::cos(phase), -std::sin(phase));
+                               const auto h = m_spectrum[index] * rotation +
+                                              std::conj(m_spectrum[mirror]) * std::conj(rotation);
+
+                               m_heightsRe[i * stride + j]                 = h.real();
+                               m_heightsIm[i * stride + j]                 = h.imag();
+                               m_heightsRe[mirrorRow * stride + mirrorCol] = h.real();
+                               m_heightsIm[mirrorRow * stride + mirrorCol] = -h.imag();
+                           }
+                       }
+                   });
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include "fft.h"
+#include "simulation.h"
+#include "surfaceTexture.h"
+#include <complex>
+#include <string_view>
+
+namespace mini::gk2
+{
+// Wave spectra of a wind driven sea
+enum class OceanSpectrum
+{
+    Phillips, // fully developed sea, k^-4 saturation range below the largest wave the wind can raise
+    Jonswap,  // sea growing over a limited fetch, sharper peak
+};
+
+const char* ToString(OceanSpectrum spectrum);
+
+// Inverse of ToString, returns false for an unknown name
+bool TryParse(std::wstring_view name, OceanSpectrum& spectrum);
+
+struct OceanParameters
+{
+    OceanSpectrum spectrum = OceanSpectrum::Phillips;
+    float patchSize        = 20.f;       // side of the periodic patch covered by the grid in meters
+    float windSpeed        = 5.f;        // wind speed 10 m above the surface in m/s
+    float windDirection    = 0.f;        // angle of the wind against the x axis in radians
+    float fetch            = 20000.f;    // distance the wind blows over in meters (JONSWAP only)
+    float heightScale      = 1.f;        // exaggeration of the slopes in the normal map
+    std::uint32_t seed     = 0x5EED0CEA; // equal seeds give equal seas
+};
+
+// Deep water waves synthesized from a wave spectrum instead of being stepped. The random spectrum h0(k) is drawn once
+// per grid size, every frame only evolves its phases, h(k, t) = h0(k) e^(-i w t) + conj(h0(-k)) e^(i w t) with the
+// dispersion relation w^2 = g |k|, and takes the heights from an inverse FFT: O(N^2 log N) per frame regardless of
+// the number of steps. The grid is a periodic patch, the result tiles seamlessly.
+//
+// The surface texture follows the contract of WaterSurfaceSimulation (same encodings, row pitch and uploads of
+// surfaceUpload.h), so the demo can draw either of them. The heights are stored in units of two grid cells, the normal
+// kernels then produce the true slopes.
+class OceanSimulation final : public Simulation
+{
+  public:
+    explicit OceanSimulation(int samplesCount = SAMPLES_DEFAULT_SIZE, const OceanParameters& parameters = {});
+    ~OceanSimulation() final = default;
+
+    static constexpr int SAMPLES_DEFAULT_SIZE = 256;
+    static constexpr int MIN_SAMPLES          = 16;
+    static constexpr int MAX_SAMPLES          = 2048;
+
+    static constexpr float GRAVITY           = 9.81f;
+    static constexpr float PHILLIPS_ALPHA    = 0.0081f; // Phillips constant
+    static constexpr float JONSWAP_GAMMA     = 3.3f;    // peak enhancement
+    static constexpr float SMALL_WAVE_LENGTH = 0.01f;   // meters, the spectrum is damped by e^-(k l)^2 below it
+    static constexpr float STEP_TIME         = 1.f / 60.f;
+
+    // Reallocates the grid for samplesCount rounded down to a power of two (clamped to [MIN_SAMPLES, MAX_SAMPLES]) and
+    // draws a new spectrum. The surface texture has to be recreated with the new size afterwards.
+    void Resize(int samplesCount);
+
+    int SamplesCount() const
+    {
+        return m_samplesCount;
+    }
+
+    // Draws a new spectrum from the parameters, keeps the time
+    void SetParameters(const OceanParameters& parameters);
+
+    const OceanParameters& Parameters() const
+    {
+        return m_parameters;
+    }
+
+    // Time since the start in seconds
+    double Time() const
+    {
+        return m_time;
+    }
+
+    // Height in meters of the sample in row i, column j as of the last Update()
+    float Height(int i, int j) const
+    {
+        return m_heightsRe[static_cast<std::size_t>(i) * m_fft.Stride() + j] / m_textureScale;
+    }
+
+    // Same as WaterSurfaceSimulation::SetNormalEncoding
+    void SetNormalEncoding(NormalMapEncoding encoding);
+
+    NormalMapEncoding NormalEncoding() const
+    {
+        return m_surfaceTexture.Encoding();
+    }
+
+    const std::uint8_t* SurfaceTextureData() const
+    {
+        return m_surfaceTexture.Data();
+    }
+
+    unsigned int SurfaceTextureRowPitch() const
+    {
+        return m_surfaceTexture.RowPitch();
+    }
+
+    int SurfaceTextureRows() const
+    {
+        return m_surfaceTexture.Rows();
+    }
+
+    // Selects the butterfly and normal kernels, unsupported instruction sets fall back to the scalar kernels
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    kernels::SimdLevel SimdLevel() const
+    {
+        return m_simdLevel;
+    }
+
+  protected:
+    void Step() final;
+    void PostUpdate() final;
+
+  private:
+    // Rows of the grid processed by one task of the thread pool
+    static constexpr int BAND_ROWS = 32;
+
+    void InitSpectrum();
+
+    // Heights and normal map of the current time
+    void Synthesize();
+    // h(k, t) of every frequency into the FFT buffers
+    void SynthesizeSpectrum();
+
+    // Directional spectrum Psi(k) at the wave vector (kx, ky), the variance of a frequency cell is Psi(k) dk^2
+    double DirectionalSpectrum(double kx, double ky) const;
+
+    template <typename Func> void ForEachRowBand(int rows, Func&& func)
+    {
+        if (m_samplesCount < InverseFft2D::PARALLEL_MIN_SIZE)
+        {
+            func(0, rows);
+            return;
+        }
+        Workers().ParallelFor(rows, BAND_ROWS, func);
+    }
+
+    OceanParameters m_parameters;
+    int m_samplesCount;
+    double m_time;
+    float m_textureScale; // meters to texture heights
+
+    std::vector<std::complex<float>> m_spectrum; // h0(k), row-major by frequency index
+    std::vector<float> m_omega;                  // angular frequency w(k)
+    std::vector<float> m_heightsRe;              // FFT buffers, the heights after the transform
+    std::vector<float> m_heightsIm;
+    InverseFft2D m_fft;
+
+    kernels::SimdLevel m_simdLevel;
+    SurfaceTexture m_surfaceTexture;
+};
+} // namespace mini::gk2
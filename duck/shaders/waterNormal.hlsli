@@ -0,0 +1,33 @@
+// Encoding of the water normal map, matches mini::gk2::NormalMapEncoding
+static const uint NORMAL_ENCODING_RGBA8 = 0;
+static const uint NORMAL_ENCODING_R16F = 3; // R16F and R32F hold heights instead of normals
+
+cbuffer cbWaterParams : register(b3) //Pixel Shader constant buffer slot 3
+{
+    uint normalEncoding;
+};
+
+float3 sampleWaterNormal(Texture2D normalMap, SamplerState samp, float2 tex)
+{
+    if (normalEncoding >= NORMAL_ENCODING_R16F)
+    {
+        // Same central differences as the normals built on the CPU (Blinn method)
+        float width, height;
+        normalMap.GetDimensions(width, height);
+        float2 texel = 1.0 / float2(width, height);
+
+        float left = normalMap.SampleLevel(samp, tex - float2(texel.x, 0.0), 0).r;
+        float right = normalMap.SampleLevel(samp, tex + float2(texel.x, 0.0), 0).r;
+        float up = normalMap.SampleLevel(samp, tex - float2(0.0, texel.y), 0).r;
+        float down = normalMap.SampleLevel(samp, tex + float2(0.0, texel.y), 0).r;
+        return normalize(float3(left - right, 1.0, up - down));
+    }
+
+    float4 texel = normalMap.SampleLevel(samp, tex, 0);
+    if (normalEncoding == NORMAL_ENCODING_RGBA8)
+        return texel.xyz * 2.0 - 1.0;
+
+    // The two channel encodings (RG8, BC5) store only x and z, y of a height field normal is always positive
+    float2 xz = texel.xy * 2.0 - 1.0;
+    return float3(xz.x, sqrt(saturate(1.0 - dot(xz, xz))), xz.y);
+}
@@ -4,6 +4,8 @@ Texture2D surfaceNormalMap : register(t1);
 SamplerState samp : register(s0);
 SamplerState normalMapSamp : register(s1);
 
+#include "waterNormal.hlsli"
+
 cbuffer cbView : register(b2) //Vertex Shader constant buffer slot 1
 {
     matrix viewMatrix;
@@ -54,7 +56,7 @@ float3 intersectRay(float3 origin, float3 dir)
 float4 main(PSInput i) : SV_TARGET
 {
     float2 tex = 0.5 * (i.inCubePos.xz + float2(1.0, 1.0));
-    float3 norm = surfaceNormalMap.Sample(normalMapSamp, tex) * 2.0 - 1.0;
+    float3 norm = sampleWaterNormal(surfaceNormalMap, normalMapSamp, tex);
 
     float3 camPos = mul(invViewMatrix, float4(0.0f, 0.0f, 0.0f, 1.0f)).xyz;
     float3 viewVec = normalize(camPos - i.worldPos);
@@ -0,0 +1,222 @@
+#include "pch.h"
+
+#include "shallowWaterSimulation.h"
+#include "utils/profiling.h"
+#include <cmath>
+#include <numbers>
+
+mini::gk2::ShallowWaterSimulation::ShallowWaterSimulation(int samplesCount)
+    : Simulation(), m_samplesCount(0), m_gravity(0.f), m_simdLevel(kernels::DetectSimdLevel()),
+      m_faceRow(kernels::SelectShallowFaceRow(m_simdLevel)), m_heightRow(kernels::SelectShallowHeightRow(m_simdLevel))
+{
+    SetSimSpeed(ANIMATION_SPEED);
+    Resize(samplesCount);
+}
+
+void mini::gk2::ShallowWaterSimulation::Resize(int samplesCount)
+{
+    PROFILE_ZONE("ShallowWaterSimulation::Resize");
+    const auto previousSamplesCount = m_samplesCount;
+    m_samplesCount                  = std::clamp(samplesCount, MIN_SAMPLES, MAX_SAMPLES);
+    const auto n                    = static_cast<std::size_t>(m_samplesCount);
+
+    // The kernels work in cells and steps. A step of 1 / n moves a wave by WAVE_SPEED * n / n cells, well below the
+    // limit of 1 / sqrt(2) of the explicit scheme in two dimensions, and c^2 = g * depth gives the gravity.
+    SetStepTime(1.f / static_cast<float>(m_samplesCount));
+    const auto cellsPerStep = WAVE_SPEED * static_cast<float>(m_samplesCount) * static_cast<float>(StepTime());
+    m_gravity               = cellsPerStep * cellsPerStep / REST_DEPTH;
+
+    m_heights.assign(n * n, 0.f);
+    m_velocityX.assign(n * (n + 1), 0.f);
+    m_velocityY.assign((n + 1) * n, 0.f);
+    m_fluxX.assign(n * (n + 1), 0.f);
+    m_fluxY.assign((n + 1) * n, 0.f);
+
+    // The bodies keep their place in the pool, the water they displaced is gone
+    const auto scale = previousSamplesCount > 0 ? static_cast<float>(m_samplesCount) / previousSamplesCount : 1.f;
+    for (auto& body : m_bodies)
+    {
+        body.x *= scale;
+        body.y *= scale;
+        body.radius *= scale;
+        body.draft *= scale;
+        body.displacedX = body.x;
+        body.displacedY = body.y;
+    }
+
+    m_surfaceTexture.Resize(m_samplesCount);
+    m_surfaceTexture.Build(m_heights.data(), n, false, Workers());
+}
+
+double mini::gk2::ShallowWaterSimulation::Volume() const
+{
+    auto volume = 0.0;
+    for (const auto h : m_heights)
+    {
+        volume += h;
+    }
+    return volume;
+}
+
+void mini::gk2::ShallowWaterSimulation::SetNormalEncoding(NormalMapEncoding encoding)
+{
+    m_surfaceTexture.SetEncoding(encoding);
+    m_surfaceTexture.Build(m_heights.data(), m_samplesCount, false, Workers());
+}
+
+void mini::gk2::ShallowWaterSimulation::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_simdLevel = kernels::IsSupported(level) ? level : kernels::SimdLevel::Scalar;
+    m_faceRow   = kernels::SelectShallowFaceRow(m_simdLevel);
+    m_heightRow = kernels::SelectShallowHeightRow(m_simdLevel);
+    m_surfaceTexture.SetSimdLevel(m_simdLevel);
+}
+
+void mini::gk2::ShallowWaterSimulation::DropAt(float normalizedX, float normalizedY, float height)
+{
+    const auto n = static_cast<float>(m_samplesCount);
+    AddBump(normalizedX * n, normalizedY * n, DROP_RADIUS, height);
+}
+
+int mini::gk2::ShallowWaterSimulation::AddFloatingBody(float radius, float draft)
+{
+    // A height of 1 spans two cells
+    const auto n = static_cast<float>(m_samplesCount);
+    m_bodies.push_back({0.f, 0.f, 0.f, 0.f, radius * n, draft * n / 2.f, false});
+    return static_cast<int>(m_bodies.size()) - 1;
+}
+
+void mini::gk2::ShallowWaterSimulation::MoveFloatingBody(int body, float normalizedX, float normalizedY)
+{
+    auto& b = m_bodies[body];
+    b.x     = normalizedX * static_cast<float>(m_samplesCount);
+    b.y     = normalizedY * static_cast<float>(m_samplesCount);
+    if (!b.placed)
+    {
+        b.displacedX = b.x;
+        b.displacedY = b.y;
+        b.placed     = true;
+    }
+}
+
+mini::gk2::SurfaceSample mini::gk2::ShallowWaterSimulation::SampleSurface(float normalizedX, float normalizedY,
+                                                                          float radius) const
+{
+    const auto n = static_cast<float>(m_samplesCount);
+    const auto x = normalizedX * n;
+    const auto y = normalizedY * n;
+    const auto r = std::max(radius * n, 1.f);
+
+    const auto left  = Interpolate(x - r, y);
+    const auto right = Interpolate(x + r, y);
+    const auto up    = Interpolate(x, y - r);
+    const auto down  = Interpolate(x, y + r);
+
+    // Heights are in units of two cells, see the class comment
+    return {(left + right + up + down) / 4.f * 2.f / n, (right - left) / r, (down - up) / r};
+}
+
+float mini::gk2::ShallowWaterSimulation::Interpolate(float x, float y) const
+{
+    // Cell centers are at half integer coordinates
+    const auto maxCoordinate = static_cast<float>(m_samplesCount - 1);
+    const auto cx            = std::clamp(x - 0.5f, 0.f, maxCoordinate);
+    const auto cy            = std::clamp(y - 0.5f, 0.f, maxCoordinate);
+    const auto j             = std::min(static_cast<int>(cx), m_samplesCount - 2);
+    const auto i             = std::min(static_cast<int>(cy), m_samplesCount - 2);
+    const auto fx            = cx - static_cast<float>(j);
+    const auto fy            = cy - static_cast<float>(i);
+
+    const auto top    = Height(i, j) + fx * (Height(i, j + 1) - Height(i, j));
+    const auto bottom = Height(i + 1, j) + fx * (Height(i + 1, j + 1) - Height(i + 1, j));
+    return top + fy * (bottom - top);
+}
+
+void mini::gk2::ShallowWaterSimulation::AddBump(float x, float y, float radius, float height)
+{
+    const auto n     = m_samplesCount;
+    const auto iMin  = std::max(static_cast<int>(std::floor(y - radius)), 0);
+    const auto iMax  = std::min(static_cast<int>(std::ceil(y + radius)), n - 1);
+    const auto jMin  = std::max(static_cast<int>(std::floor(x - radius)), 0);
+    const auto jMax  = std::min(static_cast<int>(std::ceil(x + radius)), n - 1);
+    const auto scale = std::numbers::pi_v<float> / radius;
+    for (auto i = iMin; i <= iMax; i++)
+    {
+        for (auto j = jMin; j <= jMax; j++)
+        {
+            const auto dx       = static_cast<float>(j) + 0.5f - x;
+            const auto dy       = static_cast<float>(i) + 0.5f - y;
+            const auto distance = std::sqrt(dx * dx + dy * dy);
+            if (distance < radius)
+            {
+                m_heights[static_cast<std::size_t>(i) * n + j] += height * 0.5f * (1.f + std::cos(distance * scale));
+            }
+        }
+    }
+}
+
+void mini::gk2::ShallowWaterSimulation::DisplaceBodies()
+{
+    // Moving the displacement with the body keeps the volume (up to the parts cut off by the walls)
+    for (auto& body : m_bodies)
+    {
+        if (!body.placed || (body.x == body.displacedX && body.y == body.displacedY))
+        {
+            continue;
+        }
+        AddBump(body.displacedX, body.displacedY, body.radius, body.draft);
+        AddBump(body.x, body.y, body.radius, -body.draft);
+        body.displacedX = body.x;
+        body.displacedY = body.y;
+    }
+}
+
+void mini::gk2::ShallowWaterSimulation::Step()
+{
+    PROFILE_ZONE("ShallowWaterSimulation::Step");
+    DisplaceBodies();
+
+    const auto n          = m_samplesCount;
+    const auto facesInRow = static_cast<std::size_t>(n) + 1;
+    auto* heights         = m_heights.data();
+
+    // Faces first, a row of vertical faces (x velocities) and the row of horizontal faces above it. The faces on the
+    // walls are never written and stay at 0.
+    ForEachRowBand(n + 1,
+                   [&](int begin, int end)
+                   {
+                       for (auto i = begin; i < end; i++)
+                       {
+                           const auto* row = heights + static_cast<std::size_t>(i) * n;
+                           if (i < n)
+                           {
+                               const auto offset = i * facesInRow + 1;
+                               m_faceRow(row, row + 1, m_velocityX.data() + offset, m_fluxX.data() + offset, n - 1,
+                                         m_gravity, DAMPING, REST_DEPTH);
+                           }
+                           if (i > 0 && i < n)
+                           {
+                               const auto offset = static_cast<std::size_t>(i) * n;
+                               m_faceRow(row - n, row, m_velocityY.data() + offset, m_fluxY.data() + offset, n,
+                                         m_gravity, DAMPING, REST_DEPTH);
+                           }
+                       }
+                   });
+
+    // Then the cells, every flux leaves one cell and enters its neighbour
+    ForEachRowBand(n,
+                   [&](int begin, int end)
+                   {
+                       for (auto i = begin; i < end; i++)
+                       {
+                           const auto* up = m_fluxY.data() + static_cast<std::size_t>(i) * n;
+                           m_heightRow(m_fluxX.data() + i * facesInRow, up, up + n,
+                                       heights + static_cast<std::size_t>(i) * n, n, 1.f);
+                       }
+                   });
+}
+
+void mini::gk2::ShallowWaterSimulation::PostUpdate()
+{
+    m_surfaceTexture.Build(m_heights.data(), m_samplesCount, false, Workers());
+}
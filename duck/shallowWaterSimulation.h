@@ -0,0 +1,167 @@
+#pragma once
+#include "simulation.h"
+#include "surfaceTexture.h"
+
+namespace mini::gk2
+{
+// Water surface around a point, as seen by a floating body
+struct SurfaceSample
+{
+    float height; // above the rest level in pool widths
+    float slopeX; // dh/dx along the rows (normalized x)
+    float slopeY; // dh/dy along the columns (normalized y)
+};
+
+// Shallow water equations on a samplesCount x samplesCount staggered grid: the heights live in the cells, the
+// velocities on the faces between them. Every step accelerates the water on the faces down the slope of the surface
+// and then moves the water columns with the upwind fluxes through the faces, which keeps the volume exact. The
+// advection of the velocities is left out, it is invisible at the depths and speeds of the pool. The walls of the
+// pool let no water through.
+//
+// Floating bodies couple both ways: a moving body pushes the water out of its way and gives it back where it leaves,
+// which raises the bow wave and the wake, and SampleSurface() gives the height and the slope under a body to let it
+// bob and tilt.
+//
+// The heights are in the units of the normal map, a difference of 1 between the two neighbours of a cell is a slope of
+// 1, so the surface texture follows the contract of WaterSurfaceSimulation.
+class ShallowWaterSimulation final : public Simulation
+{
+  public:
+    explicit ShallowWaterSimulation(int samplesCount = SAMPLES_DEFAULT_SIZE);
+    ~ShallowWaterSimulation() final = default;
+
+    static constexpr int SAMPLES_DEFAULT_SIZE = 256;
+    static constexpr int MIN_SAMPLES          = 16;
+    static constexpr int MAX_SAMPLES          = 4096;
+
+    static constexpr float ANIMATION_SPEED = 0.2f;
+    static constexpr float WAVE_SPEED      = 0.5f;   // pool widths per unit of time, half a cell per step
+    static constexpr float REST_DEPTH      = 16.f;   // depth of the water at rest
+    static constexpr float DAMPING         = 0.998f; // part of the velocity kept by a step
+    static constexpr float DROP_HEIGHT     = 0.6f;
+    static constexpr float DROP_RADIUS     = 2.f; // cells
+
+    // Smaller grids are stepped on the calling thread, waking the workers costs more than the step itself
+    static constexpr int PARALLEL_MIN_SAMPLES = 256;
+    static constexpr int MIN_BAND_ROWS        = 16;
+    static constexpr int BANDS_PER_THREAD     = 4;
+
+    // Reallocates the grid (clamped to [MIN_SAMPLES, MAX_SAMPLES]) and resets the water to rest, the floating bodies
+    // stay. The surface texture has to be recreated with the new size afterwards.
+    void Resize(int samplesCount);
+
+    int SamplesCount() const
+    {
+        return m_samplesCount;
+    }
+
+    // Height above the rest level of the cell in row i, column j
+    float Height(int i, int j) const
+    {
+        return m_heights[static_cast<std::size_t>(i) * m_samplesCount + j];
+    }
+
+    // Sum of the heights, constant apart from the drops
+    double Volume() const;
+
+    // Raises a smooth bump of DROP_RADIUS cells
+    void DropAt(float normalizedX, float normalizedY, float height = DROP_HEIGHT);
+
+    // Adds a body pushing the water aside over `radius` and `draft` deep (in pool widths) and returns its index. The
+    // body displaces no water until its first move.
+    int AddFloatingBody(float radius, float draft);
+
+    // The water is displaced by the next step
+    void MoveFloatingBody(int body, float normalizedX, float normalizedY);
+
+    // Height and slope of the surface around the point, measured `radius` (in pool widths) away from it in the four
+    // directions. A body sampling at its own radius ignores its own displacement and feels only the waves longer than
+    // itself. Four bilinear samples, independent of the radius and the grid size.
+    SurfaceSample SampleSurface(float normalizedX, float normalizedY, float radius) const;
+
+    // Same as WaterSurfaceSimulation::SetNormalEncoding
+    void SetNormalEncoding(NormalMapEncoding encoding);
+
+    NormalMapEncoding NormalEncoding() const
+    {
+        return m_surfaceTexture.Encoding();
+    }
+
+    const std::uint8_t* SurfaceTextureData() const
+    {
+        return m_surfaceTexture.Data();
+    }
+
+    unsigned int SurfaceTextureRowPitch() const
+    {
+        return m_surfaceTexture.RowPitch();
+    }
+
+    int SurfaceTextureRows() const
+    {
+        return m_surfaceTexture.Rows();
+    }
+
+    // Selects the kernels, unsupported instruction sets fall back to the scalar kernels
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    kernels::SimdLevel SimdLevel() const
+    {
+        return m_simdLevel;
+    }
+
+  protected:
+    void Step() final;
+    void PostUpdate() final;
+
+  private:
+    // Position and size in cells, the displacement in heights
+    struct FloatingBody
+    {
+        float x;
+        float y;
+        float displacedX; // position of the water displaced so far
+        float displacedY;
+        float radius;
+        float draft;
+        bool placed;
+    };
+
+    void DisplaceBodies();
+
+    // Adds a cosine bump of `height` and `radius` centered at (x, y)
+    void AddBump(float x, float y, float radius, float height);
+
+    // Bilinear height at the cell coordinates, clamped to the grid
+    float Interpolate(float x, float y) const;
+
+    // Calls func(begin, end) for bands of rows covering [0, rows), in parallel for large grids
+    template <typename Func> void ForEachRowBand(int rows, Func&& func)
+    {
+        if (m_samplesCount < PARALLEL_MIN_SAMPLES)
+        {
+            func(0, rows);
+            return;
+        }
+        auto& workers       = Workers();
+        const auto bands    = static_cast<int>(workers.ThreadCount()) * BANDS_PER_THREAD;
+        const auto bandRows = std::max(MIN_BAND_ROWS, (rows + bands - 1) / bands);
+        workers.ParallelFor(rows, bandRows, func);
+    }
+
+    int m_samplesCount;
+    float m_gravity; // acceleration per unit of slope in cells per step squared, gives WAVE_SPEED at REST_DEPTH
+
+    std::vector<float> m_heights;   // samplesCount x samplesCount cells
+    std::vector<float> m_velocityX; // samplesCount rows of samplesCount + 1 faces, the first and the last are walls
+    std::vector<float> m_velocityY; // samplesCount + 1 rows of samplesCount faces, the first and the last are walls
+    std::vector<float> m_fluxX;     // same layout as m_velocityX
+    std::vector<float> m_fluxY;     // same layout as m_velocityY
+    std::vector<FloatingBody> m_bodies;
+
+    kernels::SimdLevel m_simdLevel;
+    kernels::ShallowFaceRowFn m_faceRow;
+    kernels::ShallowHeightRowFn m_heightRow;
+    SurfaceTexture m_surfaceTexture;
+};
+} // namespace mini::gk2
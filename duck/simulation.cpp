@@ -2,8 +2,12 @@
 
 #include "simulation.h"
 #include "utils/profiling.h"
+#include <cmath>
 
-mini::gk2::Simulation::Simulation() : m_simSpeed(1.0), m_deltaTime(0.0), m_stepTime(0.01666666)
+mini::gk2::Simulation::Simulation()
+    : m_stepTime(0.01666666), m_simSpeed(1.0), m_deltaTime(0.0), m_isLastStep(false), m_pendingSteps(0),
+      m_maxStepsPerUpdate(DEFAULT_MAX_STEPS_PER_UPDATE), m_droppedTimePolicy(DroppedTimePolicy::Discard),
+      m_droppedTime(0.0), m_threadPool(&ThreadPool::Shared())
 {
 }
 
@@ -13,15 +17,34 @@ bool mini::gk2::Simulation::Update(double dt)
 
     m_deltaTime += m_simSpeed * dt;
 
-    bool result = false;
-    while (m_deltaTime > m_stepTime)
+    // Counted with the same subtractions as the ones after the steps, so that the count matches them exactly
+    m_pendingSteps = 0;
+    for (auto time = m_deltaTime; time > m_stepTime && m_pendingSteps < m_maxStepsPerUpdate; time -= m_stepTime)
     {
-        Step();
-        m_deltaTime -= m_stepTime;
-        result = true;
+        m_pendingSteps++;
     }
 
-    m_deltaTime = std::max<float>(m_deltaTime, 0.f);
+    const bool result = m_pendingSteps > 0;
+    if (result)
+    {
+        const auto steps = m_pendingSteps;
+        m_isLastStep     = steps == 1;
+        StepN(steps);
+        assert(m_pendingSteps == 0);
+        for (auto step = 0; step < steps; step++)
+        {
+            m_deltaTime -= m_stepTime;
+        }
+    }
+
+    // Over the step limit, only the fraction of a step is kept with Discard
+    if (m_deltaTime > m_stepTime && m_droppedTimePolicy == DroppedTimePolicy::Discard)
+    {
+        const auto kept = std::fmod(m_deltaTime, m_stepTime);
+        m_droppedTime += m_deltaTime - kept;
+        m_deltaTime = kept;
+    }
+    m_deltaTime = std::max(m_deltaTime, 0.0);
 
     if (result)
     {
@@ -29,3 +52,22 @@ bool mini::gk2::Simulation::Update(double dt)
     }
     return result;
 }
+
+void mini::gk2::Simulation::StepN(int count)
+{
+    for (auto step = 0; step < count; step++)
+    {
+        Step();
+        StepDone();
+    }
+}
+
+void mini::gk2::Simulation::StepDone()
+{
+    m_pendingSteps--;
+    m_isLastStep = m_pendingSteps == 1;
+    if (m_stepObserver)
+    {
+        m_stepObserver();
+    }
+}
@@ -1,12 +1,27 @@
 #pragma once
+#include "threadPool.h"
+#include <algorithm>
+#include <functional>
+
 namespace mini::gk2
 {
+// What Update() does with the time it could not step because of the step limit
+enum class DroppedTimePolicy
+{
+    Discard, // the whole steps are dropped, the simulation slows down instead of falling further behind
+    Carry,   // kept and stepped by the following updates, at most the step limit each
+};
+
+// Fixed timestep simulation: Update() advances the simulated time by dt * SimSpeed() in steps of StepTime(). The time
+// left below a whole step carries over to the next update, InterpolationAlpha() tells how far into the next step the
+// wall clock is.
 class Simulation
 {
   public:
     Simulation();
     virtual ~Simulation() = default;
 
+    // Runs at most MaxStepsPerUpdate() steps, returns whether any ran
     bool Update(double dt);
 
     double StepTime() const
@@ -24,10 +39,66 @@ class Simulation
         m_simSpeed = stepTime;
     }
 
+    // After a stall (window drag, debugger) an update would otherwise run hundreds of steps, take even longer and fall
+    // further behind
+    static constexpr int DEFAULT_MAX_STEPS_PER_UPDATE = 64;
+
+    int MaxStepsPerUpdate() const
+    {
+        return m_maxStepsPerUpdate;
+    }
+
+    void SetMaxStepsPerUpdate(int maxSteps)
+    {
+        m_maxStepsPerUpdate = std::max(maxSteps, 1);
+    }
+
+    gk2::DroppedTimePolicy DroppedTimePolicy() const
+    {
+        return m_droppedTimePolicy;
+    }
+
+    void SetDroppedTimePolicy(gk2::DroppedTimePolicy policy)
+    {
+        m_droppedTimePolicy = policy;
+    }
+
+    // Simulated time discarded by the step limit since the construction
+    double DroppedSimulationTime() const
+    {
+        return m_droppedTime;
+    }
+
+    // Fraction of a step in [0, 1] the wall clock is past the last step. Renderers blending the last two states with
+    // it show smooth motion with steps longer than a frame, one step behind the simulation.
+    double InterpolationAlpha() const
+    {
+        return std::clamp(m_deltaTime / m_stepTime, 0.0, 1.0);
+    }
+
+    // Pool used by data-parallel steps, defaults to ThreadPool::Shared()
+    void SetThreadPool(ThreadPool& pool)
+    {
+        m_threadPool = &pool;
+    }
+
+    // Called after every step, e.g. to hash the state of each step while replaying a recording
+    void SetStepObserver(std::function<void()> observer)
+    {
+        m_stepObserver = std::move(observer);
+    }
+
   protected:
     virtual void PostUpdate() {};
     virtual void Step() = 0;
 
+    // Runs the `count` steps of an Update(), the default calls Step() for each. Overrides hoist the work shared by the
+    // steps out of the loop or fuse several steps into one pass, they call StepDone() after every step.
+    virtual void StepN(int count);
+
+    // Bookkeeping of a finished step: PendingSteps(), IsLastStep() and the step observer
+    void StepDone();
+
     double DeltaTime() const
     {
         return m_deltaTime;
@@ -38,9 +109,33 @@ class Simulation
         m_stepTime = stepTime;
     }
 
+    // True while executing the last step of the current Update(), lets subclasses fuse PostUpdate() work into it
+    bool IsLastStep() const
+    {
+        return m_isLastStep;
+    }
+
+    // Number of steps left in the current Update(), including the one executing
+    int PendingSteps() const
+    {
+        return m_pendingSteps;
+    }
+
+    ThreadPool& Workers() const
+    {
+        return *m_threadPool;
+    }
+
   private:
     double m_stepTime;
     double m_simSpeed;
     double m_deltaTime;
+    bool m_isLastStep;
+    int m_pendingSteps;
+    int m_maxStepsPerUpdate;
+    gk2::DroppedTimePolicy m_droppedTimePolicy;
+    double m_droppedTime;
+    ThreadPool* m_threadPool;
+    std::function<void()> m_stepObserver;
 };
 } // namespace mini::gk2
@@ -0,0 +1,150 @@
+#include "pch.h"
+
+#include "duckSimulation.h"
+#include "simulationRecording.h"
+#include "utils/profiling.h"
+#include "waterSurfaceSimulation.h"
+#include <chrono>
+
+namespace
+{
+constexpr std::array<char, 8> RECORDING_MAGIC = {'D', 'U', 'C', 'K', 'R', 'E', 'C', '\0'};
+
+template <typename T> void Write(std::ofstream& output, const T& value)
+{
+    output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T> bool Read(std::ifstream& input, T& value)
+{
+    return static_cast<bool>(input.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+} // namespace
+
+mini::gk2::SimulationRecording::SimulationRecording(std::uint32_t seed, int waterSamples, bool temporalBlocking,
+                                                    DirectX::XMFLOAT2 duckMin, DirectX::XMFLOAT2 duckMax)
+    : m_seed(seed), m_waterSamples(waterSamples), m_temporalBlocking(temporalBlocking), m_duckMin(duckMin),
+      m_duckMax(duckMax)
+{
+}
+
+void mini::gk2::SimulationRecording::RecordFrame(double dt)
+{
+    m_events.push_back({EventType::Frame, dt, 0.f, 0.f, 0.f, 0});
+}
+
+void mini::gk2::SimulationRecording::RecordDrop(float normalizedX, float normalizedY, float chance)
+{
+    m_events.push_back({EventType::Drop, 0.0, normalizedX, normalizedY, chance, 0});
+}
+
+void mini::gk2::SimulationRecording::RecordResize(int samplesCount)
+{
+    m_events.push_back({EventType::Resize, 0.0, 0.f, 0.f, 0.f, samplesCount});
+}
+
+bool mini::gk2::SimulationRecording::Save(const std::filesystem::path& path) const
+{
+    std::ofstream output(path, std::ios::binary);
+    if (!output)
+    {
+        return false;
+    }
+
+    // Field by field, the layout of the structs is up to the compiler
+    output.write(RECORDING_MAGIC.data(), RECORDING_MAGIC.size());
+    Write(output, FORMAT_VERSION);
+    Write(output, m_seed);
+    Write(output, m_waterSamples);
+    Write(output, static_cast<std::uint8_t>(m_temporalBlocking));
+    Write(output, m_duckMin);
+    Write(output, m_duckMax);
+    Write(output, static_cast<std::uint64_t>(m_events.size()));
+    for (const auto& event : m_events)
+    {
+        Write(output, event.type);
+        Write(output, event.dt);
+        Write(output, event.normalizedX);
+        Write(output, event.normalizedY);
+        Write(output, event.chance);
+        Write(output, event.samplesCount);
+    }
+    return static_cast<bool>(output);
+}
+
+bool mini::gk2::SimulationRecording::Load(const std::filesystem::path& path, SimulationRecording& recording)
+{
+    std::ifstream input(path, std::ios::binary);
+    std::array<char, RECORDING_MAGIC.size()> magic;
+    std::uint32_t version;
+    if (!input.read(magic.data(), magic.size()) || magic != RECORDING_MAGIC || !Read(input, version) ||
+        version != FORMAT_VERSION)
+    {
+        return false;
+    }
+
+    SimulationRecording result;
+    std::uint8_t temporalBlocking;
+    std::uint64_t eventsCount;
+    if (!Read(input, result.m_seed) || !Read(input, result.m_waterSamples) || !Read(input, temporalBlocking) ||
+        !Read(input, result.m_duckMin) || !Read(input, result.m_duckMax) || !Read(input, eventsCount))
+    {
+        return false;
+    }
+    result.m_temporalBlocking = temporalBlocking != 0;
+    for (std::uint64_t e = 0; e < eventsCount; e++)
+    {
+        Event event;
+        if (!Read(input, event.type) || !Read(input, event.dt) || !Read(input, event.normalizedX) ||
+            !Read(input, event.normalizedY) || !Read(input, event.chance) || !Read(input, event.samplesCount) ||
+            event.type > EventType::Resize)
+        {
+            return false;
+        }
+        result.m_events.push_back(event);
+    }
+    recording = std::move(result);
+    return true;
+}
+
+mini::gk2::ReplayResult mini::gk2::Replay(const SimulationRecording& recording, kernels::SimdLevel level,
+                                          bool hashSteps)
+{
+    PROFILE_ZONE("Replay");
+    WaterSurfaceSimulation water(recording.WaterSamples());
+    water.Seed(recording.Seed());
+    water.SetSimdLevel(level);
+    water.SetTemporalBlocking(recording.TemporalBlocking());
+    DuckSimulation duck(recording.DuckMin(), recording.DuckMax());
+    duck.Seed(recording.Seed());
+
+    ReplayResult result;
+    if (hashSteps)
+    {
+        water.SetStepObserver([&]() { result.waterHashes.push_back(water.StateHash()); });
+        duck.SetStepObserver([&]() { result.duckHashes.push_back(duck.StateHash()); });
+    }
+
+    // The water and the duck do not touch each other within a frame, so stepping them one after the other matches the
+    // concurrent updates of DuckDemo::Update(), the drops arrive after both as there
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& event : recording.Events())
+    {
+        switch (event.type)
+        {
+        case SimulationRecording::EventType::Frame:
+            water.Update(event.dt);
+            duck.Update(event.dt);
+            result.frames++;
+            break;
+        case SimulationRecording::EventType::Drop:
+            water.DropAt(event.normalizedX, event.normalizedY, event.chance);
+            break;
+        case SimulationRecording::EventType::Resize:
+            water.Resize(event.samplesCount);
+            break;
+        }
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "waterSurfaceKernels.h"
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace mini::gk2
+{
+// Everything the water and the duck of the demo depend on besides the code: the seed of both simulations, the initial
+// grid size, the temporal blocking of the water, the area of the duck and the sequence of frames with their time
+// steps, drops and resizes. Replaying a recording runs exactly the steps of the recorded session, on the calling thread
+// and as fast as possible.
+//
+// Only the wave equation water is recorded, the ocean has no inputs besides the time and the shallow water couples
+// the duck back to the water.
+class SimulationRecording
+{
+  public:
+    enum class EventType : std::uint32_t
+    {
+        Frame,  // Update(dt) of the water, then of the duck
+        Drop,   // DropAt() on the water
+        Resize, // Resize() of the water
+    };
+
+    struct Event
+    {
+        EventType type;
+        double dt;
+        float normalizedX;
+        float normalizedY;
+        float chance;
+        int samplesCount;
+    };
+
+    SimulationRecording() = default;
+    SimulationRecording(std::uint32_t seed, int waterSamples, bool temporalBlocking, DirectX::XMFLOAT2 duckMin,
+                        DirectX::XMFLOAT2 duckMax);
+
+    void RecordFrame(double dt);
+    void RecordDrop(float normalizedX, float normalizedY, float chance);
+    void RecordResize(int samplesCount);
+
+    std::uint32_t Seed() const
+    {
+        return m_seed;
+    }
+
+    int WaterSamples() const
+    {
+        return m_waterSamples;
+    }
+
+    bool TemporalBlocking() const
+    {
+        return m_temporalBlocking;
+    }
+
+    DirectX::XMFLOAT2 DuckMin() const
+    {
+        return m_duckMin;
+    }
+
+    DirectX::XMFLOAT2 DuckMax() const
+    {
+        return m_duckMax;
+    }
+
+    const std::vector<Event>& Events() const
+    {
+        return m_events;
+    }
+
+    // Binary little endian file, the time steps are stored as doubles so that a replay sees the same bits. Both
+    // return false on an I/O error, Load() also on a file of another format or version.
+    bool Save(const std::filesystem::path& path) const;
+    static bool Load(const std::filesystem::path& path, SimulationRecording& recording);
+
+    static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+  private:
+    std::uint32_t m_seed    = 0;
+    int m_waterSamples      = 0;
+    bool m_temporalBlocking = false;
+    DirectX::XMFLOAT2 m_duckMin{};
+    DirectX::XMFLOAT2 m_duckMax{};
+    std::vector<Event> m_events;
+};
+
+// State hashes of a replay, one per step of each simulation
+struct ReplayResult
+{
+    std::vector<std::uint64_t> waterHashes;
+    std::vector<std::uint64_t> duckHashes;
+    int frames          = 0;
+    double milliseconds = 0.0; // wall time of the whole replay
+};
+
+// Runs the recorded session headless with the water kernels of the given level. Without hashing the result only holds
+// the time, which then covers the simulations alone.
+ReplayResult Replay(const SimulationRecording& recording, kernels::SimdLevel level, bool hashSteps = true);
+} // namespace mini::gk2
@@ -0,0 +1,160 @@
+#include "pch.h"
+
+#include "simulationScheduler.h"
+#include "utils/profiling.h"
+#include <chrono>
+
+mini::gk2::SimulationScheduler::SimulationScheduler() : m_remaining(0), m_stop(false), m_dt(0.0), m_frameMs(0.0)
+{
+}
+
+mini::gk2::SimulationScheduler::~SimulationScheduler()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+mini::gk2::SimulationScheduler::Handle mini::gk2::SimulationScheduler::Add(Simulation& simulation,
+                                                                          std::initializer_list<Handle> dependencies)
+{
+    const auto handle = static_cast<Handle>(m_nodes.size());
+    auto& node        = m_nodes.emplace_back();
+    node.simulation   = &simulation;
+    for (const auto dependency : dependencies)
+    {
+        // A later handle or the new one itself would never finish before it, and Update() would wait forever
+        assert(dependency >= 0 && dependency < handle);
+        m_nodes[dependency].dependents.push_back(handle);
+        node.dependencies++;
+    }
+
+    // More threads than simulations would only sleep, more than cores would only preempt each other
+    if (m_workers.size() + 1 < std::min<std::size_t>(m_nodes.size(), ThreadPool::DefaultThreadCount()))
+    {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+    return handle;
+}
+
+void mini::gk2::SimulationScheduler::SetBeforeUpdate(Handle handle, std::function<void()> callback)
+{
+    m_nodes[handle].beforeUpdate = std::move(callback);
+}
+
+void mini::gk2::SimulationScheduler::SetAfterUpdate(Handle handle, std::function<void(bool updated)> callback)
+{
+    m_nodes[handle].afterUpdate = std::move(callback);
+}
+
+void mini::gk2::SimulationScheduler::Post(Handle sender, std::function<void()> message)
+{
+    m_nodes[sender].messages.push_back(std::move(message));
+}
+
+bool mini::gk2::SimulationScheduler::Update(double dt)
+{
+    PROFILE_ZONE("SimulationScheduler::Update");
+
+    const auto frameStart = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(m_mutex);
+        m_dt        = dt;
+        m_remaining = static_cast<int>(m_nodes.size());
+        m_ready.clear();
+        // Backwards, so that the lowest handles are taken first
+        for (auto handle = m_remaining - 1; handle >= 0; handle--)
+        {
+            m_nodes[handle].pendingDependencies = m_nodes[handle].dependencies;
+            if (m_nodes[handle].dependencies == 0)
+            {
+                m_ready.push_back(handle);
+            }
+        }
+    }
+    m_wake.notify_all();
+
+    while (true)
+    {
+        std::unique_lock lock(m_mutex);
+        m_wake.wait(lock, [this]() { return !m_ready.empty() || m_remaining == 0; });
+        if (m_remaining == 0)
+        {
+            break;
+        }
+        const auto handle = m_ready.back();
+        m_ready.pop_back();
+        lock.unlock();
+
+        Execute(handle);
+    }
+    m_frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+    // Every simulation is idle, the messages may touch any of them
+    auto result = false;
+    for (auto& node : m_nodes)
+    {
+        result = result || node.updated;
+        for (auto& message : node.messages)
+        {
+            message();
+        }
+        node.messages.clear();
+    }
+    return result;
+}
+
+void mini::gk2::SimulationScheduler::WorkerLoop()
+{
+    while (true)
+    {
+        std::unique_lock lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_stop || !m_ready.empty(); });
+        if (m_stop)
+        {
+            return;
+        }
+        const auto handle = m_ready.back();
+        m_ready.pop_back();
+        lock.unlock();
+
+        Execute(handle);
+    }
+}
+
+void mini::gk2::SimulationScheduler::Execute(Handle handle)
+{
+    auto& node = m_nodes[handle];
+    if (node.beforeUpdate)
+    {
+        node.beforeUpdate();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    node.updated     = node.simulation->Update(m_dt);
+    node.updateMs    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (node.afterUpdate)
+    {
+        node.afterUpdate(node.updated);
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto dependent : node.dependents)
+        {
+            if (--m_nodes[dependent].pendingDependencies == 0)
+            {
+                m_ready.push_back(dependent);
+            }
+        }
+        m_remaining--;
+    }
+    m_wake.notify_all();
+}
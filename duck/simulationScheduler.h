@@ -0,0 +1,98 @@
+#pragma once
+#include "simulation.h"
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mini::gk2
+{
+// Updates a set of simulations every frame. A simulation starts once the simulations it depends on finished their
+// Update(), independent ones run concurrently on the threads of the scheduler, so a frame takes as long as the longest
+// chain of dependencies instead of the sum of all the simulations.
+//
+// Simulations talk to each other through messages posted from their callbacks. The messages run on the thread calling
+// Update() once every simulation finished, in the order of the handles of their senders and then in the order they
+// were posted, so a frame has the same effect whatever the timing of the threads.
+//
+// Simulations sharing a ThreadPool take turns in its data-parallel loops, SetThreadPool() gives them their own.
+class SimulationScheduler
+{
+  public:
+    using Handle = int;
+
+    SimulationScheduler();
+    ~SimulationScheduler();
+
+    SimulationScheduler(const SimulationScheduler&)            = delete;
+    SimulationScheduler& operator=(const SimulationScheduler&) = delete;
+
+    // Dependencies are handles returned by earlier calls, so the graph has no cycles by construction
+    Handle Add(Simulation& simulation, std::initializer_list<Handle> dependencies = {});
+
+    // Runs on the thread of the simulation after its dependencies finished, right before its Update()
+    void SetBeforeUpdate(Handle handle, std::function<void()> callback);
+
+    // Runs on the thread of the simulation right after its Update() with its result, before the dependents start
+    void SetAfterUpdate(Handle handle, std::function<void(bool updated)> callback);
+
+    // Queues a message of the simulation `sender`, only its own callbacks may post
+    void Post(Handle sender, std::function<void()> message);
+
+    // Updates every simulation with dt and applies the messages, returns whether any simulation stepped
+    bool Update(double dt);
+
+    bool Updated(Handle handle) const
+    {
+        return m_nodes[handle].updated;
+    }
+
+    // Time of the last Update() of the simulation alone
+    double UpdateMs(Handle handle) const
+    {
+        return m_nodes[handle].updateMs;
+    }
+
+    // Wall time of the last Update(), without the messages
+    double FrameMs() const
+    {
+        return m_frameMs;
+    }
+
+    int SimulationsCount() const
+    {
+        return static_cast<int>(m_nodes.size());
+    }
+
+  private:
+    struct Node
+    {
+        Simulation* simulation = nullptr;
+        std::vector<Handle> dependents;
+        int dependencies        = 0;
+        int pendingDependencies = 0; // of the current frame
+        std::function<void()> beforeUpdate;
+        std::function<void(bool)> afterUpdate;
+        std::vector<std::function<void()>> messages;
+        bool updated    = false;
+        double updateMs = 0.0;
+    };
+
+    void WorkerLoop();
+    void Execute(Handle handle);
+
+    std::vector<Node> m_nodes;
+    std::vector<std::thread> m_workers; // one less than the simulations, the calling thread takes part too
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake; // a simulation got ready or the frame finished
+    std::vector<Handle> m_ready;    // simulations whose dependencies finished, waiting for a thread
+    int m_remaining;                // simulations of the current frame not finished yet
+    bool m_stop;
+
+    double m_dt;
+    double m_frameMs;
+};
+} // namespace mini::gk2
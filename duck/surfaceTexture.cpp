@@ -0,0 +1,98 @@
+#include "pch.h"
+
+#include "surfaceTexture.h"
+#include "utils/profiling.h"
+#include <cstring>
+
+mini::gk2::SurfaceTexture::SurfaceTexture()
+    : m_samplesCount(0), m_simdLevel(kernels::DetectSimdLevel()), m_normalRow(kernels::SelectNormalRow(m_simdLevel)),
+      m_floatToHalf(kernels::SelectFloatToHalfRow(m_simdLevel)), m_requestedEncoding(NormalMapEncoding::RGBA8),
+      m_encoding(NormalMapEncoding::RGBA8), m_texelSize(4)
+{
+}
+
+void mini::gk2::SurfaceTexture::Resize(int samplesCount)
+{
+    m_samplesCount = samplesCount;
+    m_zeroRow.assign(samplesCount, 0.f);
+    Reset();
+}
+
+void mini::gk2::SurfaceTexture::SetEncoding(NormalMapEncoding encoding)
+{
+    m_requestedEncoding = encoding;
+    Reset();
+}
+
+void mini::gk2::SurfaceTexture::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_simdLevel   = level;
+    m_normalRow   = kernels::SelectNormalRow(m_simdLevel, m_encoding);
+    m_floatToHalf = kernels::SelectFloatToHalfRow(m_simdLevel);
+}
+
+void mini::gk2::SurfaceTexture::Reset()
+{
+    const auto n = m_samplesCount;
+    m_encoding   = normalEncoding::Resolve(m_requestedEncoding, n, n);
+    m_normalRow  = kernels::SelectNormalRow(m_simdLevel, m_encoding);
+
+    const auto texelEncoding = m_encoding == NormalMapEncoding::BC5 ? NormalMapEncoding::RG8 : m_encoding;
+    m_texelSize = static_cast<int>(normalEncoding::RowPitch(texelEncoding, 1));
+    m_normalMap.assign(normalEncoding::EncodedSize(texelEncoding, n, n), 0);
+    if (m_encoding == NormalMapEncoding::BC5)
+    {
+        m_compressedNormalMap.assign(normalEncoding::EncodedSize(m_encoding, n, n), 0);
+    }
+    else
+    {
+        m_compressedNormalMap.clear();
+    }
+}
+
+void mini::gk2::SurfaceTexture::Build(const float* heights, std::size_t stride, bool periodic, ThreadPool& workers)
+{
+    PROFILE_ZONE("SurfaceTexture::Build");
+    const auto n   = m_samplesCount;
+    const auto row = [&](int i) -> const float*
+    {
+        if (i < 0 || i >= n)
+        {
+            return periodic ? heights + ((i + n) % n) * stride : m_zeroRow.data();
+        }
+        return heights + i * stride;
+    };
+
+    ForEachRowBand(n, workers,
+                   [&](int begin, int end)
+                   {
+                       for (auto i = begin; i < end; i++)
+                       {
+                           auto* dest = m_normalMap.data() + static_cast<std::size_t>(m_texelSize) * i * n;
+                           if (m_encoding == NormalMapEncoding::R16F)
+                           {
+                               m_floatToHalf(row(i), reinterpret_cast<std::uint16_t*>(dest), n);
+                           }
+                           else if (m_encoding == NormalMapEncoding::R32F)
+                           {
+                               std::memcpy(dest, row(i), n * sizeof(float));
+                           }
+                           else
+                           {
+                               m_normalRow(row(i - 1), row(i), row(i + 1), dest, n, 0, n);
+                           }
+                       }
+                   });
+
+    if (m_encoding == NormalMapEncoding::BC5)
+    {
+        PROFILE_ZONE("SurfaceTexture::EncodeBC5")
+        const auto blocks = n / normalEncoding::BC_BLOCK_SIZE;
+        ForEachRowBand(blocks, workers,
+                       [&](int begin, int end)
+                       {
+                           normalEncoding::EncodeBC5(m_normalMap.data(), n, begin, end, 0, blocks,
+                                                     m_compressedNormalMap.data());
+                       });
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "normalMapEncoding.h"
+#include "threadPool.h"
+#include "waterSurfaceKernels.h"
+#include <cstdint>
+#include <vector>
+
+namespace mini::gk2
+{
+// Contents of a water surface texture encoded from a whole height field at once, in the encodings and with the upload
+// of WaterSurfaceSimulation (which tracks the dirty tiles itself). Used by the simulations changing every cell in
+// every step.
+class SurfaceTexture
+{
+  public:
+    SurfaceTexture();
+
+    // Grids of at least PARALLEL_MIN_SAMPLES are encoded with the thread pool, BAND_ROWS rows per task
+    static constexpr int PARALLEL_MIN_SAMPLES = 256;
+    static constexpr int BAND_ROWS            = 32;
+
+    // Reallocates the texture for samplesCount x samplesCount texels, the contents are undefined until Build()
+    void Resize(int samplesCount);
+
+    // Same as WaterSurfaceSimulation::SetNormalEncoding, the texture has to be rebuilt and recreated afterwards
+    void SetEncoding(NormalMapEncoding encoding);
+
+    // Encoding actually used for the current size
+    NormalMapEncoding Encoding() const
+    {
+        return m_encoding;
+    }
+
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    // Encodes the heights, rows `stride` floats apart. With `periodic` the first and the last row are neighbours,
+    // otherwise the heights above and below the grid are 0. The kernels treat the columns outside a row as 0.
+    void Build(const float* heights, std::size_t stride, bool periodic, ThreadPool& workers);
+
+    // Rows() rows of RowPitch() bytes
+    const std::uint8_t* Data() const
+    {
+        return m_encoding == NormalMapEncoding::BC5 ? m_compressedNormalMap.data() : m_normalMap.data();
+    }
+
+    unsigned int RowPitch() const
+    {
+        return static_cast<unsigned int>(normalEncoding::RowPitch(m_encoding, m_samplesCount));
+    }
+
+    int Rows() const
+    {
+        return normalEncoding::PitchRows(m_encoding, m_samplesCount);
+    }
+
+  private:
+    void Reset();
+
+    template <typename Func> void ForEachRowBand(int rows, ThreadPool& workers, Func&& func) const
+    {
+        if (m_samplesCount < PARALLEL_MIN_SAMPLES)
+        {
+            func(0, rows);
+            return;
+        }
+        workers.ParallelFor(rows, BAND_ROWS, func);
+    }
+
+    int m_samplesCount;
+    kernels::SimdLevel m_simdLevel;
+    kernels::NormalRowFn m_normalRow;
+    kernels::FloatToHalfRowFn m_floatToHalf;
+
+    NormalMapEncoding m_requestedEncoding;
+    NormalMapEncoding m_encoding;
+    int m_texelSize; // bytes per texel of m_normalMap
+    std::vector<std::uint8_t> m_normalMap;
+    std::vector<std::uint8_t> m_compressedNormalMap; // BC5 blocks of m_normalMap
+    std::vector<float> m_zeroRow;                    // neighbour of the border rows of a grid that is not periodic
+};
+} // namespace mini::gk2
@@ -0,0 +1,64 @@
+#include "pch.h"
+
+#include "surfaceUpload.h"
+#include "utils/profiling.h"
+
+void mini::gk2::MapSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture, const std::uint8_t* data,
+                                  unsigned int rowSize, int rows)
+{
+    PROFILE_ZONE("MapSurfaceTexture");
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = device.context()->Map(texture.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+    if (SUCCEEDED(hr))
+    {
+        BYTE* dest      = reinterpret_cast<BYTE*>(mapped.pData);
+        const BYTE* src = data;
+        for (auto y = 0; y < rows; ++y)
+        {
+            memcpy(dest, src, rowSize);
+            dest += mapped.RowPitch;
+            src += rowSize;
+        }
+
+        device.context()->Unmap(texture.get(), 0);
+    }
+}
+
+void mini::gk2::MapSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture,
+                                  WaterSurfaceSimulation& simulation)
+{
+    MapSurfaceTexture(device, texture, simulation.SurfaceTextureData(), simulation.SurfaceTextureRowPitch(),
+                      simulation.SurfaceTextureRows());
+    simulation.SurfaceDirtyRegions().Clear();
+}
+
+void mini::gk2::UploadSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture,
+                                     WaterSurfaceSimulation& simulation)
+{
+    PROFILE_ZONE("UploadSurfaceTexture");
+    const auto* data   = simulation.SurfaceTextureData();
+    const auto rowSize = simulation.SurfaceTextureRowPitch();
+    auto& dirtyRegions = simulation.SurfaceDirtyRegions();
+    if (dirtyRegions.FullUpload())
+    {
+        device.context()->UpdateSubresource(texture.get(), 0, nullptr, data, rowSize, 0);
+    }
+    else
+    {
+        // The rectangles consist of whole tiles, so they are aligned to the BC5 blocks as well
+        for (const auto& rect : dirtyRegions.Rects())
+        {
+            D3D11_BOX box = {};
+            box.left      = rect.left;
+            box.top       = rect.top;
+            box.right     = rect.right;
+            box.bottom    = rect.bottom;
+            box.back      = 1;
+
+            const auto* src = data + normalEncoding::Offset(simulation.NormalEncoding(), simulation.SamplesCount(),
+                                                            rect.left, rect.top);
+            device.context()->UpdateSubresource(texture.get(), 0, &box, src, rowSize, 0);
+        }
+    }
+    dirtyRegions.Clear();
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "dxDevice.h"
+#include "waterSurfaceSimulation.h"
+#include <cstdint>
+
+namespace mini::gk2
+{
+// Uploads of the surface textures. The simulations only keep the contents of the textures in memory and know nothing
+// about D3D11, so that they also build without a device.
+
+// Rewrites a D3D11_USAGE_DYNAMIC texture with `rows` rows of `rowSize` bytes (rows of blocks for BC5)
+void MapSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture, const std::uint8_t* data,
+                       unsigned int rowSize, int rows);
+
+// Rewrites the whole D3D11_USAGE_DYNAMIC texture with the surface of a simulation following the contract of
+// WaterSurfaceSimulation (OceanSimulation, ShallowWaterSimulation)
+template <typename Simulation>
+void MapSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture, const Simulation& simulation)
+{
+    MapSurfaceTexture(device, texture, simulation.SurfaceTextureData(), simulation.SurfaceTextureRowPitch(),
+                      simulation.SurfaceTextureRows());
+}
+
+// Rewrites the whole D3D11_USAGE_DYNAMIC texture and clears the dirty regions of the simulation
+void MapSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture, WaterSurfaceSimulation& simulation);
+
+// Copies only the regions changed since the last upload into a D3D11_USAGE_DEFAULT texture, or everything once the
+// dirty area gets large
+void UploadSurfaceTexture(const DxDevice& device, dx_ptr<ID3D11Texture2D>& texture, WaterSurfaceSimulation& simulation);
+} // namespace mini::gk2
@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#include "dirtyRegions.h"
+#include <limits>
+
+namespace
+{
+mini::DirtyRect Union(const mini::DirtyRect& a, const mini::DirtyRect& b)
+{
+    return {std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom)};
+}
+
+// Overlapping rectangles or rectangles sharing a part of an edge, their union is one copy instead of two. Rectangles
+// meeting only at a corner are not touching, their union would add two quadrants of unchanged texels.
+bool Touching(const mini::DirtyRect& a, const mini::DirtyRect& b)
+{
+    const auto columnsOverlap = a.left < b.right && b.left < a.right;
+    const auto rowsOverlap    = a.top < b.bottom && b.top < a.bottom;
+    const auto columnsMeet    = a.left <= b.right && b.left <= a.right;
+    const auto rowsMeet       = a.top <= b.bottom && b.top <= a.bottom;
+    return (columnsOverlap && rowsMeet) || (rowsOverlap && columnsMeet);
+}
+} // namespace
+
+mini::DirtyRegions::DirtyRegions()
+    : m_width(0), m_height(0), m_maxRects(DEFAULT_MAX_RECTS), m_fullUploadAreaFactor(DEFAULT_FULL_UPLOAD_AREA_FACTOR),
+      m_full(false)
+{
+}
+
+void mini::DirtyRegions::Reset(int width, int height)
+{
+    m_width  = std::max(width, 0);
+    m_height = std::max(height, 0);
+    MarkAll();
+}
+
+void mini::DirtyRegions::Add(DirtyRect rect)
+{
+    if (m_full)
+    {
+        return;
+    }
+
+    rect.left   = std::max(rect.left, 0);
+    rect.top    = std::max(rect.top, 0);
+    rect.right  = std::min(rect.right, m_width);
+    rect.bottom = std::min(rect.bottom, m_height);
+    if (rect.Empty())
+    {
+        return;
+    }
+
+    m_rects.push_back(rect);
+    MergeTouching();
+    while (static_cast<int>(m_rects.size()) > m_maxRects)
+    {
+        MergeCheapestPair();
+    }
+}
+
+void mini::DirtyRegions::MarkAll()
+{
+    m_rects.clear();
+    m_full = true;
+}
+
+void mini::DirtyRegions::Clear()
+{
+    m_rects.clear();
+    m_full = false;
+}
+
+void mini::DirtyRegions::SetMaxRects(int count)
+{
+    m_maxRects = std::max(count, 1);
+    while (static_cast<int>(m_rects.size()) > m_maxRects)
+    {
+        MergeCheapestPair();
+    }
+}
+
+void mini::DirtyRegions::SetFullUploadAreaFactor(double factor)
+{
+    m_fullUploadAreaFactor = factor;
+}
+
+bool mini::DirtyRegions::FullUpload() const
+{
+    const auto imageArea = static_cast<long long>(m_width) * m_height;
+    return m_full || static_cast<double>(DirtyArea()) > m_fullUploadAreaFactor * static_cast<double>(imageArea);
+}
+
+long long mini::DirtyRegions::DirtyArea() const
+{
+    if (m_full)
+    {
+        return static_cast<long long>(m_width) * m_height;
+    }
+
+    long long area = 0;
+    for (const auto& rect : m_rects)
+    {
+        area += rect.Area();
+    }
+    return area;
+}
+
+void mini::DirtyRegions::MergeTouching()
+{
+    // The last rectangle is the only one that may touch others, but a merged union can grow into further ones, so the
+    // grown rectangle is moved to the back and checked again
+    for (auto merged = true; merged;)
+    {
+        merged      = false;
+        auto& added = m_rects.back();
+        for (auto i = 0; i + 1 < static_cast<int>(m_rects.size()); i++)
+        {
+            if (Touching(m_rects[i], added))
+            {
+                added = Union(m_rects[i], added);
+                m_rects.erase(m_rects.begin() + i);
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+void mini::DirtyRegions::MergeCheapestPair()
+{
+    auto bestI    = 0;
+    auto bestJ    = 1;
+    auto bestCost = std::numeric_limits<long long>::max();
+    for (auto i = 0; i < static_cast<int>(m_rects.size()); i++)
+    {
+        for (auto j = i + 1; j < static_cast<int>(m_rects.size()); j++)
+        {
+            // Texels uploaded in vain after merging the pair
+            const auto cost = Union(m_rects[i], m_rects[j]).Area() - m_rects[i].Area() - m_rects[j].Area();
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestI    = i;
+                bestJ    = j;
+            }
+        }
+    }
+
+    const auto merged = Union(m_rects[bestI], m_rects[bestJ]);
+    m_rects.erase(m_rects.begin() + bestJ);
+    m_rects.erase(m_rects.begin() + bestI);
+    m_rects.push_back(merged);
+    MergeTouching();
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+
+namespace mini
+{
+// Half-open rectangle [left, right) x [top, bottom) in texels
+struct DirtyRect
+{
+    int left   = 0;
+    int top    = 0;
+    int right  = 0;
+    int bottom = 0;
+
+    int Width() const
+    {
+        return right - left;
+    }
+
+    int Height() const
+    {
+        return bottom - top;
+    }
+
+    long long Area() const
+    {
+        return static_cast<long long>(Width()) * Height();
+    }
+
+    bool Empty() const
+    {
+        return right <= left || bottom <= top;
+    }
+};
+
+// Collects the regions of an image modified since the last upload. Overlapping rectangles and rectangles sharing a part
+// of an edge are merged into their bounding box (rectangles meeting only at a corner are kept apart) and the list is
+// kept short, so that every rectangle can be uploaded with a single copy. Once the dirty area passes a fraction of the
+// image a full upload is requested instead.
+class DirtyRegions
+{
+  public:
+    static constexpr int DEFAULT_MAX_RECTS                  = 16;
+    static constexpr double DEFAULT_FULL_UPLOAD_AREA_FACTOR = 0.5;
+
+    DirtyRegions();
+
+    // Sets the image size and marks the whole image dirty
+    void Reset(int width, int height);
+
+    // Adds a rectangle, clipped to the image
+    void Add(DirtyRect rect);
+    void MarkAll();
+    void Clear();
+
+    // Upper bound of the rectangle count, the cheapest pairs are merged when exceeded
+    void SetMaxRects(int count);
+    void SetFullUploadAreaFactor(double factor);
+
+    bool Empty() const
+    {
+        return !m_full && m_rects.empty();
+    }
+
+    // True when the whole image was marked or the dirty area passed the threshold
+    bool FullUpload() const;
+
+    long long DirtyArea() const;
+
+    // Disjoint rectangles covering the modified texels, meaningless when FullUpload() is set
+    const std::vector<DirtyRect>& Rects() const
+    {
+        return m_rects;
+    }
+
+    int Width() const
+    {
+        return m_width;
+    }
+
+    int Height() const
+    {
+        return m_height;
+    }
+
+  private:
+    void MergeTouching();
+    void MergeCheapestPair();
+
+    std::vector<DirtyRect> m_rects;
+    int m_width;
+    int m_height;
+    int m_maxRects;
+    double m_fullUploadAreaFactor;
+    bool m_full;
+};
+} // namespace mini
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace mini
@@ -9,4 +11,26 @@ template <class T> inline void HashCombine(std::size_t& seed, const T& v)
     std::hash<T> hasher;
     seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
+
+// FNV-1a over 64 bit words with an extra shift, so that the high bits of a word reach the low bits of the hash. Fast
+// enough to hash a whole height field every step, the same bytes give the same hash on every machine.
+inline std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ull)
+{
+    constexpr std::uint64_t PRIME = 0x100000001b3ull;
+
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    std::size_t i     = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * PRIME;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * PRIME;
+    }
+    return hash;
+}
 } // namespace mini
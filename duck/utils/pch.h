@@ -19,5 +19,9 @@
 #include <string>
 
 #include <DirectXMath.h>
+#ifdef _WIN32
+// std::min / std::max instead of the Windows.h macros
+#define NOMINMAX
 #include <Windows.h>
 #include <dinput.h>
+#endif
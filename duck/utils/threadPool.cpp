@@ -0,0 +1,124 @@
+#include "pch.h"
+
+#include "threadPool.h"
+
+namespace
+{
+// Set for pool workers and for a thread executing its own job, nested ParallelFor calls run inline
+thread_local bool t_insideJob = false;
+} // namespace
+
+mini::ThreadPool::ThreadPool(unsigned int threadCount)
+    : m_generation(0), m_busyWorkers(0), m_stop(false), m_fn(nullptr), m_ctx(nullptr), m_count(0), m_grain(1),
+      m_nextChunk(0)
+{
+    const auto workerCount = std::max(threadCount, 1U) - 1U;
+    m_workers.reserve(workerCount);
+    for (auto i = 0U; i < workerCount; ++i)
+    {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+mini::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeWorkers.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+mini::ThreadPool& mini::ThreadPool::Shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned int mini::ThreadPool::DefaultThreadCount()
+{
+    const auto count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+void mini::ThreadPool::Run(int count, int grain, ChunkFn fn, void* ctx)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    grain = std::max(grain, 1);
+
+    if (m_workers.empty() || t_insideJob || count <= grain)
+    {
+        for (auto begin = 0; begin < count; begin += grain)
+        {
+            fn(ctx, begin, std::min(begin + grain, count));
+        }
+        return;
+    }
+
+    std::lock_guard submitLock(m_submitMutex);
+    {
+        std::lock_guard lock(m_mutex);
+        m_fn    = fn;
+        m_ctx   = ctx;
+        m_count = count;
+        m_grain = grain;
+        m_nextChunk.store(0, std::memory_order_relaxed);
+        m_busyWorkers = static_cast<unsigned int>(m_workers.size());
+        ++m_generation;
+    }
+    m_wakeWorkers.notify_all();
+
+    t_insideJob = true;
+    ExecuteChunks();
+    t_insideJob = false;
+
+    std::unique_lock lock(m_mutex);
+    m_jobDone.wait(lock, [this]() { return m_busyWorkers == 0; });
+}
+
+void mini::ThreadPool::WorkerLoop()
+{
+    t_insideJob = true;
+
+    auto seenGeneration = 0ULL;
+    while (true)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_wakeWorkers.wait(lock, [this, seenGeneration]() { return m_stop || m_generation != seenGeneration; });
+            if (m_stop)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        ExecuteChunks();
+
+        std::lock_guard lock(m_mutex);
+        if (--m_busyWorkers == 0)
+        {
+            m_jobDone.notify_one();
+        }
+    }
+}
+
+void mini::ThreadPool::ExecuteChunks()
+{
+    while (true)
+    {
+        const auto begin = m_nextChunk.fetch_add(m_grain, std::memory_order_relaxed);
+        if (begin >= m_count)
+        {
+            return;
+        }
+        m_fn(m_ctx, begin, std::min(begin + m_grain, m_count));
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mini
+{
+// Persistent pool of worker threads executing data-parallel loops. Threads are created once and sleep between jobs,
+// the thread calling ParallelFor takes part in the work and returns when every chunk is done.
+class ThreadPool
+{
+  public:
+    // Number of threads taking part in a job including the calling one, 1 means everything runs inline
+    explicit ThreadPool(unsigned int threadCount = DefaultThreadCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int ThreadCount() const
+    {
+        return static_cast<unsigned int>(m_workers.size()) + 1;
+    }
+
+    // Calls func(begin, end) for consecutive chunks of at most `grain` elements covering [0, count)
+    template <typename Func> void ParallelFor(int count, int grain, Func&& func)
+    {
+        using F = std::remove_reference_t<Func>;
+        Run(count, grain, [](void* ctx, int begin, int end) { (*static_cast<F*>(ctx))(begin, end); },
+            const_cast<void*>(static_cast<const void*>(std::addressof(func))));
+    }
+
+    // Process-wide pool shared by the simulations
+    static ThreadPool& Shared();
+
+    static unsigned int DefaultThreadCount();
+
+  private:
+    using ChunkFn = void (*)(void* ctx, int begin, int end);
+
+    void Run(int count, int grain, ChunkFn fn, void* ctx);
+    void WorkerLoop();
+    void ExecuteChunks();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_submitMutex; // serializes jobs submitted from different threads
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeWorkers;
+    std::condition_variable m_jobDone;
+    unsigned long long m_generation;
+    unsigned int m_busyWorkers;
+    bool m_stop;
+
+    ChunkFn m_fn;
+    void* m_ctx;
+    int m_count;
+    int m_grain;
+    std::atomic<int> m_nextChunk;
+};
+} // namespace mini
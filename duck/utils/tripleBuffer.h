@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+namespace mini
+{
+// Lock-free hand-over of the newest value from one producer thread to one consumer thread. The producer fills the back
+// slot and publishes it, the consumer takes the most recently published slot and never waits for the producer.
+// Values published while the consumer was busy are overwritten.
+template <typename T> class TripleBuffer
+{
+  public:
+    // Slot the producer fills before calling Publish(), it keeps its content from the last time it was used
+    T& WriteBuffer()
+    {
+        return m_slots[m_back];
+    }
+
+    void Publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Makes the newest published value the read buffer, returns false if nothing was published since the last call
+    bool Fetch()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& ReadBuffer() const
+    {
+        return m_slots[m_front];
+    }
+
+  private:
+    static constexpr unsigned int INDEX = 0b011;
+    static constexpr unsigned int FRESH = 0b100; // the middle slot holds a value the consumer hasn't seen
+
+    std::array<T, 3> m_slots;
+    unsigned int m_back  = 0;              // owned by the producer
+    std::atomic<unsigned int> m_middle{1}; // exchanged by both threads
+    unsigned int m_front = 2;              // owned by the consumer
+};
+} // namespace mini
@@ -0,0 +1,132 @@
+#pragma once
+#include "waterSurfaceKernels.h"
+#include <cstdint>
+#include <cstring>
+
+namespace mini::gk2
+{
+// Storage policies of the water height buffers. The stencil and the normals always compute in float, a policy only
+// decides how the heights are kept between the steps, trading precision for memory bandwidth:
+//
+//   Value                stored type
+//   NAME                 name printed by the benchmarks
+//   ToFloat, FromFloat   conversion of a single height
+//   Kernels              conversion kernels of a SIMD level, chosen by SelectKernels
+//   Load, Store          conversion of `count` consecutive heights with the given kernels
+//
+// The zero bit pattern has to be the height 0 (buffers are cleared with Value{}).
+
+struct Float32Storage
+{
+    using Value                       = float;
+    static constexpr const char* NAME = "float32";
+
+    static float ToFloat(Value value)
+    {
+        return value;
+    }
+
+    static Value FromFloat(float value)
+    {
+        return value;
+    }
+
+    struct Kernels
+    {
+    };
+
+    static Kernels SelectKernels(kernels::SimdLevel)
+    {
+        return {};
+    }
+
+    static void Load(const Kernels&, const Value* values, float* floats, int count)
+    {
+        std::memcpy(floats, values, count * sizeof(float));
+    }
+
+    static void Store(const Kernels&, const float* floats, Value* values, int count)
+    {
+        std::memcpy(values, floats, count * sizeof(float));
+    }
+};
+
+// IEEE half floats (11 significant bits), converted with F16C when the CPU has it
+struct Float16Storage
+{
+    using Value                       = std::uint16_t;
+    static constexpr const char* NAME = "float16";
+
+    static float ToFloat(Value value)
+    {
+        return normalEncoding::HalfToFloat(value);
+    }
+
+    static Value FromFloat(float value)
+    {
+        return normalEncoding::FloatToHalf(value);
+    }
+
+    struct Kernels
+    {
+        kernels::HalfToFloatRowFn halfToFloat;
+        kernels::FloatToHalfRowFn floatToHalf;
+    };
+
+    static Kernels SelectKernels(kernels::SimdLevel level)
+    {
+        return {kernels::SelectHalfToFloatRow(level), kernels::SelectFloatToHalfRow(level)};
+    }
+
+    static void Load(const Kernels& kernels, const Value* values, float* floats, int count)
+    {
+        kernels.halfToFloat(values, floats, count);
+    }
+
+    static void Store(const Kernels& kernels, const float* floats, Value* values, int count)
+    {
+        kernels.floatToHalf(floats, values, count);
+    }
+};
+
+// Fixed point with a step of RANGE / 32767, heights beyond +-RANGE saturate. Drops are DROP_HEIGHT high and the
+// damped waves stay well below RANGE.
+struct Fixed16Storage
+{
+    using Value                       = std::int16_t;
+    static constexpr const char* NAME = "fixed16";
+    static constexpr float RANGE      = 2.f;
+    static constexpr float SCALE      = 32767.f / RANGE;
+
+    static float ToFloat(Value value)
+    {
+        return kernels::FixedToFloat(value, SCALE);
+    }
+
+    static Value FromFloat(float value)
+    {
+        return kernels::FloatToFixed(value, SCALE);
+    }
+
+    struct Kernels
+    {
+        kernels::FixedToFloatRowFn fixedToFloat;
+        kernels::FloatToFixedRowFn floatToFixed;
+    };
+
+    static Kernels SelectKernels(kernels::SimdLevel level)
+    {
+        return {kernels::SelectFixedToFloatRow(level), kernels::SelectFloatToFixedRow(level)};
+    }
+
+    static void Load(const Kernels& kernels, const Value* values, float* floats, int count)
+    {
+        kernels.fixedToFloat(values, SCALE, floats, count);
+    }
+
+    static void Store(const Kernels& kernels, const float* floats, Value* values, int count)
+    {
+        kernels.floatToFixed(floats, SCALE, values, count);
+    }
+};
+} // namespace mini::gk2
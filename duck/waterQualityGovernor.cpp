@@ -0,0 +1,52 @@
+#include "pch.h"
+
+#include "waterQualityGovernor.h"
+#include <cmath>
+
+mini::gk2::WaterQualityGovernor::WaterQualityGovernor(int samplesCount, const Settings& settings)
+    : m_settings(settings), m_samplesCount(std::clamp(samplesCount, settings.minSamples, settings.maxSamples)),
+      m_windowFrames(0), m_windowTotalMs(0.0), m_cooldown(0)
+{
+}
+
+int mini::gk2::WaterQualityGovernor::Update(double simulationMs)
+{
+    if (m_cooldown > 0)
+    {
+        --m_cooldown;
+        return m_samplesCount;
+    }
+
+    m_windowTotalMs += simulationMs;
+    if (++m_windowFrames < m_settings.windowFrames)
+    {
+        return m_samplesCount;
+    }
+
+    const auto averageMs = m_windowTotalMs / m_windowFrames;
+    const auto stepUpMs  = averageMs * std::pow(2.0, COST_EXPONENT);
+
+    auto samplesCount = m_samplesCount;
+    if (averageMs > m_settings.budgetMs)
+    {
+        samplesCount = std::max(m_samplesCount / 2, m_settings.minSamples);
+    }
+    else if (stepUpMs < m_settings.budgetMs * m_settings.headroom)
+    {
+        samplesCount = std::min(m_samplesCount * 2, m_settings.maxSamples);
+    }
+
+    Reset();
+    if (samplesCount != m_samplesCount)
+    {
+        m_samplesCount = samplesCount;
+        m_cooldown     = m_settings.cooldownFrames;
+    }
+    return m_samplesCount;
+}
+
+void mini::gk2::WaterQualityGovernor::Reset()
+{
+    m_windowFrames  = 0;
+    m_windowTotalMs = 0.0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+namespace mini::gk2
+{
+// Picks the water grid resolution from the measured simulation time. The resolution is halved when the average time
+// over a window of frames exceeds the budget and doubled when even the larger grid would fit comfortably.
+class WaterQualityGovernor
+{
+  public:
+    struct Settings
+    {
+        double budgetMs    = 4.0;  // simulation time per frame we are willing to spend
+        double headroom    = 0.75; // fraction of the budget the predicted cost has to stay under to step up
+        int minSamples     = 128;
+        int maxSamples     = 2048;
+        int windowFrames   = 30;
+        int cooldownFrames = 120; // frames to wait after a change before the next decision
+    };
+
+    // Cost of one simulated second grows with N^3: N^2 cells and a step time proportional to 1 / N
+    static constexpr double COST_EXPONENT = 3.0;
+
+    WaterQualityGovernor(int samplesCount, const Settings& settings);
+
+    explicit WaterQualityGovernor(int samplesCount) : WaterQualityGovernor(samplesCount, Settings{})
+    {
+    }
+
+    // Records the time spent on the simulation in the last frame, returns the resolution to use from now on
+    int Update(double simulationMs);
+
+    int SamplesCount() const
+    {
+        return m_samplesCount;
+    }
+
+    const Settings& GetSettings() const
+    {
+        return m_settings;
+    }
+
+  private:
+    void Reset();
+
+    Settings m_settings;
+    int m_samplesCount;
+    int m_windowFrames;
+    double m_windowTotalMs;
+    int m_cooldown;
+};
+} // namespace mini::gk2
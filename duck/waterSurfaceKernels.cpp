@@ -0,0 +1,1262 @@
+#include "pch.h"
+
+#include "waterSurfaceKernels.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DUCK_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set without changing the /arch of the translation unit
+#define DUCK_TARGET(isa)
+#else
+#define DUCK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define DUCK_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Fusing multiply-add would break bit-exactness between the kernels (avx512f implies FMA)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+using namespace mini::gk2;
+
+const char* kernels::ToString(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::SSE2:
+        return "sse2";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::NEON:
+        return "neon";
+    }
+    return "unknown";
+}
+
+namespace
+{
+struct CpuFeatures
+{
+    bool sse2   = false;
+    bool avx2   = false;
+    bool avx512 = false;
+    bool f16c   = false;
+    bool neon   = false;
+};
+
+CpuFeatures QueryCpuFeatures()
+{
+    CpuFeatures f;
+#if defined(DUCK_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const auto maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    f.sse2             = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx     = (info[2] & (1 << 28)) != 0;
+    const bool f16c    = (info[2] & (1 << 29)) != 0;
+
+    // The OS has to save the YMM/ZMM registers on context switch, otherwise the instructions are unusable
+    const auto xcr0     = osxsave ? _xgetbv(0) : 0ULL;
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+    f.f16c              = avx && ymmState && f16c;
+
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        f.avx2   = avx && ymmState && (info[1] & (1 << 5)) != 0;
+        f.avx512 = avx && zmmState && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    f.sse2   = __builtin_cpu_supports("sse2");
+    f.avx2   = __builtin_cpu_supports("avx2");
+    f.avx512 = __builtin_cpu_supports("avx512f");
+    f.f16c   = __builtin_cpu_supports("f16c");
+#endif
+#elif defined(DUCK_SIMD_NEON)
+    f.neon = true; // mandatory on AArch64
+#endif
+    return f;
+}
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static const CpuFeatures features = QueryCpuFeatures();
+    return features;
+}
+
+// FFT butterfly: (a, b) = (a + w * b, a - w * b), the SIMD kernels follow the same order of operations
+inline void Butterfly(float& ar, float& ai, float& br, float& bi, float wr, float wi)
+{
+    const auto tr = wr * br - wi * bi;
+    const auto ti = wr * bi + wi * br;
+    br            = ar - tr;
+    bi            = ai - ti;
+    ar            = ar + tr;
+    ai            = ai + ti;
+}
+
+// Writes an RGBA8 texel or, with Channels == 2, only the (x, z) components as an RG8 texel
+template <int Channels> void EncodeNormal(float left, float right, float up, float down, std::uint8_t* texel)
+{
+    // n = (left - right, 1, up - down) / |n| mapped from [-1, 1] to [0, 255]
+    const auto dx  = left - right;
+    const auto dz  = up - down;
+    const auto inv = 1.f / std::sqrt(dx * dx + dz * dz + 1.f);
+    const auto x   = static_cast<std::uint8_t>(dx * inv * 127.5f + 127.5f);
+    const auto z   = static_cast<std::uint8_t>(dz * inv * 127.5f + 127.5f);
+    if constexpr (Channels == 4)
+    {
+        texel[0] = x;
+        texel[1] = static_cast<std::uint8_t>(inv * 127.5f + 127.5f);
+        texel[2] = z;
+        texel[3] = 255;
+    }
+    else
+    {
+        texel[0] = x;
+        texel[1] = z;
+    }
+}
+
+template <int Channels>
+void NormalRow(const float* up, const float* curr, const float* down, std::uint8_t* texels, int count, int begin,
+               int end)
+{
+    if (count < 2)
+    {
+        for (auto k = begin; k < end; k++)
+        {
+            EncodeNormal<Channels>(0.f, 0.f, up[k], down[k], texels + Channels * k);
+        }
+        return;
+    }
+
+    // Borders are handled outside of the loop, so the inner loop is branch free
+    if (begin == 0)
+    {
+        EncodeNormal<Channels>(0.f, curr[1], up[0], down[0], texels);
+    }
+    for (auto k = std::max(begin, 1); k < std::min(end, count - 1); k++)
+    {
+        EncodeNormal<Channels>(curr[k - 1], curr[k + 1], up[k], down[k], texels + Channels * k);
+    }
+    if (end == count)
+    {
+        EncodeNormal<Channels>(curr[count - 2], 0.f, up[count - 1], down[count - 1], texels + Channels * (count - 1));
+    }
+}
+
+#if defined(DUCK_SIMD_X86)
+void StencilRowSSE2(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                    int count, float a, float b)
+{
+    const auto va = _mm_set1_ps(a);
+    const auto vb = _mm_set1_ps(b);
+
+    auto k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        auto sum      = _mm_add_ps(_mm_loadu_ps(down + k), _mm_loadu_ps(up + k));
+        sum           = _mm_add_ps(sum, _mm_loadu_ps(curr + k - 1));
+        sum           = _mm_add_ps(sum, _mm_loadu_ps(curr + k + 1));
+        const auto aa = _mm_mul_ps(va, sum);
+        const auto bb = _mm_sub_ps(_mm_mul_ps(vb, _mm_loadu_ps(curr + k)), _mm_loadu_ps(next + k));
+        _mm_storeu_ps(next + k, _mm_mul_ps(_mm_loadu_ps(damping + k), _mm_add_ps(aa, bb)));
+    }
+
+    kernels::StencilRowScalar(up + k, curr + k, down + k, damping + k, next + k, count - k, a, b);
+}
+
+DUCK_TARGET("avx2")
+void StencilRowAVX2(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                    int count, float a, float b)
+{
+    const auto va = _mm256_set1_ps(a);
+    const auto vb = _mm256_set1_ps(b);
+
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        auto sum      = _mm256_add_ps(_mm256_loadu_ps(down + k), _mm256_loadu_ps(up + k));
+        sum           = _mm256_add_ps(sum, _mm256_loadu_ps(curr + k - 1));
+        sum           = _mm256_add_ps(sum, _mm256_loadu_ps(curr + k + 1));
+        const auto aa = _mm256_mul_ps(va, sum);
+        const auto bb = _mm256_sub_ps(_mm256_mul_ps(vb, _mm256_loadu_ps(curr + k)), _mm256_loadu_ps(next + k));
+        _mm256_storeu_ps(next + k, _mm256_mul_ps(_mm256_loadu_ps(damping + k), _mm256_add_ps(aa, bb)));
+    }
+
+    // The tail is a single masked iteration. Handing it to the SSE2 kernel would cost an AVX-SSE transition per call,
+    // which dominates when the rows are split into short tile segments.
+    if (k < count)
+    {
+        const auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - k), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        auto sum        = _mm256_add_ps(_mm256_maskload_ps(down + k, mask), _mm256_maskload_ps(up + k, mask));
+        sum             = _mm256_add_ps(sum, _mm256_maskload_ps(curr + k - 1, mask));
+        sum             = _mm256_add_ps(sum, _mm256_maskload_ps(curr + k + 1, mask));
+        const auto aa   = _mm256_mul_ps(va, sum);
+        const auto bb =
+            _mm256_sub_ps(_mm256_mul_ps(vb, _mm256_maskload_ps(curr + k, mask)), _mm256_maskload_ps(next + k, mask));
+        _mm256_maskstore_ps(next + k, mask,
+                            _mm256_mul_ps(_mm256_maskload_ps(damping + k, mask), _mm256_add_ps(aa, bb)));
+    }
+}
+
+DUCK_TARGET("avx512f")
+void StencilRowAVX512(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                      int count, float a, float b)
+{
+    const auto va = _mm512_set1_ps(a);
+    const auto vb = _mm512_set1_ps(b);
+
+    auto k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        auto sum      = _mm512_add_ps(_mm512_loadu_ps(down + k), _mm512_loadu_ps(up + k));
+        sum           = _mm512_add_ps(sum, _mm512_loadu_ps(curr + k - 1));
+        sum           = _mm512_add_ps(sum, _mm512_loadu_ps(curr + k + 1));
+        const auto aa = _mm512_mul_ps(va, sum);
+        const auto bb = _mm512_sub_ps(_mm512_mul_ps(vb, _mm512_loadu_ps(curr + k)), _mm512_loadu_ps(next + k));
+        _mm512_storeu_ps(next + k, _mm512_mul_ps(_mm512_loadu_ps(damping + k), _mm512_add_ps(aa, bb)));
+    }
+
+    // Masked tail, see StencilRowAVX2
+    if (k < count)
+    {
+        const auto mask = static_cast<__mmask16>((1u << (count - k)) - 1u);
+        auto sum        = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, down + k), _mm512_maskz_loadu_ps(mask, up + k));
+        sum             = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(mask, curr + k - 1));
+        sum             = _mm512_add_ps(sum, _mm512_maskz_loadu_ps(mask, curr + k + 1));
+        const auto aa   = _mm512_mul_ps(va, sum);
+        const auto bb   = _mm512_sub_ps(_mm512_mul_ps(vb, _mm512_maskz_loadu_ps(mask, curr + k)),
+                                        _mm512_maskz_loadu_ps(mask, next + k));
+        _mm512_mask_storeu_ps(next + k, mask,
+                              _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, damping + k), _mm512_add_ps(aa, bb)));
+    }
+}
+
+template <int Channels>
+void NormalRowSSE2(const float* up, const float* curr, const float* down, std::uint8_t* texels, int count, int begin,
+                   int end)
+{
+    if (count < 2)
+    {
+        NormalRow<Channels>(up, curr, down, texels, count, begin, end);
+        return;
+    }
+
+    const auto scale       = _mm_set1_ps(127.5f);
+    const auto one         = _mm_set1_ps(1.f);
+    const auto half        = _mm_set1_ps(0.5f);
+    const auto threeHalves = _mm_set1_ps(1.5f);
+    const auto alpha       = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    if (begin == 0)
+    {
+        EncodeNormal<Channels>(0.f, curr[1], up[0], down[0], texels);
+    }
+
+    auto k         = std::max(begin, 1);
+    const auto top = std::min(end, count - 1);
+    for (; k + 4 <= top; k += 4)
+    {
+        const auto dx   = _mm_sub_ps(_mm_loadu_ps(curr + k - 1), _mm_loadu_ps(curr + k + 1));
+        const auto dz   = _mm_sub_ps(_mm_loadu_ps(up + k), _mm_loadu_ps(down + k));
+        const auto len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)), one);
+
+        // Approximate reciprocal square root refined with one Newton-Raphson iteration
+        auto inv = _mm_rsqrt_ps(len2);
+        inv      = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, len2), _mm_mul_ps(inv, inv))));
+
+        const auto invScaled = _mm_mul_ps(inv, scale);
+        const auto r         = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(dx, invScaled), scale));
+        const auto b         = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(dz, invScaled), scale));
+
+        if constexpr (Channels == 4)
+        {
+            const auto g = _mm_cvttps_epi32(_mm_add_ps(invScaled, scale));
+            const auto rgba =
+                _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + 4 * k), rgba);
+        }
+        else
+        {
+            // x0..x3 z0..z3 as bytes, then interleaved into x0 z0 x1 z1 ...
+            const auto bytes = _mm_packus_epi16(_mm_packs_epi32(r, b), _mm_setzero_si128());
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(texels + 2 * k),
+                             _mm_unpacklo_epi8(bytes, _mm_srli_si128(bytes, 4)));
+        }
+    }
+    for (; k < top; k++)
+    {
+        EncodeNormal<Channels>(curr[k - 1], curr[k + 1], up[k], down[k], texels + Channels * k);
+    }
+
+    if (end == count)
+    {
+        EncodeNormal<Channels>(curr[count - 2], 0.f, up[count - 1], down[count - 1], texels + Channels * (count - 1));
+    }
+}
+
+float MaxAbsSSE2(const float* values, int count)
+{
+    // Clearing the sign bit gives the absolute value
+    const auto mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    auto k   = 0;
+    auto max = _mm_setzero_ps();
+    for (; k + 4 <= count; k += 4)
+    {
+        max = _mm_max_ps(max, _mm_and_ps(_mm_loadu_ps(values + k), mask));
+    }
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return std::max(_mm_cvtss_f32(max), kernels::MaxAbsScalar(values + k, count - k));
+}
+
+void ShallowFaceRowSSE2(const float* behind, const float* ahead, float* velocity, float* flux, int count, float a,
+                        float damping, float depth)
+{
+    const auto va       = _mm_set1_ps(a);
+    const auto vdamping = _mm_set1_ps(damping);
+    const auto vdepth   = _mm_set1_ps(depth);
+    const auto zero     = _mm_setzero_ps();
+
+    auto k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        const auto vbehind = _mm_loadu_ps(behind + k);
+        const auto vahead  = _mm_loadu_ps(ahead + k);
+        const auto slope   = _mm_mul_ps(va, _mm_sub_ps(vahead, vbehind));
+        const auto v       = _mm_mul_ps(vdamping, _mm_sub_ps(_mm_loadu_ps(velocity + k), slope));
+
+        // No blend instruction in SSE2, the upwind height is selected with the comparison mask
+        const auto forward = _mm_cmpgt_ps(v, zero);
+        const auto upwind  = _mm_or_ps(_mm_and_ps(forward, vbehind), _mm_andnot_ps(forward, vahead));
+        _mm_storeu_ps(velocity + k, v);
+        _mm_storeu_ps(flux + k, _mm_mul_ps(v, _mm_max_ps(_mm_add_ps(vdepth, upwind), zero)));
+    }
+    kernels::ShallowFaceRowScalar(behind + k, ahead + k, velocity + k, flux + k, count - k, a, damping, depth);
+}
+
+void ShallowHeightRowSSE2(const float* left, const float* up, const float* down, float* heights, int count, float b)
+{
+    const auto vb = _mm_set1_ps(b);
+
+    auto k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        const auto dx = _mm_sub_ps(_mm_loadu_ps(left + k + 1), _mm_loadu_ps(left + k));
+        const auto dy = _mm_sub_ps(_mm_loadu_ps(down + k), _mm_loadu_ps(up + k));
+        _mm_storeu_ps(heights + k, _mm_sub_ps(_mm_loadu_ps(heights + k), _mm_mul_ps(vb, _mm_add_ps(dx, dy))));
+    }
+    kernels::ShallowHeightRowScalar(left + k, up + k, down + k, heights + k, count - k, b);
+}
+
+DUCK_TARGET("avx2")
+void ShallowFaceRowAVX2(const float* behind, const float* ahead, float* velocity, float* flux, int count, float a,
+                        float damping, float depth)
+{
+    const auto va       = _mm256_set1_ps(a);
+    const auto vdamping = _mm256_set1_ps(damping);
+    const auto vdepth   = _mm256_set1_ps(depth);
+    const auto zero     = _mm256_setzero_ps();
+    const auto lanes    = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // The tail runs the same body with a mask, see StencilRowAVX2
+    for (auto k = 0; k < count; k += 8)
+    {
+        const auto mask    = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - k), lanes);
+        const auto vbehind = _mm256_maskload_ps(behind + k, mask);
+        const auto vahead  = _mm256_maskload_ps(ahead + k, mask);
+        const auto slope   = _mm256_mul_ps(va, _mm256_sub_ps(vahead, vbehind));
+        const auto v       = _mm256_mul_ps(vdamping, _mm256_sub_ps(_mm256_maskload_ps(velocity + k, mask), slope));
+        const auto upwind  = _mm256_blendv_ps(vahead, vbehind, _mm256_cmp_ps(v, zero, _CMP_GT_OQ));
+        _mm256_maskstore_ps(velocity + k, mask, v);
+        _mm256_maskstore_ps(flux + k, mask, _mm256_mul_ps(v, _mm256_max_ps(_mm256_add_ps(vdepth, upwind), zero)));
+    }
+}
+
+DUCK_TARGET("avx2")
+void ShallowHeightRowAVX2(const float* left, const float* up, const float* down, float* heights, int count, float b)
+{
+    const auto vb    = _mm256_set1_ps(b);
+    const auto lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (auto k = 0; k < count; k += 8)
+    {
+        const auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - k), lanes);
+        const auto dx   = _mm256_sub_ps(_mm256_maskload_ps(left + k + 1, mask), _mm256_maskload_ps(left + k, mask));
+        const auto dy   = _mm256_sub_ps(_mm256_maskload_ps(down + k, mask), _mm256_maskload_ps(up + k, mask));
+        const auto h    = _mm256_maskload_ps(heights + k, mask);
+        _mm256_maskstore_ps(heights + k, mask, _mm256_sub_ps(h, _mm256_mul_ps(vb, _mm256_add_ps(dx, dy))));
+    }
+}
+
+// FFT butterfly on registers: (a, b) = (a + w * b, a - w * b)
+inline void ButterflySSE2(__m128& ar, __m128& ai, __m128& br, __m128& bi, __m128 wr, __m128 wi)
+{
+    const auto tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+    const auto ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+    br            = _mm_sub_ps(ar, tr);
+    bi            = _mm_sub_ps(ai, ti);
+    ar            = _mm_add_ps(ar, tr);
+    ai            = _mm_add_ps(ai, ti);
+}
+
+void FftRadix2SSE2(float* re0, float* im0, float* re1, float* im1, float wRe, float wIm, int count)
+{
+    const auto wr = _mm_set1_ps(wRe);
+    const auto wi = _mm_set1_ps(wIm);
+    auto k        = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        auto ar = _mm_loadu_ps(re0 + k);
+        auto ai = _mm_loadu_ps(im0 + k);
+        auto br = _mm_loadu_ps(re1 + k);
+        auto bi = _mm_loadu_ps(im1 + k);
+        ButterflySSE2(ar, ai, br, bi, wr, wi);
+        _mm_storeu_ps(re0 + k, ar);
+        _mm_storeu_ps(im0 + k, ai);
+        _mm_storeu_ps(re1 + k, br);
+        _mm_storeu_ps(im1 + k, bi);
+    }
+    kernels::FftRadix2Scalar(re0 + k, im0 + k, re1 + k, im1 + k, wRe, wIm, count - k);
+}
+
+void FftRadix4SSE2(float* const* re, float* const* im, const float* w, int count)
+{
+    const auto w1r = _mm_set1_ps(w[0]);
+    const auto w1i = _mm_set1_ps(w[1]);
+    const auto w2r = _mm_set1_ps(w[2]);
+    const auto w2i = _mm_set1_ps(w[3]);
+    const auto w3r = _mm_set1_ps(w[4]);
+    const auto w3i = _mm_set1_ps(w[5]);
+    auto k         = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 xr[4], xi[4];
+        for (auto q = 0; q < 4; q++)
+        {
+            xr[q] = _mm_loadu_ps(re[q] + k);
+            xi[q] = _mm_loadu_ps(im[q] + k);
+        }
+        ButterflySSE2(xr[0], xi[0], xr[1], xi[1], w1r, w1i);
+        ButterflySSE2(xr[2], xi[2], xr[3], xi[3], w1r, w1i);
+        ButterflySSE2(xr[0], xi[0], xr[2], xi[2], w2r, w2i);
+        ButterflySSE2(xr[1], xi[1], xr[3], xi[3], w3r, w3i);
+        for (auto q = 0; q < 4; q++)
+        {
+            _mm_storeu_ps(re[q] + k, xr[q]);
+            _mm_storeu_ps(im[q] + k, xi[q]);
+        }
+    }
+    if (k < count)
+    {
+        float* const tailRe[] = {re[0] + k, re[1] + k, re[2] + k, re[3] + k};
+        float* const tailIm[] = {im[0] + k, im[1] + k, im[2] + k, im[3] + k};
+        kernels::FftRadix4Scalar(tailRe, tailIm, w, count - k);
+    }
+}
+
+DUCK_TARGET("avx2")
+inline void ButterflyAVX2(__m256& ar, __m256& ai, __m256& br, __m256& bi, __m256 wr, __m256 wi)
+{
+    const auto tr = _mm256_sub_ps(_mm256_mul_ps(wr, br), _mm256_mul_ps(wi, bi));
+    const auto ti = _mm256_add_ps(_mm256_mul_ps(wr, bi), _mm256_mul_ps(wi, br));
+    br            = _mm256_sub_ps(ar, tr);
+    bi            = _mm256_sub_ps(ai, ti);
+    ar            = _mm256_add_ps(ar, tr);
+    ai            = _mm256_add_ps(ai, ti);
+}
+
+DUCK_TARGET("avx2")
+void FftRadix2AVX2(float* re0, float* im0, float* re1, float* im1, float wRe, float wIm, int count)
+{
+    const auto wr = _mm256_set1_ps(wRe);
+    const auto wi = _mm256_set1_ps(wIm);
+    auto k        = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        auto ar = _mm256_loadu_ps(re0 + k);
+        auto ai = _mm256_loadu_ps(im0 + k);
+        auto br = _mm256_loadu_ps(re1 + k);
+        auto bi = _mm256_loadu_ps(im1 + k);
+        ButterflyAVX2(ar, ai, br, bi, wr, wi);
+        _mm256_storeu_ps(re0 + k, ar);
+        _mm256_storeu_ps(im0 + k, ai);
+        _mm256_storeu_ps(re1 + k, br);
+        _mm256_storeu_ps(im1 + k, bi);
+    }
+    kernels::FftRadix2Scalar(re0 + k, im0 + k, re1 + k, im1 + k, wRe, wIm, count - k);
+}
+
+DUCK_TARGET("avx2") void FftRadix4AVX2(float* const* re, float* const* im, const float* w, int count)
+{
+    const auto w1r = _mm256_set1_ps(w[0]);
+    const auto w1i = _mm256_set1_ps(w[1]);
+    const auto w2r = _mm256_set1_ps(w[2]);
+    const auto w2i = _mm256_set1_ps(w[3]);
+    const auto w3r = _mm256_set1_ps(w[4]);
+    const auto w3i = _mm256_set1_ps(w[5]);
+    auto k         = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 xr[4], xi[4];
+        for (auto q = 0; q < 4; q++)
+        {
+            xr[q] = _mm256_loadu_ps(re[q] + k);
+            xi[q] = _mm256_loadu_ps(im[q] + k);
+        }
+        ButterflyAVX2(xr[0], xi[0], xr[1], xi[1], w1r, w1i);
+        ButterflyAVX2(xr[2], xi[2], xr[3], xi[3], w1r, w1i);
+        ButterflyAVX2(xr[0], xi[0], xr[2], xi[2], w2r, w2i);
+        ButterflyAVX2(xr[1], xi[1], xr[3], xi[3], w3r, w3i);
+        for (auto q = 0; q < 4; q++)
+        {
+            _mm256_storeu_ps(re[q] + k, xr[q]);
+            _mm256_storeu_ps(im[q] + k, xi[q]);
+        }
+    }
+    if (k < count)
+    {
+        float* const tailRe[] = {re[0] + k, re[1] + k, re[2] + k, re[3] + k};
+        float* const tailIm[] = {im[0] + k, im[1] + k, im[2] + k, im[3] + k};
+        kernels::FftRadix4Scalar(tailRe, tailIm, w, count - k);
+    }
+}
+
+void FixedToFloatRowSSE2(const std::int16_t* fixed, float scale, float* values, int count)
+{
+    const auto inverseScale = _mm_set1_ps(1.f / scale);
+
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        // Duplicating every value into both halves of a 32 bit lane and shifting back extends its sign
+        const auto packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fixed + k));
+        const auto lo     = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        const auto hi     = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        _mm_storeu_ps(values + k, _mm_mul_ps(_mm_cvtepi32_ps(lo), inverseScale));
+        _mm_storeu_ps(values + k + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), inverseScale));
+    }
+    kernels::FixedToFloatRowScalar(fixed + k, scale, values + k, count - k);
+}
+
+void FloatToFixedRowSSE2(const float* values, float scale, std::int16_t* fixed, int count)
+{
+    const auto scaleVec = _mm_set1_ps(scale);
+    const auto lowest   = _mm_set1_ps(-32767.f);
+    const auto highest  = _mm_set1_ps(32767.f);
+    const auto half     = _mm_set1_ps(0.5f);
+    const auto signMask = _mm_set1_ps(-0.f);
+    const auto toFixed  = [&](__m128 value)
+    {
+        // Adding 0.5 with the sign of the value and truncating rounds half away from zero
+        const auto scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, scaleVec), lowest), highest);
+        return _mm_cvttps_epi32(_mm_add_ps(scaled, _mm_or_ps(half, _mm_and_ps(scaled, signMask))));
+    };
+
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        const auto packed = _mm_packs_epi32(toFixed(_mm_loadu_ps(values + k)), toFixed(_mm_loadu_ps(values + k + 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(fixed + k), packed);
+    }
+    kernels::FloatToFixedRowScalar(values + k, scale, fixed + k, count - k);
+}
+
+DUCK_TARGET("avx,f16c") void FloatToHalfRowF16C(const float* values, std::uint16_t* halves, int count)
+{
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        const auto packed = _mm256_cvtps_ph(_mm256_loadu_ps(values + k), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(halves + k), packed);
+    }
+    if (k < count)
+    {
+        // The tail goes through a zero padded vector, so it is converted with the same instruction
+        alignas(32) std::array<float, 8> tail     = {};
+        alignas(16) std::array<std::uint16_t, 8> tailHalves;
+        std::memcpy(tail.data(), values + k, (count - k) * sizeof(float));
+        _mm_store_si128(reinterpret_cast<__m128i*>(tailHalves.data()),
+                        _mm256_cvtps_ph(_mm256_load_ps(tail.data()), _MM_FROUND_TO_NEAREST_INT));
+        std::memcpy(halves + k, tailHalves.data(), (count - k) * sizeof(std::uint16_t));
+    }
+}
+
+DUCK_TARGET("avx,f16c") void HalfToFloatRowF16C(const std::uint16_t* halves, float* values, int count)
+{
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        _mm256_storeu_ps(values + k, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + k))));
+    }
+    if (k < count)
+    {
+        alignas(16) std::array<std::uint16_t, 8> tail = {};
+        alignas(32) std::array<float, 8> tailValues;
+        std::memcpy(tail.data(), halves + k, (count - k) * sizeof(std::uint16_t));
+        const auto packed = _mm_load_si128(reinterpret_cast<const __m128i*>(tail.data()));
+        _mm256_store_ps(tailValues.data(), _mm256_cvtph_ps(packed));
+        std::memcpy(values + k, tailValues.data(), (count - k) * sizeof(float));
+    }
+}
+
+void BSplineRowSSE2(const float* const* x, const float* const* y, const float* t, float* posX, float* posY,
+                    float* dirX, float* dirY, int count)
+{
+    const auto sixth           = _mm_set1_ps(1.f / 6.f);
+    const auto zero            = _mm_setzero_ps();
+    const auto half            = _mm_set1_ps(0.5f);
+    const auto one             = _mm_set1_ps(1.f);
+    const auto oneAndHalf      = _mm_set1_ps(1.5f);
+    const auto two             = _mm_set1_ps(2.f);
+    const auto three           = _mm_set1_ps(3.f);
+    const auto four            = _mm_set1_ps(4.f);
+    const auto six             = _mm_set1_ps(6.f);
+    const auto minusHalf       = _mm_set1_ps(-0.5f);
+    const auto minusOneAndHalf = _mm_set1_ps(-1.5f);
+    const auto minusThree      = _mm_set1_ps(-3.f);
+
+    auto k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        const auto s  = _mm_loadu_ps(t + k);
+        const auto u  = _mm_sub_ps(one, s);
+        const auto s2 = _mm_mul_ps(s, s);
+        const auto s3 = _mm_mul_ps(s2, s);
+
+        const __m128 b[4] = {
+            _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(u, u), u), sixth),
+            _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(three, s3), _mm_mul_ps(six, s2)), four), sixth),
+            _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(minusThree, s3), _mm_mul_ps(three, s2)),
+                                             _mm_mul_ps(three, s)),
+                                  one),
+                       sixth),
+            _mm_mul_ps(s3, sixth),
+        };
+        const __m128 d[4] = {
+            _mm_mul_ps(_mm_mul_ps(minusHalf, u), u),
+            _mm_sub_ps(_mm_mul_ps(oneAndHalf, s2), _mm_mul_ps(two, s)),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(minusOneAndHalf, s2), s), half),
+            _mm_mul_ps(half, s2),
+        };
+
+        auto px = _mm_mul_ps(b[0], _mm_loadu_ps(x[0] + k));
+        auto py = _mm_mul_ps(b[0], _mm_loadu_ps(y[0] + k));
+        auto vx = _mm_mul_ps(d[0], _mm_loadu_ps(x[0] + k));
+        auto vy = _mm_mul_ps(d[0], _mm_loadu_ps(y[0] + k));
+        for (auto i = 1; i < 4; i++)
+        {
+            px = _mm_add_ps(px, _mm_mul_ps(b[i], _mm_loadu_ps(x[i] + k)));
+            py = _mm_add_ps(py, _mm_mul_ps(b[i], _mm_loadu_ps(y[i] + k)));
+            vx = _mm_add_ps(vx, _mm_mul_ps(d[i], _mm_loadu_ps(x[i] + k)));
+            vy = _mm_add_ps(vy, _mm_mul_ps(d[i], _mm_loadu_ps(y[i] + k)));
+        }
+
+        const auto length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+        const auto moving = _mm_cmpgt_ps(length, zero);
+        _mm_storeu_ps(posX + k, px);
+        _mm_storeu_ps(posY + k, py);
+        _mm_storeu_ps(dirX + k, _mm_or_ps(_mm_and_ps(moving, _mm_div_ps(vx, length)), _mm_andnot_ps(moving, one)));
+        _mm_storeu_ps(dirY + k, _mm_and_ps(moving, _mm_div_ps(vy, length)));
+    }
+
+    const float* xTail[4] = {x[0] + k, x[1] + k, x[2] + k, x[3] + k};
+    const float* yTail[4] = {y[0] + k, y[1] + k, y[2] + k, y[3] + k};
+    kernels::BSplineRowScalar(xTail, yTail, t + k, posX + k, posY + k, dirX + k, dirY + k, count - k);
+}
+
+DUCK_TARGET("avx2")
+void BSplineRowAVX2(const float* const* x, const float* const* y, const float* t, float* posX, float* posY,
+                    float* dirX, float* dirY, int count)
+{
+    const auto sixth           = _mm256_set1_ps(1.f / 6.f);
+    const auto zero            = _mm256_setzero_ps();
+    const auto half            = _mm256_set1_ps(0.5f);
+    const auto one             = _mm256_set1_ps(1.f);
+    const auto oneAndHalf      = _mm256_set1_ps(1.5f);
+    const auto two             = _mm256_set1_ps(2.f);
+    const auto three           = _mm256_set1_ps(3.f);
+    const auto four            = _mm256_set1_ps(4.f);
+    const auto six             = _mm256_set1_ps(6.f);
+    const auto minusHalf       = _mm256_set1_ps(-0.5f);
+    const auto minusOneAndHalf = _mm256_set1_ps(-1.5f);
+    const auto minusThree      = _mm256_set1_ps(-3.f);
+
+    auto k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        const auto s  = _mm256_loadu_ps(t + k);
+        const auto u  = _mm256_sub_ps(one, s);
+        const auto s2 = _mm256_mul_ps(s, s);
+        const auto s3 = _mm256_mul_ps(s2, s);
+
+        const __m256 b[4] = {
+            _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(u, u), u), sixth),
+            _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(three, s3), _mm256_mul_ps(six, s2)), four),
+                          sixth),
+            _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(minusThree, s3),
+                                                                    _mm256_mul_ps(three, s2)),
+                                                      _mm256_mul_ps(three, s)),
+                                        one),
+                          sixth),
+            _mm256_mul_ps(s3, sixth),
+        };
+        const __m256 d[4] = {
+            _mm256_mul_ps(_mm256_mul_ps(minusHalf, u), u),
+            _mm256_sub_ps(_mm256_mul_ps(oneAndHalf, s2), _mm256_mul_ps(two, s)),
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(minusOneAndHalf, s2), s), half),
+            _mm256_mul_ps(half, s2),
+        };
+
+        auto px = _mm256_mul_ps(b[0], _mm256_loadu_ps(x[0] + k));
+        auto py = _mm256_mul_ps(b[0], _mm256_loadu_ps(y[0] + k));
+        auto vx = _mm256_mul_ps(d[0], _mm256_loadu_ps(x[0] + k));
+        auto vy = _mm256_mul_ps(d[0], _mm256_loadu_ps(y[0] + k));
+        for (auto i = 1; i < 4; i++)
+        {
+            px = _mm256_add_ps(px, _mm256_mul_ps(b[i], _mm256_loadu_ps(x[i] + k)));
+            py = _mm256_add_ps(py, _mm256_mul_ps(b[i], _mm256_loadu_ps(y[i] + k)));
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(d[i], _mm256_loadu_ps(x[i] + k)));
+            vy = _mm256_add_ps(vy, _mm256_mul_ps(d[i], _mm256_loadu_ps(y[i] + k)));
+        }
+
+        // Lanes with a zero derivative divide by zero, the blend replaces their results
+        const auto length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)));
+        const auto moving = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+        _mm256_storeu_ps(posX + k, px);
+        _mm256_storeu_ps(posY + k, py);
+        _mm256_storeu_ps(dirX + k, _mm256_blendv_ps(one, _mm256_div_ps(vx, length), moving));
+        _mm256_storeu_ps(dirY + k, _mm256_blendv_ps(zero, _mm256_div_ps(vy, length), moving));
+    }
+
+    const float* xTail[4] = {x[0] + k, x[1] + k, x[2] + k, x[3] + k};
+    const float* yTail[4] = {y[0] + k, y[1] + k, y[2] + k, y[3] + k};
+    kernels::BSplineRowScalar(xTail, yTail, t + k, posX + k, posY + k, dirX + k, dirY + k, count - k);
+}
+#endif
+
+#if defined(DUCK_SIMD_NEON)
+void StencilRowNEON(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                    int count, float a, float b)
+{
+    const auto va = vdupq_n_f32(a);
+    const auto vb = vdupq_n_f32(b);
+
+    auto k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        auto sum      = vaddq_f32(vld1q_f32(down + k), vld1q_f32(up + k));
+        sum           = vaddq_f32(sum, vld1q_f32(curr + k - 1));
+        sum           = vaddq_f32(sum, vld1q_f32(curr + k + 1));
+        const auto aa = vmulq_f32(va, sum);
+        const auto bb = vsubq_f32(vmulq_f32(vb, vld1q_f32(curr + k)), vld1q_f32(next + k));
+        vst1q_f32(next + k, vmulq_f32(vld1q_f32(damping + k), vaddq_f32(aa, bb)));
+    }
+
+    kernels::StencilRowScalar(up + k, curr + k, down + k, damping + k, next + k, count - k, a, b);
+}
+#endif
+} // namespace
+
+kernels::SimdLevel kernels::DetectSimdLevel()
+{
+    const auto& f = GetCpuFeatures();
+    if (f.avx512)
+    {
+        return SimdLevel::AVX512;
+    }
+    if (f.avx2)
+    {
+        return SimdLevel::AVX2;
+    }
+    if (f.sse2)
+    {
+        return SimdLevel::SSE2;
+    }
+    if (f.neon)
+    {
+        return SimdLevel::NEON;
+    }
+    return SimdLevel::Scalar;
+}
+
+bool kernels::IsSupported(SimdLevel level)
+{
+    const auto& f = GetCpuFeatures();
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return true;
+    case SimdLevel::SSE2:
+        return f.sse2;
+    case SimdLevel::AVX2:
+        return f.avx2;
+    case SimdLevel::AVX512:
+        return f.avx512;
+    case SimdLevel::NEON:
+        return f.neon;
+    }
+    return false;
+}
+
+void kernels::StencilRowScalar(const float* up, const float* curr, const float* down, const float* damping,
+                               float* next, int count, float a, float b)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        const auto aa = a * (down[k] + up[k] + curr[k - 1] + curr[k + 1]);
+        const auto bb = b * curr[k] - next[k];
+        next[k]       = damping[k] * (aa + bb);
+    }
+}
+
+void kernels::NormalRowScalar(const float* up, const float* curr, const float* down, std::uint8_t* rgba, int count,
+                              int begin, int end)
+{
+    NormalRow<4>(up, curr, down, rgba, count, begin, end);
+}
+
+void kernels::NormalRowRGScalar(const float* up, const float* curr, const float* down, std::uint8_t* rg, int count,
+                                int begin, int end)
+{
+    NormalRow<2>(up, curr, down, rg, count, begin, end);
+}
+
+float kernels::MaxAbsScalar(const float* values, int count)
+{
+    auto max = 0.f;
+    for (auto k = 0; k < count; k++)
+    {
+        max = std::max(max, std::abs(values[k]));
+    }
+    return max;
+}
+
+void kernels::BSplineRowScalar(const float* const* x, const float* const* y, const float* t, float* posX, float* posY,
+                               float* dirX, float* dirY, int count)
+{
+    constexpr auto sixth = 1.f / 6.f;
+    for (auto k = 0; k < count; k++)
+    {
+        const auto s  = t[k];
+        const auto u  = 1.f - s;
+        const auto s2 = s * s;
+        const auto s3 = s2 * s;
+
+        const float b[4] = {
+            u * u * u * sixth,
+            (3.f * s3 - 6.f * s2 + 4.f) * sixth,
+            (-3.f * s3 + 3.f * s2 + 3.f * s + 1.f) * sixth,
+            s3 * sixth,
+        };
+        const float d[4] = {-0.5f * u * u, 1.5f * s2 - 2.f * s, -1.5f * s2 + s + 0.5f, 0.5f * s2};
+
+        auto px = b[0] * x[0][k];
+        auto py = b[0] * y[0][k];
+        auto vx = d[0] * x[0][k];
+        auto vy = d[0] * y[0][k];
+        for (auto i = 1; i < 4; i++)
+        {
+            px = px + b[i] * x[i][k];
+            py = py + b[i] * y[i][k];
+            vx = vx + d[i] * x[i][k];
+            vy = vy + d[i] * y[i][k];
+        }
+
+        const auto length = std::sqrt(vx * vx + vy * vy);
+        posX[k]           = px;
+        posY[k]           = py;
+        dirX[k]           = length > 0.f ? vx / length : 1.f;
+        dirY[k]           = length > 0.f ? vy / length : 0.f;
+    }
+}
+
+kernels::BSplineRowFn kernels::SelectBSplineRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if (!IsSupported(level))
+    {
+        return BSplineRowScalar;
+    }
+    // Eight objects per batch are plenty, AVX-512 runs the AVX2 kernel
+    if (level == SimdLevel::AVX2 || level == SimdLevel::AVX512)
+    {
+        return BSplineRowAVX2;
+    }
+    if (level == SimdLevel::SSE2)
+    {
+        return BSplineRowSSE2;
+    }
+#endif
+    return BSplineRowScalar;
+}
+
+kernels::StencilRowFn kernels::SelectStencilRow(SimdLevel level)
+{
+    if (!IsSupported(level))
+    {
+        return StencilRowScalar;
+    }
+
+    switch (level)
+    {
+#if defined(DUCK_SIMD_X86)
+    case SimdLevel::SSE2:
+        return StencilRowSSE2;
+    case SimdLevel::AVX2:
+        return StencilRowAVX2;
+    case SimdLevel::AVX512:
+        return StencilRowAVX512;
+#endif
+#if defined(DUCK_SIMD_NEON)
+    case SimdLevel::NEON:
+        return StencilRowNEON;
+#endif
+    default:
+        return StencilRowScalar;
+    }
+}
+
+kernels::NormalRowFn kernels::SelectNormalRow(SimdLevel level, NormalMapEncoding encoding)
+{
+    const auto twoChannels = encoding != NormalMapEncoding::RGBA8;
+#if defined(DUCK_SIMD_X86)
+    // Wider vectors don't pay off here, the pass is bound by the byte packing and the stores
+    if (level != SimdLevel::Scalar && IsSupported(level))
+    {
+        return twoChannels ? NormalRowSSE2<2> : NormalRowSSE2<4>;
+    }
+#endif
+    return twoChannels ? NormalRowRGScalar : NormalRowScalar;
+}
+
+kernels::MaxAbsFn kernels::SelectMaxAbs(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if (level != SimdLevel::Scalar && IsSupported(level))
+    {
+        return MaxAbsSSE2;
+    }
+#endif
+    return MaxAbsScalar;
+}
+
+void kernels::FloatToHalfRowScalar(const float* values, std::uint16_t* halves, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        halves[k] = normalEncoding::FloatToHalf(values[k]);
+    }
+}
+
+kernels::FloatToHalfRowFn kernels::SelectFloatToHalfRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level) && GetCpuFeatures().f16c)
+    {
+        return FloatToHalfRowF16C;
+    }
+#endif
+    return FloatToHalfRowScalar;
+}
+
+void kernels::HalfToFloatRowScalar(const std::uint16_t* halves, float* values, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        values[k] = normalEncoding::HalfToFloat(halves[k]);
+    }
+}
+
+kernels::HalfToFloatRowFn kernels::SelectHalfToFloatRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level) && GetCpuFeatures().f16c)
+    {
+        return HalfToFloatRowF16C;
+    }
+#endif
+    return HalfToFloatRowScalar;
+}
+
+void kernels::ShallowFaceRowScalar(const float* behind, const float* ahead, float* velocity, float* flux, int count,
+                                   float a, float damping, float depth)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        const auto v      = damping * (velocity[k] - a * (ahead[k] - behind[k]));
+        const auto upwind = v > 0.f ? behind[k] : ahead[k];
+        velocity[k]       = v;
+        flux[k]           = v * std::max(depth + upwind, 0.f);
+    }
+}
+
+void kernels::ShallowHeightRowScalar(const float* left, const float* up, const float* down, float* heights, int count,
+                                     float b)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        heights[k] = heights[k] - b * ((left[k + 1] - left[k]) + (down[k] - up[k]));
+    }
+}
+
+kernels::ShallowFaceRowFn kernels::SelectShallowFaceRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level))
+    {
+        return ShallowFaceRowAVX2;
+    }
+    if (level == SimdLevel::SSE2 && IsSupported(level))
+    {
+        return ShallowFaceRowSSE2;
+    }
+#endif
+    return ShallowFaceRowScalar;
+}
+
+kernels::ShallowHeightRowFn kernels::SelectShallowHeightRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level))
+    {
+        return ShallowHeightRowAVX2;
+    }
+    if (level == SimdLevel::SSE2 && IsSupported(level))
+    {
+        return ShallowHeightRowSSE2;
+    }
+#endif
+    return ShallowHeightRowScalar;
+}
+
+void kernels::FftRadix2Scalar(float* re0, float* im0, float* re1, float* im1, float wRe, float wIm, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        Butterfly(re0[k], im0[k], re1[k], im1[k], wRe, wIm);
+    }
+}
+
+void kernels::FftRadix4Scalar(float* const* re, float* const* im, const float* w, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        Butterfly(re[0][k], im[0][k], re[1][k], im[1][k], w[0], w[1]);
+        Butterfly(re[2][k], im[2][k], re[3][k], im[3][k], w[0], w[1]);
+        Butterfly(re[0][k], im[0][k], re[2][k], im[2][k], w[2], w[3]);
+        Butterfly(re[1][k], im[1][k], re[3][k], im[3][k], w[4], w[5]);
+    }
+}
+
+kernels::FftRadix2Fn kernels::SelectFftRadix2(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level))
+    {
+        return FftRadix2AVX2;
+    }
+    if (level == SimdLevel::SSE2 && IsSupported(level))
+    {
+        return FftRadix2SSE2;
+    }
+#endif
+    return FftRadix2Scalar;
+}
+
+kernels::FftRadix4Fn kernels::SelectFftRadix4(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::AVX512) && IsSupported(level))
+    {
+        return FftRadix4AVX2;
+    }
+    if (level == SimdLevel::SSE2 && IsSupported(level))
+    {
+        return FftRadix4SSE2;
+    }
+#endif
+    return FftRadix4Scalar;
+}
+
+float kernels::FixedToFloat(std::int16_t fixed, float scale)
+{
+    return static_cast<float>(fixed) * (1.f / scale);
+}
+
+std::int16_t kernels::FloatToFixed(float value, float scale)
+{
+    const auto scaled = std::clamp(value * scale, -32767.f, 32767.f);
+    return static_cast<std::int16_t>(static_cast<int>(scaled < 0.f ? scaled - 0.5f : scaled + 0.5f));
+}
+
+void kernels::FixedToFloatRowScalar(const std::int16_t* fixed, float scale, float* values, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        values[k] = FixedToFloat(fixed[k], scale);
+    }
+}
+
+void kernels::FloatToFixedRowScalar(const float* values, float scale, std::int16_t* fixed, int count)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        fixed[k] = FloatToFixed(values[k], scale);
+    }
+}
+
+kernels::FixedToFloatRowFn kernels::SelectFixedToFloatRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if (level != SimdLevel::Scalar && IsSupported(level))
+    {
+        return FixedToFloatRowSSE2;
+    }
+#endif
+    return FixedToFloatRowScalar;
+}
+
+kernels::FloatToFixedRowFn kernels::SelectFloatToFixedRow(SimdLevel level)
+{
+#if defined(DUCK_SIMD_X86)
+    if (level != SimdLevel::Scalar && IsSupported(level))
+    {
+        return FloatToFixedRowSSE2;
+    }
+#endif
+    return FloatToFixedRowScalar;
+}
+
+namespace
+{
+// Largest difference to StencilRowReference accepted by VerifyStencilRow, a few float steps of the results of about 1
+constexpr float STENCIL_TOLERANCE = 1e-6f;
+
+// The loop of WaterSurfaceSimulation::Step() the kernels replaced: the coefficients come from the double StepTime()
+// and everything after the float sum of the neighbours is evaluated in double
+void StencilRowReference(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                         int count, double a, double b)
+{
+    for (auto k = 0; k < count; k++)
+    {
+        const auto aa = a * (down[k] + up[k] + curr[k - 1] + curr[k + 1]);
+        const auto bb = b * curr[k] - next[k];
+        next[k]       = static_cast<float>(damping[k] * (aa + bb));
+    }
+}
+} // namespace
+
+bool kernels::VerifyStencilRow(StencilRowFn fn, int count)
+{
+    const auto stride = count + 2;
+
+    std::vector<float> rows(3 * stride);
+    std::vector<float> damping(count);
+    std::vector<float> expected(count);
+
+    uint32_t state = 0x2545F491u;
+    auto random    = [&state]()
+    {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24) * 2.f - 1.f;
+    };
+
+    std::ranges::generate(rows, random);
+    std::ranges::generate(damping, [&random]() { return 0.95f * std::abs(random()); });
+    std::ranges::generate(expected, random);
+    auto actual    = expected;
+    auto reference = expected;
+
+    // Not representable in float, as the coefficients of most step times
+    const auto a = 0.1;
+    const auto b = 2.0 - 4.0 * a;
+
+    const float* up   = rows.data() + 1;
+    const float* curr = up + stride;
+    const float* down = curr + stride;
+
+    StencilRowScalar(up, curr, down, damping.data(), expected.data(), count, static_cast<float>(a),
+                     static_cast<float>(b));
+    fn(up, curr, down, damping.data(), actual.data(), count, static_cast<float>(a), static_cast<float>(b));
+    StencilRowReference(up, curr, down, damping.data(), reference.data(), count, a, b);
+
+    const auto withinTolerance = [](float x, float y) { return std::abs(x - y) <= STENCIL_TOLERANCE; };
+    return std::memcmp(expected.data(), actual.data(), count * sizeof(float)) == 0 &&
+           std::ranges::equal(actual, reference, withinTolerance);
+}
+
+bool kernels::VerifyBSplineRow(BSplineRowFn fn)
+{
+    // Odd length, so that every vector width leaves a scalar tail, and a few objects standing still
+    constexpr int count = 77;
+
+    std::array<std::vector<float>, 4> x;
+    std::array<std::vector<float>, 4> y;
+    std::vector<float> t(count);
+
+    uint32_t state = 0x2545F491u;
+    auto random    = [&state]()
+    {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24);
+    };
+
+    for (auto i = 0; i < 4; i++)
+    {
+        x[i].resize(count);
+        y[i].resize(count);
+        std::ranges::generate(x[i], [&random]() { return 10.f * random() - 5.f; });
+        std::ranges::generate(y[i], [&random]() { return 10.f * random() - 5.f; });
+    }
+    std::ranges::generate(t, random);
+    for (auto k = 0; k < count; k += 10)
+    {
+        for (auto i = 0; i < 4; i++)
+        {
+            x[i][k] = 1.f;
+            y[i][k] = -2.f;
+        }
+    }
+
+    const float* xs[4] = {x[0].data(), x[1].data(), x[2].data(), x[3].data()};
+    const float* ys[4] = {y[0].data(), y[1].data(), y[2].data(), y[3].data()};
+    std::array<std::vector<float>, 4> expected;
+    std::array<std::vector<float>, 4> actual;
+    std::ranges::for_each(expected, [](auto& values) { values.resize(count); });
+    std::ranges::for_each(actual, [](auto& values) { values.resize(count); });
+
+    BSplineRowScalar(xs, ys, t.data(), expected[0].data(), expected[1].data(), expected[2].data(), expected[3].data(),
+                     count);
+    fn(xs, ys, t.data(), actual[0].data(), actual[1].data(), actual[2].data(), actual[3].data(), count);
+
+    for (auto i = 0; i < 4; i++)
+    {
+        if (std::memcmp(expected[i].data(), actual[i].data(), count * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "normalMapEncoding.h"
+#include <cstdint>
+
+namespace mini::gk2::kernels
+{
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+    NEON,
+};
+
+const char* ToString(SimdLevel level);
+
+// Best instruction set supported by both the build and the running CPU
+SimdLevel DetectSimdLevel();
+
+bool IsSupported(SimdLevel level);
+
+// Computes `count` consecutive cells of one row of the wave equation stencil. All pointers point at the first
+// processed cell; `curr[-1]` and `curr[count]` must be readable (left and right neighbours).
+//
+//   next = damping * (a * (down + up + left + right) + (b * curr - next))
+//
+// Every implementation evaluates the expression in exactly this order and without fused multiply-add, so the results
+// are bit-exact with the scalar version. All of it is evaluated in float, the loop the kernels replaced evaluated the
+// coefficients and everything after the sum of the neighbours in double.
+using StencilRowFn = void (*)(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                              int count, float a, float b);
+
+void StencilRowScalar(const float* up, const float* curr, const float* down, const float* damping, float* next,
+                      int count, float a, float b);
+
+// Returns the kernel for the given level or the scalar one if the level is not supported
+StencilRowFn SelectStencilRow(SimdLevel level);
+
+inline StencilRowFn SelectStencilRow()
+{
+    return SelectStencilRow(DetectSimdLevel());
+}
+
+// Runs `fn` and the scalar kernel on the same pseudo-random rows of `count` cells and checks the results bit by bit,
+// then checks them against the double precision loop the kernels replaced within a tolerance. The default count is
+// odd, so that every vector width leaves a scalar tail.
+bool VerifyStencilRow(StencilRowFn fn, int count = 77);
+
+// Writes the normals [begin, end) of a height map row of `count` samples (Blinn method, heights outside the row are
+// treated as 0) as RGBA8 or, for the two channel kernels, RG8 (x, z) texels. All pointers point at the first sample of
+// the row. For the first and last row of the map `up`/`down` should point at a row of zeros.
+using NormalRowFn = void (*)(const float* up, const float* curr, const float* down, std::uint8_t* texels, int count,
+                             int begin, int end);
+
+void NormalRowScalar(const float* up, const float* curr, const float* down, std::uint8_t* rgba, int count, int begin,
+                     int end);
+
+void NormalRowRGScalar(const float* up, const float* curr, const float* down, std::uint8_t* rg, int count, int begin,
+                       int end);
+
+// BC5 maps are compressed from RG8 rows, so they share the RG8 kernel
+NormalRowFn SelectNormalRow(SimdLevel level, NormalMapEncoding encoding = NormalMapEncoding::RGBA8);
+
+// Converts `count` floats to half floats (normalEncoding::FloatToHalf)
+using FloatToHalfRowFn = void (*)(const float* values, std::uint16_t* halves, int count);
+
+void FloatToHalfRowScalar(const float* values, std::uint16_t* halves, int count);
+
+// F16C for the AVX levels when the CPU has it, the scalar conversion otherwise
+FloatToHalfRowFn SelectFloatToHalfRow(SimdLevel level);
+
+using HalfToFloatRowFn = void (*)(const std::uint16_t* halves, float* values, int count);
+
+void HalfToFloatRowScalar(const std::uint16_t* halves, float* values, int count);
+
+HalfToFloatRowFn SelectHalfToFloatRow(SimdLevel level);
+
+// 16 bit fixed point with `scale` steps per unit: the value is fixed / scale. Floats saturate at +-32767 steps and
+// round half away from zero.
+float FixedToFloat(std::int16_t fixed, float scale);
+std::int16_t FloatToFixed(float value, float scale);
+
+using FixedToFloatRowFn = void (*)(const std::int16_t* fixed, float scale, float* values, int count);
+using FloatToFixedRowFn = void (*)(const float* values, float scale, std::int16_t* fixed, int count);
+
+void FixedToFloatRowScalar(const std::int16_t* fixed, float scale, float* values, int count);
+void FloatToFixedRowScalar(const float* values, float scale, std::int16_t* fixed, int count);
+
+FixedToFloatRowFn SelectFixedToFloatRow(SimdLevel level);
+FloatToFixedRowFn SelectFloatToFixedRow(SimdLevel level);
+
+// Shallow water update of `count` consecutive faces of a staggered grid, between the cells `behind` and `ahead` of
+// them. The velocity is accelerated by the slope of the surface and damped, then the flux carries the water column
+// upwind of the face:
+//
+//   velocity = damping * (velocity - a * (ahead - behind))
+//   flux     = velocity * max(depth + (velocity > 0 ? behind : ahead), 0)
+//
+// Every implementation evaluates the expressions in this order and without fused multiply-add.
+using ShallowFaceRowFn = void (*)(const float* behind, const float* ahead, float* velocity, float* flux, int count,
+                                  float a, float damping, float depth);
+
+void ShallowFaceRowScalar(const float* behind, const float* ahead, float* velocity, float* flux, int count, float a,
+                          float damping, float depth);
+
+ShallowFaceRowFn SelectShallowFaceRow(SimdLevel level);
+
+// Shallow water height update of `count` consecutive cells from the fluxes through their faces. `left` points at the
+// flux through the left face of the first cell, so left[1] is its right face; `up` and `down` point at the fluxes
+// through the top and the bottom faces.
+//
+//   heights = heights - b * ((left[1] - left[0]) + (down - up))
+using ShallowHeightRowFn = void (*)(const float* left, const float* up, const float* down, float* heights, int count,
+                                    float b);
+
+void ShallowHeightRowScalar(const float* left, const float* up, const float* down, float* heights, int count, float b);
+
+ShallowHeightRowFn SelectShallowHeightRow(SimdLevel level);
+
+// Butterflies of an FFT applied to whole rows. A row holds `count` independent complex values as separate real and
+// imaginary arrays, so one call advances `count` transforms running along the columns. Twiddles are (real, imaginary)
+// pairs and every product is evaluated as (wr * r - wi * i, wr * i + wi * r).
+//
+// Radix-2:  t = w * x1, (x0, x1) = (x0 + t, x0 - t)
+using FftRadix2Fn = void (*)(float* re0, float* im0, float* re1, float* im1, float wRe, float wIm, int count);
+
+// Radix-4, two fused decimation in time radix-2 stages on the rows re[0..3], im[0..3]: (x0, x1) and (x2, x3) with the
+// twiddle w[0, 1], then (x0, x2) with w[2, 3] and (x1, x3) with w[4, 5]
+using FftRadix4Fn = void (*)(float* const* re, float* const* im, const float* w, int count);
+
+void FftRadix2Scalar(float* re0, float* im0, float* re1, float* im1, float wRe, float wIm, int count);
+void FftRadix4Scalar(float* const* re, float* const* im, const float* w, int count);
+
+FftRadix2Fn SelectFftRadix2(SimdLevel level);
+FftRadix4Fn SelectFftRadix4(SimdLevel level);
+
+// Positions and unit directions of `count` objects on uniform cubic B-spline segments, stored as a structure of arrays:
+// the segment of object k has the de Boor points (x[i][k], y[i][k]), i = 0..3, and is evaluated at t[k] in [0, 1].
+//
+//   position  = b0 * p0 + b1 * p1 + b2 * p2 + b3 * p3 with the basis (1 - t)^3 / 6, (3t^3 - 6t^2 + 4) / 6,
+//               (-3t^3 + 3t^2 + 3t + 1) / 6, t^3 / 6 and the derivative likewise with the derivatives of the basis
+//   direction = derivative / |derivative|, (1, 0) where the derivative is 0
+//
+// Every implementation evaluates the sums from left to right and without fused multiply-add.
+using BSplineRowFn = void (*)(const float* const* x, const float* const* y, const float* t, float* posX, float* posY,
+                              float* dirX, float* dirY, int count);
+
+void BSplineRowScalar(const float* const* x, const float* const* y, const float* t, float* posX, float* posY,
+                      float* dirX, float* dirY, int count);
+
+BSplineRowFn SelectBSplineRow(SimdLevel level);
+
+// Runs `fn` and the scalar kernel on the same pseudo-random segments and checks the results bit by bit
+bool VerifyBSplineRow(BSplineRowFn fn);
+
+// Returns the largest absolute value of `count` floats (0 for an empty range)
+using MaxAbsFn = float (*)(const float* values, int count);
+
+float MaxAbsScalar(const float* values, int count);
+
+MaxAbsFn SelectMaxAbs(SimdLevel level);
+} // namespace mini::gk2::kernels
@@ -1,172 +1,840 @@
 #include "pch.h"
 
+#include "utils/hashCombine.h"
 #include "utils/profiling.h"
 #include "waterSurfaceSimulation.h"
-#include <dxDevice.h>
+#include <cstring>
 #include <iostream>
 
-mini::gk2::WaterSurfaceSimulation::WaterSurfaceSimulation()
-    : Simulation(), m_currentHeightBuffer(0), m_samplesCount(SAMPLES_DEFAULT_SIZE), m_velocity(DEFAULT_VELOCITY),
-      m_randGenerator(std::random_device{}()), m_uniformDist(0, SAMPLES_DEFAULT_SIZE - 1), m_generateRandomDrops(false)
+template <typename Storage>
+mini::gk2::BasicWaterSurfaceSimulation<Storage>::BasicWaterSurfaceSimulation(int samplesCount)
+    : Simulation(), m_currentHeightBuffer(0), m_samplesCount(0), m_velocity(DEFAULT_VELOCITY),
+      m_simdLevel(kernels::DetectSimdLevel()), m_stencilRow(kernels::SelectStencilRow(m_simdLevel)),
+      m_normalRow(kernels::SelectNormalRow(m_simdLevel)), m_maxAbs(kernels::SelectMaxAbs(m_simdLevel)),
+      m_floatToHalf(kernels::SelectFloatToHalfRow(m_simdLevel)), m_storageKernels(Storage::SelectKernels(m_simdLevel)),
+      m_requestedNormalEncoding(NormalMapEncoding::RGBA8), m_normalEncoding(NormalMapEncoding::RGBA8), m_texelSize(4),
+      m_tilesPerRow(0), m_activeTilesCount(0), m_activityThreshold(DEFAULT_ACTIVITY_THRESHOLD), m_fusedNormalMap(true),
+      m_temporalBlocking(false), m_batchedSteps(true), m_normalMapValid(false),
+      m_randGenerator(std::random_device{}()), m_generateRandomDrops(false)
 {
-    SetStepTime(1.f / static_cast<float>(SAMPLES_DEFAULT_SIZE));
+    assert(kernels::VerifyStencilRow(m_stencilRow));
+
     SetSimSpeed(ANIMATION_SPEED);
+    Resize(samplesCount);
+}
 
-    GetCurrentHeightBuffer().resize(m_samplesCount * m_samplesCount, 0.f);
-    GetNextHeightBuffer().resize(m_samplesCount * m_samplesCount, 0.f);
-    m_normalMap.resize(m_samplesCount * m_samplesCount * 4, 0);
-    m_distances.resize(m_samplesCount * m_samplesCount, 0.f);
-    InitNormalMap();
-    InitDistances();
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::Resize(int samplesCount)
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::Resize");
+    m_samplesCount   = std::clamp(samplesCount, MIN_SAMPLES, MAX_SAMPLES);
+    const auto cells = m_samplesCount * m_samplesCount;
+
+    // The wave speed is expressed in grid units, so the step shrinks together with the cell size
+    SetStepTime(1.f / static_cast<float>(m_samplesCount));
+    m_uniformDist = std::uniform_int_distribution<int>(0, m_samplesCount - 1);
+
+    m_currentHeightBuffer = 0;
+    GetCurrentHeightBuffer().assign(cells, HeightValue{});
+    GetNextHeightBuffer().assign(cells, HeightValue{});
+    m_blockHeightBuffers = {};
+    m_dampingProfile.assign(m_samplesCount, 0.f);
+    m_zeroRow.assign(m_samplesCount, 0.f);
+    m_normalMapValid = false;
+
+    m_tilesPerRow    = (m_samplesCount + TILE_SIZE - 1) / TILE_SIZE;
+    const auto tiles = m_tilesPerRow * m_tilesPerRow;
+    m_tileAmplitudes[0].assign(tiles, 0.f);
+    m_tileAmplitudes[1].assign(tiles, 0.f);
+    m_tileActive.assign(tiles, 0);
+    m_tileNormalsDirty.assign(tiles, 0);
+    m_activeTilesCount = 0;
+
+    ResetNormalMap();
+    InitDampingProfile();
 }
 
-void mini::gk2::WaterSurfaceSimulation::MapToSurfaceTexture(DxDevice& device, dx_ptr<ID3D11Texture2D>& texture)
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::SetNormalEncoding(NormalMapEncoding encoding)
 {
-    PROFILE_ZONE("WaterSurfaceSimulation::MapToSurfaceTexture");
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    HRESULT hr = device.context()->Map(texture.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-    if (SUCCEEDED(hr))
-    {
-        const UINT rowSize = m_samplesCount * 4;
+    m_requestedNormalEncoding = encoding;
+    ResetNormalMap();
+}
 
-        BYTE* dest      = reinterpret_cast<BYTE*>(mapped.pData);
-        const BYTE* src = reinterpret_cast<const BYTE*>(m_normalMap.data());
-        for (UINT y = 0; y < m_samplesCount; ++y)
-        {
-            memcpy(dest, src, rowSize);
-            dest += mapped.RowPitch;
-            src += rowSize;
-        }
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::ResetNormalMap()
+{
+    const auto n     = m_samplesCount;
+    m_normalEncoding = normalEncoding::Resolve(m_requestedNormalEncoding, n, n);
+    m_normalRow      = kernels::SelectNormalRow(m_simdLevel, m_normalEncoding);
 
-        device.context()->Unmap(texture.get(), 0);
+    const auto texelEncoding = m_normalEncoding == NormalMapEncoding::BC5 ? NormalMapEncoding::RG8 : m_normalEncoding;
+    m_texelSize = static_cast<int>(normalEncoding::RowPitch(texelEncoding, 1));
+    m_normalMap.assign(normalEncoding::EncodedSize(texelEncoding, n, n), 0);
+    if (m_normalEncoding == NormalMapEncoding::BC5)
+    {
+        m_compressedNormalMap.assign(normalEncoding::EncodedSize(m_normalEncoding, n, n), 0);
+    }
+    else
+    {
+        m_compressedNormalMap.clear();
     }
+
+    m_dirtyRegions.Reset(n, n);
+    InitNormalMap();
 }
 
-void mini::gk2::WaterSurfaceSimulation::DropAt(float normalizedX, float normalizedY, float chance)
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::DropAt(float normalizedX, float normalizedY, float chance)
 {
     if (m_uniformDist(m_randGenerator) > m_samplesCount - static_cast<int>(static_cast<float>(m_samplesCount) * chance))
     {
-        auto i     = static_cast<int>(normalizedY * static_cast<float>(m_samplesCount));
-        auto j     = static_cast<int>(normalizedX * static_cast<float>(m_samplesCount));
-        auto& next = GetNextHeightBuffer();
-        SetValue(next, i, j, GetValue(next, i, j) + DROP_HEIGHT);
+        AddImpulse({normalizedX, normalizedY, DROP_RADIUS / static_cast<float>(m_samplesCount), DROP_HEIGHT});
     }
 }
 
-void mini::gk2::WaterSurfaceSimulation::Step()
+template <typename Storage> std::uint64_t mini::gk2::BasicWaterSurfaceSimulation<Storage>::StateHash() const
 {
-    PROFILE_ZONE("WaterSurfaceSimulation::Step");
-    auto stepTime = StepTime();
+    // The current buffer first, the buffers swap roles every step
+    const auto bytes = m_heightBuffers[0].size() * sizeof(HeightValue);
+    const auto hash  = HashBytes(m_heightBuffers[m_currentHeightBuffer].data(), bytes);
+    return HashBytes(m_heightBuffers[NextHeightBufferIndex()].data(), bytes, hash);
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::SetSimdLevel(kernels::SimdLevel level)
+{
+    m_simdLevel      = kernels::IsSupported(level) ? level : kernels::SimdLevel::Scalar;
+    m_stencilRow     = kernels::SelectStencilRow(m_simdLevel);
+    m_normalRow      = kernels::SelectNormalRow(m_simdLevel, m_normalEncoding);
+    m_maxAbs         = kernels::SelectMaxAbs(m_simdLevel);
+    m_floatToHalf    = kernels::SelectFloatToHalfRow(m_simdLevel);
+    m_storageKernels = Storage::SelectKernels(m_simdLevel);
+    assert(kernels::VerifyStencilRow(m_stencilRow));
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::Step()
+{
+    ApplyImpulses();
+    const auto [a, b] = StencilCoefficients();
+    AdvanceStep(a, b);
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::StepN(int count)
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::StepN");
+    if (!m_batchedSteps)
+    {
+        Simulation::StepN(count);
+        return;
+    }
+
+    // Nothing changes the step time until the Update() returns. The random drops of a step are applied by the next one
+    // as in Step(), those of a block after the block.
+    const auto [a, b] = StencilCoefficients();
+    while (count > 0)
+    {
+        ApplyImpulses();
+        const auto steps = m_temporalBlocking ? std::min(count, TEMPORAL_BLOCK_STEPS) : 1;
+        if (steps > 1)
+        {
+            StepBlock(steps, a, b);
+        }
+        else
+        {
+            AdvanceStep(a, b);
+        }
+        for (auto step = 0; step < steps; step++)
+        {
+            StepDone();
+        }
+        count -= steps;
+    }
+}
 
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::AdvanceStep(float a, float b)
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::Step");
     auto& curr = GetCurrentHeightBuffer();
     auto& next = GetNextHeightBuffer();
 
-    auto h = 2.f / static_cast<float>(m_samplesCount - 1);
-    auto a = m_velocity * m_velocity * stepTime * stepTime / h / h;
-    auto b = 2.f - 4.f * a;
+    UpdateTileActivity();
 
     // Edges are unchanged (Miguel Gomez, Game Programming Gems 1)
-    for (auto i = 1; i < m_samplesCount - 1; i++)
+    const auto n          = m_samplesCount;
+    const auto tiles      = m_tilesPerRow;
+    const auto bandSize   = TileBandSize();
+    auto& amplitudes      = m_tileAmplitudes[NextHeightBufferIndex()];
+    const auto stencilRow = [&](int i, BandScratch& scratch)
     {
-        for (auto j = 1; j < m_samplesCount - 1; j++)
+        const auto tileRow  = i / TILE_SIZE;
+        const auto* active  = m_tileActive.data() + tileRow * tiles;
+        auto* amplitude     = amplitudes.data() + tileRow * tiles;
+        const auto* damping = DampingRow(i, scratch.damping);
+        for (auto tileCol = 0; tileCol < tiles; tileCol++)
         {
-            auto aa = a * (GetValue(curr, i + 1, j) + GetValue(curr, i - 1, j) + GetValue(curr, i, j - 1) +
-                           GetValue(curr, i, j + 1));
-            auto bb = b * GetValue(curr, i, j) - GetValue(next, i, j);
-            SetValue(next, i, j, GetValue(m_distances, i, j) * (aa + bb));
+            if (!active[tileCol])
+            {
+                continue;
+            }
+            const auto begin  = std::max(tileCol * TILE_SIZE, 1);
+            const auto count  = std::min((tileCol + 1) * TILE_SIZE, n - 1) - begin;
+            const auto offset = i * n + begin;
+            if constexpr (FLOAT_HEIGHTS)
+            {
+                m_stencilRow(curr.data() + offset - n, curr.data() + offset, curr.data() + offset + n, damping + begin,
+                             next.data() + offset, count, a, b);
+                amplitude[tileCol] = std::max(amplitude[tileCol], m_maxAbs(next.data() + offset, count));
+            }
+            else
+            {
+                // Every row of the current heights is converted once per band, the next heights once per segment
+                const auto* up     = HeightRow(curr, i - 1, scratch.heights) + begin;
+                const auto* middle = HeightRow(curr, i, scratch.heights) + begin;
+                const auto* down   = HeightRow(curr, i + 1, scratch.heights) + begin;
+                scratch.next.resize(TILE_SIZE);
+                Storage::Load(m_storageKernels, next.data() + offset, scratch.next.data(), count);
+                m_stencilRow(up, middle, down, damping + begin, scratch.next.data(), count, a, b);
+                amplitude[tileCol] = std::max(amplitude[tileCol], m_maxAbs(scratch.next.data(), count));
+                Storage::Store(m_storageKernels, scratch.next.data(), next.data() + offset, count);
+            }
         }
+    };
+
+    // Interior rows [first, last] of a band of tile rows, empty when the band only covers the last row of the grid
+    const auto bandRows = [&](int tileBegin, int tileEnd)
+    { return std::pair{std::max(tileBegin * TILE_SIZE, 1), std::min(tileEnd * TILE_SIZE - 1, n - 2)}; };
+
+    const auto fuse  = m_fusedNormalMap && IsLastStep();
+    m_normalMapValid = fuse;
+    m_bandScratch.resize((tiles + bandSize - 1) / bandSize);
+
+    const auto bandTiles = ForEachTileBand(
+        [&](int tileBegin, int tileEnd)
+        {
+            std::fill(amplitudes.begin() + tileBegin * tiles, amplitudes.begin() + tileEnd * tiles, 0.f);
+
+            const auto [first, last] = bandRows(tileBegin, tileEnd);
+            if (first > last)
+            {
+                return;
+            }
+            // The rows cached by the last step are out of date
+            auto& scratch = m_bandScratch[tileBegin / bandSize];
+            scratch.heights.Invalidate();
+            scratch.normals.Invalidate();
+            if (!fuse)
+            {
+                for (auto i = first; i <= last; i++)
+                {
+                    stencilRow(i, scratch);
+                }
+                return;
+            }
+
+            // A normal needs the final heights of both neighbouring rows, so the normals trail the stencil by one
+            // row. Rows adjacent to another band are finished once all bands are done.
+            const auto lo = first == 1 ? 0 : first + 1;
+            const auto hi = last == n - 2 ? n - 1 : last - 1;
+            for (auto i = first; i <= last; i++)
+            {
+                stencilRow(i, scratch);
+                if (i - 1 >= lo && i - 1 <= hi)
+                {
+                    UpdateNormalRows(next, i - 1, i, scratch.normals);
+                }
+            }
+            UpdateNormalRows(next, std::max(lo, last), hi + 1, scratch.normals);
+        });
+
+    if (fuse && bandTiles < tiles)
+    {
+        const auto bands = (tiles + bandTiles - 1) / bandTiles;
+        Workers().ParallelFor(bands, 1,
+                              [&](int begin, int end)
+                              {
+                                  for (auto band = begin; band < end; band++)
+                                  {
+                                      const auto [first, last] =
+                                          bandRows(band * bandTiles, std::min((band + 1) * bandTiles, tiles));
+                                      if (first > last)
+                                      {
+                                          continue;
+                                      }
+                                      HeightRowCache cache;
+                                      if (first != 1)
+                                      {
+                                          UpdateNormalRows(next, first, first + 1, cache);
+                                      }
+                                      if (last != n - 2 && (last != first || first == 1))
+                                      {
+                                          UpdateNormalRows(next, last, last + 1, cache);
+                                      }
+                                  }
+                              });
+    }
+    if (fuse)
+    {
+        CommitDirtyNormals();
     }
 
     SwapHeightBuffers();
+    AddRandomDrop();
+}
+
+template <typename Storage>
+std::pair<float, float> mini::gk2::BasicWaterSurfaceSimulation<Storage>::StencilCoefficients() const
+{
+    const auto stepTime = StepTime();
+    const auto h        = 2.f / static_cast<float>(m_samplesCount - 1);
+    const auto a        = m_velocity * m_velocity * stepTime * stepTime / h / h;
+    return {static_cast<float>(a), static_cast<float>(2.f - 4.f * a)};
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::StepBlock(int steps, float a, float b)
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::StepBlock");
+    const auto n     = m_samplesCount;
+    const auto tiles = m_tilesPerRow;
+
+    // A wave crosses at most `steps` <= TILE_SIZE cells during the block, so it cannot get past the neighbouring tiles
+    // activated here
+    static_assert(TEMPORAL_BLOCK_STEPS <= TILE_SIZE);
+    UpdateTileActivity();
+
+    // The regions read both height buffers including the halos, the results go to a second pair of buffers
+    for (auto& buffer : m_blockHeightBuffers)
+    {
+        buffer.resize(m_heightBuffers[0].size());
+    }
+
+    // Buffers and local copies are indexed alike: `newer` holds the latest heights, `older` the ones before them
+    constexpr auto regionSize = TEMPORAL_BLOCK_TILES * TILE_SIZE;
+    const auto regions        = (tiles + TEMPORAL_BLOCK_TILES - 1) / TEMPORAL_BLOCK_TILES;
+    const auto newer          = m_currentHeightBuffer;
+    const auto older          = NextHeightBufferIndex();
+    const auto pitch          = regionSize + 2 * steps;
+
+    const auto stepRegionRows = [&](int regionRowBegin, int regionRowEnd)
+    {
+        std::array<std::vector<float>, 2> local;
+        std::ranges::for_each(local, [&](auto& heights) { heights.resize(pitch * pitch); });
+        std::vector<float> dampingRows(pitch * pitch);
+        std::vector<const float*> damping(pitch); // damping of the halo rows from their first column on
+
+        for (auto regionRow = regionRowBegin; regionRow < regionRowEnd; regionRow++)
+        {
+            for (auto regionCol = 0; regionCol < regions; regionCol++)
+            {
+                const auto tileRow0 = regionRow * TEMPORAL_BLOCK_TILES;
+                const auto tileRow1 = std::min(tileRow0 + TEMPORAL_BLOCK_TILES, tiles);
+                const auto tileCol0 = regionCol * TEMPORAL_BLOCK_TILES;
+                const auto tileCol1 = std::min(tileCol0 + TEMPORAL_BLOCK_TILES, tiles);
+                const auto r0       = tileRow0 * TILE_SIZE;
+                const auto r1       = std::min(tileRow1 * TILE_SIZE, n);
+                const auto c0       = tileCol0 * TILE_SIZE;
+                const auto c1       = std::min(tileCol1 * TILE_SIZE, n);
+
+                auto active = false;
+                for (auto tileRow = tileRow0; tileRow < tileRow1 && !active; tileRow++)
+                {
+                    active = std::any_of(m_tileActive.begin() + tileRow * tiles + tileCol0,
+                                         m_tileActive.begin() + tileRow * tiles + tileCol1, std::identity{});
+                }
+                if (!active)
+                {
+                    for (auto k = 0; k < 2; k++)
+                    {
+                        for (auto i = r0; i < r1; i++)
+                        {
+                            std::copy_n(m_heightBuffers[k].begin() + i * n + c0, c1 - c0,
+                                        m_blockHeightBuffers[k].begin() + i * n + c0);
+                        }
+                    }
+                    continue;
+                }
+
+                // The region with its halo, clipped to the grid
+                const auto haloR0 = std::max(r0 - steps, 0);
+                const auto haloR1 = std::min(r1 + steps, n);
+                const auto haloC0 = std::max(c0 - steps, 0);
+                const auto haloC1 = std::min(c1 + steps, n);
+                const auto at     = [&](int k, int i, int j)
+                { return local[k].data() + (i - haloR0) * pitch + (j - haloC0); };
+                for (auto k = 0; k < 2; k++)
+                {
+                    for (auto i = haloR0; i < haloR1; i++)
+                    {
+                        Storage::Load(m_storageKernels, m_heightBuffers[k].data() + i * n + haloC0, at(k, i, haloC0),
+                                      haloC1 - haloC0);
+                    }
+                }
+
+                // Same as DampingRow(), limited to the columns of the halo
+                for (auto i = haloR0; i < haloR1; i++)
+                {
+                    const auto rowDamping = m_dampingProfile[i];
+                    if (rowDamping == MAX_DAMPING)
+                    {
+                        damping[i - haloR0] = m_dampingProfile.data() + haloC0;
+                        continue;
+                    }
+                    auto* row = dampingRows.data() + (i - haloR0) * pitch;
+                    for (auto j = haloC0; j < haloC1; j++)
+                    {
+                        row[j - haloC0] = std::min(rowDamping, m_dampingProfile[j]);
+                    }
+                    damping[i - haloR0] = row;
+                }
+
+                // Every step leaves one more cell of the halo outdated. Edges are unchanged, as in Step().
+                auto curr = newer;
+                auto prev = older;
+                for (auto step = 1; step <= steps; step++)
+                {
+                    const auto halo  = steps - step;
+                    const auto begin = std::max(c0 - halo, 1);
+                    const auto count = std::min(c1 + halo, n - 1) - begin;
+                    for (auto i = std::max(r0 - halo, 1); i < std::min(r1 + halo, n - 1); i++)
+                    {
+                        m_stencilRow(at(curr, i - 1, begin), at(curr, i, begin), at(curr, i + 1, begin),
+                                     damping[i - haloR0] + begin - haloC0, at(prev, i, begin), count, a, b);
+                    }
+                    std::swap(curr, prev);
+                }
+
+                for (auto k = 0; k < 2; k++)
+                {
+                    for (auto i = r0; i < r1; i++)
+                    {
+                        Storage::Store(m_storageKernels, at(k, i, c0), m_blockHeightBuffers[k].data() + i * n + c0,
+                                       c1 - c0);
+                    }
+                }
+
+                // Inactive tiles of the region are stepped as well, they only change next to an active tile holding
+                // heights below the threshold
+                for (auto tileRow = tileRow0; tileRow < tileRow1; tileRow++)
+                {
+                    for (auto tileCol = tileCol0; tileCol < tileCol1; tileCol++)
+                    {
+                        const auto tile  = tileRow * tiles + tileCol;
+                        const auto col   = tileCol * TILE_SIZE;
+                        const auto width = std::min(col + TILE_SIZE, n) - col;
+                        for (auto k = 0; k < 2; k++)
+                        {
+                            auto amplitude = 0.f;
+                            for (auto i = tileRow * TILE_SIZE; i < std::min((tileRow + 1) * TILE_SIZE, n); i++)
+                            {
+                                amplitude = std::max(amplitude, m_maxAbs(at(k, i, col), width));
+                            }
+                            m_tileAmplitudes[k][tile] = amplitude;
+                            m_tileNormalsDirty[tile] |= amplitude > 0.f;
+                        }
+                    }
+                }
+            }
+        }
+    };
+    if (n < PARALLEL_MIN_SAMPLES)
+    {
+        stepRegionRows(0, regions);
+    }
+    else
+    {
+        Workers().ParallelFor(regions, 1, stepRegionRows);
+    }
+
+    std::swap(m_heightBuffers, m_blockHeightBuffers);
+    if (steps % 2 == 1)
+    {
+        SwapHeightBuffers();
+    }
+    m_normalMapValid = false;
+
+    // The drops of every step of the block
+    for (auto step = 0; step < steps; step++)
+    {
+        AddRandomDrop();
+    }
+}
 
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::AddRandomDrop()
+{
     if (!m_generateRandomDrops)
     {
         return;
     }
 
-    // Add new drops
     if (m_uniformDist(m_randGenerator) >
         m_samplesCount - static_cast<int>(static_cast<float>(m_samplesCount) * DROP_PROBABILITY))
     {
-        auto i = m_uniformDist(m_randGenerator);
-        auto j = m_uniformDist(m_randGenerator);
-        SetValue(next, i, j, GetValue(next, i, j) + DROP_HEIGHT);
+        // A bump like the ones of DropAt() centered on a random cell, applied by the next step
+        const auto i    = m_uniformDist(m_randGenerator);
+        const auto j    = m_uniformDist(m_randGenerator);
+        const auto size = static_cast<float>(m_samplesCount);
+        AddImpulse({(static_cast<float>(j) + 0.5f) / size, (static_cast<float>(i) + 0.5f) / size, DROP_RADIUS / size,
+                    DROP_HEIGHT});
     }
 }
 
-void mini::gk2::WaterSurfaceSimulation::PostUpdate()
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::ApplyImpulses()
 {
-    UpdateNormalMap();
+    if (m_impulses.empty())
+    {
+        return;
+    }
+    PROFILE_ZONE("WaterSurfaceSimulation::ApplyImpulses");
+
+    // The edges stay at rest, as in Step()
+    const auto n    = m_samplesCount;
+    const auto size = static_cast<float>(n);
+    m_splats.clear();
+    m_splatWeights.clear();
+    for (const auto& impulse : m_impulses)
+    {
+        const auto radius = impulse.radius * size;
+        const auto rows   = m_brush.Weights(impulse.y * size, radius, 1, n - 1, impulse.amplitude, m_splatWeights);
+        const auto cols   = m_brush.Weights(impulse.x * size, radius, 1, n - 1, 1.f, m_splatWeights);
+        if (rows.count > 0 && cols.count > 0)
+        {
+            m_splats.push_back({rows, cols});
+        }
+    }
+    m_impulses.clear();
+
+    // Every band adds the rows of all the splats crossing it, a band owns the amplitudes of its tiles
+    auto& heights    = GetCurrentHeightBuffer();
+    auto& amplitudes = m_tileAmplitudes[m_currentHeightBuffer];
+    const auto tiles = m_tilesPerRow;
+    ForEachTileBand(
+        [&](int tileBegin, int tileEnd)
+        {
+            const auto rowBegin = tileBegin * TILE_SIZE;
+            const auto rowEnd   = std::min(tileEnd * TILE_SIZE, n);
+            std::vector<float> scratch;
+            for (const auto& [rows, cols] : m_splats)
+            {
+                const auto* rowWeights = m_splatWeights.data() + rows.offset - rows.first;
+                const auto* colWeights = m_splatWeights.data() + cols.offset;
+                for (auto i = std::max(rows.first, rowBegin); i < std::min(rows.first + rows.count, rowEnd); i++)
+                {
+                    auto* row = heights.data() + i * n + cols.first;
+                    float* values;
+                    if constexpr (FLOAT_HEIGHTS)
+                    {
+                        values = row;
+                    }
+                    else
+                    {
+                        scratch.resize(cols.count);
+                        Storage::Load(m_storageKernels, row, scratch.data(), cols.count);
+                        values = scratch.data();
+                    }
+
+                    const auto weight = rowWeights[i];
+                    for (auto k = 0; k < cols.count; k++)
+                    {
+                        values[k] += weight * colWeights[k];
+                    }
+
+                    auto* amplitude = amplitudes.data() + (i / TILE_SIZE) * tiles;
+                    for (auto j = cols.first; j < cols.first + cols.count;)
+                    {
+                        const auto next     = std::min((j / TILE_SIZE + 1) * TILE_SIZE, cols.first + cols.count);
+                        auto& tileAmplitude = amplitude[j / TILE_SIZE];
+                        tileAmplitude       = std::max(tileAmplitude, m_maxAbs(values + j - cols.first, next - j));
+                        j                   = next;
+                    }
+
+                    if constexpr (!FLOAT_HEIGHTS)
+                    {
+                        Storage::Store(m_storageKernels, values, row, cols.count);
+                    }
+                }
+            }
+        });
 }
 
-void mini::gk2::WaterSurfaceSimulation::InitNormalMap()
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::PostUpdate()
+{
+    if (!m_normalMapValid)
+    {
+        UpdateNormalMap();
+    }
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::InitNormalMap()
 {
     PROFILE_ZONE("WaterSurfaceSimulation::InitNormalMap")
-    auto& curr = GetCurrentHeightBuffer();
-    for (auto i = 0; i < m_samplesCount; i++)
+    // Tiles at rest are never revisited, so the flat normals have to be encoded exactly like the computed ones
+    std::ranges::fill(m_tileNormalsDirty, 1);
+    UpdateNormalMap();
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::UpdateNormalMap()
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::UpdateNormalMap")
+    const auto& curr = GetCurrentHeightBuffer();
+    ForEachRowBand(m_samplesCount,
+                   [&](int begin, int end)
+                   {
+                       HeightRowCache cache;
+                       UpdateNormalRows(curr, begin, end, cache);
+                   });
+    CommitDirtyNormals();
+    m_normalMapValid = true;
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::UpdateNormalRows(const std::vector<HeightValue>& heights,
+                                                                       int begin, int end, HeightRowCache& cache)
+{
+    // Blinn method (https://en.wikipedia.org/wiki/Bump_mapping#Methods), the gradient is approximated with finite
+    // differences (https://en.wikipedia.org/wiki/Finite_difference) assuming 0.f when out of bounds
+    const auto n     = m_samplesCount;
+    const auto tiles = m_tilesPerRow;
+    begin            = std::max(begin, 0);
+    end              = std::min(end, n);
+    for (auto i = begin; i < end; i++)
     {
-        for (auto j = 0; j < m_samplesCount; j++)
+        const auto* up    = HeightRow(heights, i - 1, cache);
+        const auto* row   = HeightRow(heights, i, cache);
+        const auto* down  = HeightRow(heights, i + 1, cache);
+        const auto* dirty = m_tileNormalsDirty.data() + (i / TILE_SIZE) * tiles;
+
+        // Runs of neighbouring dirty tiles are encoded with a single call
+        for (auto tileCol = 0; tileCol < tiles;)
         {
-            auto normIdx             = (i * m_samplesCount + j) * 4;
-            m_normalMap[normIdx]     = 0;
-            m_normalMap[normIdx + 1] = 255;
-            m_normalMap[normIdx + 2] = 0;
-            m_normalMap[normIdx + 3] = 255; // alpha
+            if (!dirty[tileCol])
+            {
+                tileCol++;
+                continue;
+            }
+            auto runEnd = tileCol + 1;
+            while (runEnd < tiles && dirty[runEnd])
+            {
+                runEnd++;
+            }
+            const auto runBegin = tileCol * TILE_SIZE;
+            const auto runStop  = std::min(runEnd * TILE_SIZE, n);
+            if (normalEncoding::StoresHeights(m_normalEncoding))
+            {
+                PackHeights(row, i, runBegin, runStop);
+            }
+            else
+            {
+                m_normalRow(up, row, down, m_normalMap.data() + m_texelSize * i * n, n, runBegin, runStop);
+            }
+            tileCol = runEnd;
         }
     }
 }
 
-void mini::gk2::WaterSurfaceSimulation::UpdateNormalMap()
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::PackHeights(const float* heights, int i, int begin, int end)
 {
-    PROFILE_ZONE("WaterSurfaceSimulation::UpdateNormalMap")
-    auto& curr = GetCurrentHeightBuffer();
-    // Blinn method (https://en.wikipedia.org/wiki/Bump_mapping#Methods)
-    for (auto i = 0; i < m_samplesCount; i++)
+    // The shaders take the gradient from the neighbouring texels, the CPU only converts the heights
+    auto* dest = m_normalMap.data() + m_texelSize * (i * m_samplesCount + begin);
+    if (m_normalEncoding == NormalMapEncoding::R16F)
+    {
+        m_floatToHalf(heights + begin, reinterpret_cast<std::uint16_t*>(dest), end - begin);
+    }
+    else
     {
-        for (auto j = 0; j < m_samplesCount; j++)
+        std::memcpy(dest, heights + begin, (end - begin) * sizeof(float));
+    }
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::UpdateTileActivity()
+{
+    PROFILE_ZONE("WaterSurfaceSimulation::UpdateTileActivity")
+    // The stencil reads both buffers and a wave moves by at most one cell per step, so a tile has to be stepped while
+    // any tile of its 3x3 neighbourhood holds heights above the threshold in either buffer
+    const auto tiles     = m_tilesPerRow;
+    const auto& curr     = m_tileAmplitudes[m_currentHeightBuffer];
+    const auto& prev     = m_tileAmplitudes[NextHeightBufferIndex()];
+    const auto threshold = m_activityThreshold;
+    const auto aboveRest = [&](int tile) { return curr[tile] > threshold || prev[tile] > threshold; };
+    m_activeTilesCount   = 0;
+    for (auto tileRow = 0; tileRow < tiles; tileRow++)
+    {
+        for (auto tileCol = 0; tileCol < tiles; tileCol++)
+        {
+            auto active = false;
+            for (auto r = std::max(tileRow - 1, 0); r <= std::min(tileRow + 1, tiles - 1) && !active; r++)
+            {
+                for (auto c = std::max(tileCol - 1, 0); c <= std::min(tileCol + 1, tiles - 1) && !active; c++)
+                {
+                    active = aboveRest(r * tiles + c);
+                }
+            }
+
+            const auto tile    = tileRow * tiles + tileCol;
+            m_tileActive[tile] = active;
+            if (active)
+            {
+                m_tileNormalsDirty[tile] = 1;
+                m_activeTilesCount++;
+            }
+            else if (curr[tile] > 0.f || prev[tile] > 0.f)
+            {
+                // Leftovers below the threshold would never decay once the tile stops being stepped
+                FlattenTile(tileRow, tileCol);
+            }
+        }
+    }
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::FlattenTile(int tileRow, int tileCol)
+{
+    const auto n     = m_samplesCount;
+    const auto begin = tileCol * TILE_SIZE;
+    const auto count = std::min(begin + TILE_SIZE, n) - begin;
+    for (auto i = tileRow * TILE_SIZE; i < std::min((tileRow + 1) * TILE_SIZE, n); i++)
+    {
+        for (auto& buffer : m_heightBuffers)
+        {
+            std::fill_n(buffer.begin() + i * n + begin, count, HeightValue{});
+        }
+    }
+
+    const auto tile           = tileRow * m_tilesPerRow + tileCol;
+    m_tileAmplitudes[0][tile] = 0.f;
+    m_tileAmplitudes[1][tile] = 0.f;
+    m_tileNormalsDirty[tile]  = 1;
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::CommitDirtyNormals()
+{
+    const auto n     = m_samplesCount;
+    const auto tiles = m_tilesPerRow;
+
+    // Calls func(tileRow, tileColBegin, tileColEnd) for every run of dirty tiles
+    const auto forEachDirtyRun = [&](int tileRow, auto&& func)
+    {
+        const auto* dirty = m_tileNormalsDirty.data() + tileRow * tiles;
+        for (auto tileCol = 0; tileCol < tiles;)
         {
-            // 1. Gradient approx with finite difference (https://en.wikipedia.org/wiki/Finite_difference) for each
-            // partial derivative with edge smoothing (assuming 0.f when out of bounds)
-            float left  = (j > 0) ? curr[m_samplesCount * i + (j - 1)] : 0.0f;
-            float right = (j < m_samplesCount - 1) ? curr[m_samplesCount * i + (j + 1)] : 0.0f;
-            float up    = (i > 0) ? curr[m_samplesCount * (i - 1) + j] : 0.0f;
-            float down  = (i < m_samplesCount - 1) ? curr[m_samplesCount * (i + 1) + j] : 0.0f;
-
-            float dx = left - right;
-            float dy = 1.0f; // constant if surface is y = f(x,z)
-            float dz = up - down;
-
-            // 2. Normalize
-            const auto denom = std::sqrt(dx * dx + dy * dy + dz * dz);
-            dx               = dx / denom;
-            dy               = dy / denom;
-            dz               = dz / denom;
-
-            // 3. [-1, -1] -> [0, 1]
-            dx = (dx + 1.f) / 2.f;
-            dy = (dy + 1.f) / 2.f;
-            dz = (dz + 1.f) / 2.f;
-
-            const auto normIdx = 4 * (i * m_samplesCount + j);
-
-            m_normalMap[normIdx]     = static_cast<BYTE>(dx * 255.f);
-            m_normalMap[normIdx + 1] = static_cast<BYTE>(dy * 255.f);
-            m_normalMap[normIdx + 2] = static_cast<BYTE>(dz * 255.f);
-            m_normalMap[normIdx + 3] = 255; // alpha
+            if (!dirty[tileCol])
+            {
+                tileCol++;
+                continue;
+            }
+            auto runEnd = tileCol + 1;
+            while (runEnd < tiles && dirty[runEnd])
+            {
+                runEnd++;
+            }
+            func(tileRow, tileCol, runEnd);
+            tileCol = runEnd;
         }
+    };
+
+    if (m_normalEncoding == NormalMapEncoding::BC5)
+    {
+        PROFILE_ZONE("WaterSurfaceSimulation::EncodeBC5")
+        // A tile is a whole number of blocks, the grid size is a multiple of the block size
+        constexpr auto blocksPerTile = TILE_SIZE / normalEncoding::BC_BLOCK_SIZE;
+        const auto blocks            = n / normalEncoding::BC_BLOCK_SIZE;
+        ForEachTileBand(
+            [&](int tileBegin, int tileEnd)
+            {
+                for (auto tileRow = tileBegin; tileRow < tileEnd; tileRow++)
+                {
+                    forEachDirtyRun(tileRow,
+                                    [&](int row, int colBegin, int colEnd)
+                                    {
+                                        normalEncoding::EncodeBC5(
+                                            m_normalMap.data(), n, row * blocksPerTile,
+                                            std::min((row + 1) * blocksPerTile, blocks), colBegin * blocksPerTile,
+                                            std::min(colEnd * blocksPerTile, blocks), m_compressedNormalMap.data());
+                                    });
+                }
+            });
+    }
+
+    // Runs of dirty tiles become rectangles, DirtyRegions merges the ones of neighbouring tile rows
+    for (auto tileRow = 0; tileRow < tiles; tileRow++)
+    {
+        forEachDirtyRun(tileRow,
+                        [&](int row, int colBegin, int colEnd)
+                        {
+                            m_dirtyRegions.Add(
+                                {colBegin * TILE_SIZE, row * TILE_SIZE, colEnd * TILE_SIZE, (row + 1) * TILE_SIZE});
+                        });
+    }
+    std::ranges::fill(m_tileNormalsDirty, 0);
+}
+
+template <typename Storage>
+void mini::gk2::BasicWaterSurfaceSimulation<Storage>::InitDampingProfile()
+{
+    // The damping of a cell depends on its distance to the closest wall, min(i, j, n - i, n - j). The profile is
+    // monotonic in that distance, so the damping of (i, j) is min(profile[i], profile[j]).
+    const auto n = m_samplesCount;
+    for (auto k = 0; k < n; k++)
+    {
+        const auto wallDist = std::min(k, n - k);
+        const auto l        = 2.f * static_cast<float>(wallDist) / static_cast<float>(n);
+        m_dampingProfile[k] = MAX_DAMPING * std::min<float>(1.f, l / DAMPING_WIDTH);
     }
 }
 
-void mini::gk2::WaterSurfaceSimulation::InitDistances()
+template <typename Storage>
+const float* mini::gk2::BasicWaterSurfaceSimulation<Storage>::DampingRow(int i, std::vector<float>& scratch) const
 {
-    PROFILE_ZONE("WaterSurfaceSimulation::InitChebyshevDistance")
-    for (auto i = 0; i < m_samplesCount; i++)
+    // Rows away from the walls are damped by the profile itself
+    const auto rowDamping = m_dampingProfile[i];
+    if (rowDamping == MAX_DAMPING)
     {
-        for (auto j = 0; j < m_samplesCount; j++)
+        return m_dampingProfile.data();
+    }
+    scratch.resize(m_samplesCount);
+    std::ranges::transform(m_dampingProfile, scratch.begin(),
+                           [rowDamping](float damping) { return std::min(rowDamping, damping); });
+    return scratch.data();
+}
+
+template <typename Storage>
+const float* mini::gk2::BasicWaterSurfaceSimulation<Storage>::HeightRow(const std::vector<HeightValue>& heights, int i,
+                                                                       HeightRowCache& cache) const
+{
+    // Heights are 0.f out of bounds
+    if (i < 0 || i >= m_samplesCount)
+    {
+        return m_zeroRow.data();
+    }
+    if constexpr (FLOAT_HEIGHTS)
+    {
+        return heights.data() + i * m_samplesCount;
+    }
+    else
+    {
+        const auto slot = i % 3;
+        auto& row       = cache.rows[slot];
+        if (cache.loaded[slot] != i)
         {
-            auto wallDist = std::min<int>(std::min<int>(i, j), std::min<int>(m_samplesCount - i, m_samplesCount - j));
-            auto l        = 2.f * static_cast<float>(wallDist) / static_cast<float>(m_samplesCount);
-            m_distances[i * m_samplesCount + j] = 0.95f * std::min<float>(1.f, l / 0.2f);
+            row.resize(m_samplesCount);
+            Storage::Load(m_storageKernels, heights.data() + i * m_samplesCount, row.data(), m_samplesCount);
+            cache.loaded[slot] = i;
         }
+        return row.data();
     }
 }
+
+template class mini::gk2::BasicWaterSurfaceSimulation<mini::gk2::Float32Storage>;
+template class mini::gk2::BasicWaterSurfaceSimulation<mini::gk2::Float16Storage>;
+template class mini::gk2::BasicWaterSurfaceSimulation<mini::gk2::Fixed16Storage>;
@@ -1,48 +1,283 @@
 #pragma once
-#include "dxDevice.h"
+#include "dirtyRegions.h"
+#include "gaussianBrush.h"
 #include "simulation.h"
+#include "waterHeightStorage.h"
+#include "waterSurfaceKernels.h"
 #include <random>
+#include <span>
+#include <type_traits>
 namespace mini::gk2
 {
-class WaterSurfaceSimulation final : public Simulation
+// Wave equation on a samplesCount x samplesCount grid. Storage is one of the policies of waterHeightStorage.h and
+// decides how the height buffers are kept in memory, the computations are the same for all of them. The
+// implementation is instantiated for Float32Storage, Float16Storage and Fixed16Storage.
+template <typename Storage> class BasicWaterSurfaceSimulation final : public Simulation
 {
   public:
-    WaterSurfaceSimulation();
-    ~WaterSurfaceSimulation() final = default;
+    using HeightValue = typename Storage::Value;
+
+    explicit BasicWaterSurfaceSimulation(int samplesCount = SAMPLES_DEFAULT_SIZE);
+    ~BasicWaterSurfaceSimulation() final = default;
 
     static constexpr int SAMPLES_DEFAULT_SIZE = 256;
+    static constexpr int MIN_SAMPLES          = 16;
+    static constexpr int MAX_SAMPLES          = 4096;
     static constexpr float DEFAULT_VELOCITY   = 1;
     static constexpr float DROP_HEIGHT        = 0.6f;
+    static constexpr float DROP_RADIUS        = 0.75f; // cells, standard deviation of the drop bumps
 
     static constexpr float ANIMATION_SPEED  = 0.2f;
     static constexpr float DROP_PROBABILITY = 0.2f;
 
-    void MapToSurfaceTexture(::mini::DxDevice& device, dx_ptr<ID3D11Texture2D>& texture);
+    // Damping grows linearly from 0 at the walls to MAX_DAMPING at DAMPING_WIDTH (in units of the half extent)
+    static constexpr float MAX_DAMPING   = 0.95f;
+    static constexpr float DAMPING_WIDTH = 0.2f;
+
+    // Smaller grids are stepped on the calling thread, waking the workers costs more than the stencil itself
+    static constexpr int PARALLEL_MIN_SAMPLES = 512;
+    static constexpr int MIN_BAND_ROWS        = 16;
+    static constexpr int BANDS_PER_THREAD     = 4;
+
+    // The grid is split into TILE_SIZE x TILE_SIZE tiles, a tile is only stepped while it or one of its neighbours
+    // moves by more than the activity threshold
+    static constexpr int TILE_SIZE                    = 32;
+    static constexpr float DEFAULT_ACTIVITY_THRESHOLD = 1e-4f;
+
+    // With temporal blocking an Update() running several steps advances the grid by up to TEMPORAL_BLOCK_STEPS steps
+    // at once, region by region. A region of TEMPORAL_BLOCK_TILES x TEMPORAL_BLOCK_TILES tiles is copied together with
+    // a halo of TEMPORAL_BLOCK_STEPS cells, which the neighbouring regions step as well. Both copies of a region take
+    // 2 * (4 * 32 + 2 * 8)^2 floats, about the size of an L2 cache.
+    static constexpr int TEMPORAL_BLOCK_STEPS = 8;
+    static constexpr int TEMPORAL_BLOCK_TILES = 4;
+
+    // Normal map regions changed since the last upload (see surfaceUpload.h)
+    const DirtyRegions& SurfaceDirtyRegions() const
+    {
+        return m_dirtyRegions;
+    }
+
+    DirtyRegions& SurfaceDirtyRegions()
+    {
+        return m_dirtyRegions;
+    }
+
+    // Reallocates the grid (clamped to [MIN_SAMPLES, MAX_SAMPLES]) and resets the surface to rest. The surface
+    // texture has to be recreated with the new size afterwards.
+    void Resize(int samplesCount);
+
+    int SamplesCount() const
+    {
+        return m_samplesCount;
+    }
+
+    // SamplesCount() x SamplesCount() texels, RGBA8 or RG8 (also for BC5, which is compressed from it). With the
+    // height encodings the packed heights instead.
+    const std::vector<std::uint8_t>& NormalMap() const
+    {
+        return m_normalMap;
+    }
+
+    // Selects the format of the surface texture. BC5 needs a grid size divisible by 4 and falls back to RG8
+    // otherwise. R16F/R32F upload the heights and leave the normals to the shaders. Rebuilds the normal map, so the
+    // texture has to be recreated afterwards.
+    void SetNormalEncoding(NormalMapEncoding encoding);
+
+    // Encoding actually used for the current grid size
+    NormalMapEncoding NormalEncoding() const
+    {
+        return m_normalEncoding;
+    }
+
+    // Contents of the surface texture in NormalEncoding(), SurfaceTextureRows() rows of SurfaceTextureRowPitch() bytes
+    const std::uint8_t* SurfaceTextureData() const
+    {
+        return m_normalEncoding == NormalMapEncoding::BC5 ? m_compressedNormalMap.data() : m_normalMap.data();
+    }
+
+    unsigned int SurfaceTextureRowPitch() const
+    {
+        return static_cast<unsigned int>(normalEncoding::RowPitch(m_normalEncoding, m_samplesCount));
+    }
+
+    int SurfaceTextureRows() const
+    {
+        return normalEncoding::PitchRows(m_normalEncoding, m_samplesCount);
+    }
 
     void GeneretateRandomDrops(bool flag)
     {
         m_generateRandomDrops = flag;
     }
 
+    // Queues a bump of DROP_HEIGHT with the given chance
     void DropAt(float normalizedX, float normalizedY, float chance = 1.f);
 
+    // Queues Gaussian bumps, the queue is splatted into the heights in a single pass at the start of the next step.
+    // Bumps are added in the order they were queued, the result does not depend on the number of threads.
+    void AddImpulses(std::span<const WaterImpulse> impulses)
+    {
+        m_impulses.insert(m_impulses.end(), impulses.begin(), impulses.end());
+    }
+
+    void AddImpulse(const WaterImpulse& impulse)
+    {
+        m_impulses.push_back(impulse);
+    }
+
+    // Impulses waiting for the next step
+    std::size_t PendingImpulsesCount() const
+    {
+        return m_impulses.size();
+    }
+
+    // Restarts the generator deciding the drops, equal seeds give equal simulations
+    void Seed(std::uint32_t seed)
+    {
+        m_randGenerator.seed(seed);
+    }
+
+    // Hash of both height buffers, equal on every machine for equal heights. Impulses still queued are not included.
+    std::uint64_t StateHash() const;
+
+    // Current height of the cell in row i, column j
+    float Height(int i, int j) const
+    {
+        return GetHeight(m_currentHeightBuffer, i, j);
+    }
+
+    // Selects the stencil kernel, unsupported instruction sets fall back to the scalar kernel
+    void SetSimdLevel(kernels::SimdLevel level);
+
+    kernels::SimdLevel SimdLevel() const
+    {
+        return m_simdLevel;
+    }
+
+    // Builds the normal map in the same sweep as the last step of an Update() instead of a separate pass
+    void SetFusedNormalMap(bool flag)
+    {
+        m_fusedNormalMap = flag;
+    }
+
+    bool FusedNormalMap() const
+    {
+        return m_fusedNormalMap;
+    }
+
+    // Steps the tiles in blocks of several steps while they stay in the cache, see TEMPORAL_BLOCK_STEPS. The random
+    // drops of a block land after its last step.
+    void SetTemporalBlocking(bool flag)
+    {
+        m_temporalBlocking = flag;
+    }
+
+    bool TemporalBlocking() const
+    {
+        return m_temporalBlocking;
+    }
+
+    // Runs the steps of an Update() in one StepN() sharing their setup instead of a virtual Step() each, the results
+    // are the same
+    void SetBatchedSteps(bool flag)
+    {
+        m_batchedSteps = flag;
+    }
+
+    bool BatchedSteps() const
+    {
+        return m_batchedSteps;
+    }
+
+    // Tiles whose heights stay below the threshold are flattened and skipped, 0 only skips tiles at exact rest
+    void SetActivityThreshold(float threshold)
+    {
+        m_activityThreshold = std::max(threshold, 0.f);
+    }
+
+    float ActivityThreshold() const
+    {
+        return m_activityThreshold;
+    }
+
+    // Number of tiles advanced by the last step
+    int ActiveTilesCount() const
+    {
+        return m_activeTilesCount;
+    }
+
+    int TilesCount() const
+    {
+        return m_tilesPerRow * m_tilesPerRow;
+    }
+
   protected:
+    // A single step, StepN() also steps the temporal blocks
     void Step() final;
+    void StepN(int count) final;
     void PostUpdate() final;
 
   private:
+    static constexpr bool FLOAT_HEIGHTS = std::is_same_v<HeightValue, float>;
+
+    // Float copies of the last three height rows read by a pass, so that the compact storages convert every row once.
+    // Unused with float heights.
+    struct HeightRowCache
+    {
+        std::array<std::vector<float>, 3> rows;
+        std::array<int, 3> loaded = {-1, -1, -1};
+
+        void Invalidate()
+        {
+            loaded = {-1, -1, -1};
+        }
+    };
+
+    // Per band scratch of a step: damping of a row near the walls and, for the compact storages, float copies of the
+    // current heights around the row and of the segment of the next heights being computed
+    struct BandScratch
+    {
+        std::vector<float> damping;
+        std::vector<float> next;
+        HeightRowCache heights;
+        HeightRowCache normals;
+    };
+
+    // Coefficients of the stencil for the current step time:
+    // next = damping * (a * (up + down + left + right) + b * curr - prev)
+    std::pair<float, float> StencilCoefficients() const;
+    void AdvanceStep(float a, float b);
+    void StepBlock(int steps, float a, float b);
+    void AddRandomDrop();
+    void ApplyImpulses();
+
+    void ResetNormalMap();
     void InitNormalMap();
     void UpdateNormalMap();
-    void InitDistances();
+    void UpdateNormalRows(const std::vector<HeightValue>& heights, int begin, int end, HeightRowCache& cache);
+    void PackHeights(const float* heights, int i, int begin, int end);
+    const float* HeightRow(const std::vector<HeightValue>& heights, int i, HeightRowCache& cache) const;
+
+    void InitDampingProfile();
+    const float* DampingRow(int i, std::vector<float>& scratch) const;
+
+    void UpdateTileActivity();
+    void FlattenTile(int tileRow, int tileCol);
+    void CommitDirtyNormals();
 
-    std::vector<float>& GetCurrentHeightBuffer()
+    std::vector<HeightValue>& GetCurrentHeightBuffer()
     {
         return m_heightBuffers[m_currentHeightBuffer];
     }
 
-    std::vector<float>& GetNextHeightBuffer()
+    std::vector<HeightValue>& GetNextHeightBuffer()
     {
-        return m_heightBuffers[(m_currentHeightBuffer + 1) % 2];
+        return m_heightBuffers[NextHeightBufferIndex()];
+    }
+
+    int NextHeightBufferIndex() const
+    {
+        return (m_currentHeightBuffer + 1) % 2;
     }
 
     void SwapHeightBuffers()
@@ -50,27 +285,109 @@ class WaterSurfaceSimulation final : public Simulation
         m_currentHeightBuffer = (m_currentHeightBuffer + 1) % 2;
     }
 
-    template <typename T> T GetValue(const std::vector<T>& buff, int i, int j) const
+    // Calls func(begin, end) for bands of rows covering [0, rows), in parallel for large grids. Returns the band
+    // height.
+    template <typename Func> int ForEachRowBand(int rows, Func&& func)
     {
-        return buff[i * m_samplesCount + j];
+        if (m_samplesCount < PARALLEL_MIN_SAMPLES)
+        {
+            func(0, rows);
+            return rows;
+        }
+        auto& workers       = Workers();
+        const auto bands    = static_cast<int>(workers.ThreadCount()) * BANDS_PER_THREAD;
+        const auto bandRows = std::max(MIN_BAND_ROWS, (rows + bands - 1) / bands);
+        workers.ParallelFor(rows, bandRows, func);
+        return bandRows;
     }
 
-    template <typename T> T SetValue(std::vector<T>& buff, int i, int j, float val) const
+    // Like ForEachRowBand, but the bands consist of whole tile rows, so a band owns the per-tile state of its tiles
+    template <typename Func> int ForEachTileBand(Func&& func)
     {
-        return buff[i * m_samplesCount + j] = val;
+        const auto bandTiles = TileBandSize();
+        if (bandTiles == m_tilesPerRow)
+        {
+            func(0, m_tilesPerRow);
+            return m_tilesPerRow;
+        }
+        Workers().ParallelFor(m_tilesPerRow, bandTiles, func);
+        return bandTiles;
+    }
+
+    // Tile rows per band of ForEachTileBand(), the band starting at tile row k * TileBandSize() is the k-th
+    int TileBandSize() const
+    {
+        if (m_samplesCount < PARALLEL_MIN_SAMPLES)
+        {
+            return m_tilesPerRow;
+        }
+        const auto bands = static_cast<int>(Workers().ThreadCount()) * BANDS_PER_THREAD;
+        return (m_tilesPerRow + bands - 1) / bands;
+    }
+
+    float GetHeight(int buffer, int i, int j) const
+    {
+        return Storage::ToFloat(m_heightBuffers[buffer][i * m_samplesCount + j]);
+    }
+
+    void SetHeight(int buffer, int i, int j, float height)
+    {
+        m_heightBuffers[buffer][i * m_samplesCount + j] = Storage::FromFloat(height);
     }
 
   private:
-    std::array<std::vector<float>, 2> m_heightBuffers;
-    std::vector<BYTE> m_normalMap;
-    std::vector<float> m_distances;
+    std::array<std::vector<HeightValue>, 2> m_heightBuffers;
+    std::array<std::vector<HeightValue>, 2> m_blockHeightBuffers; // results of a temporal block, swapped in after it
+    std::vector<std::uint8_t> m_normalMap;
+    std::vector<std::uint8_t> m_compressedNormalMap; // BC5 blocks of m_normalMap
+    std::vector<float> m_dampingProfile;             // damping of the rows and columns by their index
+    std::vector<float> m_zeroRow;                    // neighbour of the border rows while computing normals
     int m_currentHeightBuffer;
     int m_samplesCount;
     float m_velocity;
 
+    kernels::SimdLevel m_simdLevel;
+    kernels::StencilRowFn m_stencilRow;
+    kernels::NormalRowFn m_normalRow;
+    kernels::MaxAbsFn m_maxAbs;
+    kernels::FloatToHalfRowFn m_floatToHalf;
+    typename Storage::Kernels m_storageKernels; // Load and Store of the height buffers
+
+    NormalMapEncoding m_requestedNormalEncoding;
+    NormalMapEncoding m_normalEncoding;
+    int m_texelSize; // bytes per texel of m_normalMap
+
+    std::array<std::vector<float>, 2> m_tileAmplitudes; // max |height| per tile of the matching height buffer
+    std::vector<std::uint8_t> m_tileActive;             // tiles advanced by the current step
+    std::vector<std::uint8_t> m_tileNormalsDirty;       // tiles whose normals are out of date
+    DirtyRegions m_dirtyRegions;                        // re-encoded normals not uploaded yet
+    int m_tilesPerRow;
+    int m_activeTilesCount;
+    float m_activityThreshold;
+
+    bool m_fusedNormalMap;
+    bool m_temporalBlocking;
+    bool m_batchedSteps;
+    bool m_normalMapValid;                  // set when the last step already produced the normal map
+    std::vector<BandScratch> m_bandScratch; // kept between the steps, so that they do not allocate
+
     bool m_generateRandomDrops;
 
+    // Row and column weights of a queued impulse, clipped to the interior of the grid
+    struct ImpulseSplat
+    {
+        GaussianBrush::Span rows;
+        GaussianBrush::Span cols;
+    };
+
+    GaussianBrush m_brush;
+    std::vector<WaterImpulse> m_impulses; // applied by the next step
+    std::vector<ImpulseSplat> m_splats;
+    std::vector<float> m_splatWeights; // weights of m_splats, the row weights include the amplitude
+
     std::mt19937 m_randGenerator;
     std::uniform_int_distribution<int> m_uniformDist;
 };
+
+using WaterSurfaceSimulation = BasicWaterSurfaceSimulation<Float32Storage>;
 } // namespace mini::gk2
@@ -0,0 +1,63 @@
+#include "pch.h"
+
+#include "meshFile.h"
+#include <cstdio>
+#include <string_view>
+
+using namespace mini;
+
+// Converts every mesh of the text format of LoadMeshData given on the command line to a .mesh file next to it, or to
+// the path after --output for a single mesh. --overdraw adds the overdraw order of OptimizeOverdraw to the vertex cache
+// order of every conversion.
+int main(int argc, char* argv[])
+{
+    std::vector<std::filesystem::path> inputs;
+    std::filesystem::path output;
+    auto overdraw = false;
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (arg == "--overdraw")
+        {
+            overdraw = true;
+        }
+        else
+        {
+            inputs.emplace_back(arg);
+        }
+    }
+    if (inputs.empty() || (!output.empty() && inputs.size() > 1))
+    {
+        std::println(stderr, "usage: meshConvert [--overdraw] <mesh.txt>... | "
+                             "meshConvert [--overdraw] <mesh.txt> --output <mesh.mesh>");
+        return 2;
+    }
+
+    auto failures = 0;
+    for (const auto& input : inputs)
+    {
+        const auto meshPath =
+            output.empty() ? std::filesystem::path(input).replace_extension(MESH_FILE_EXTENSION) : output;
+        try
+        {
+            const auto report = ConvertMeshFile(input, meshPath, overdraw);
+            const MappedMeshFile converted(meshPath);
+            std::println(stderr, "{} -> {}: {} vertices, {} triangles, {} bit indices, {} bytes", input.string(),
+                         meshPath.string(), converted.Vertices().size(), converted.Header().indexCount / 3,
+                         8 * converted.Header().indexSize, std::filesystem::file_size(meshPath));
+            std::println(stderr, "  ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} (FIFO cache of {} vertices)",
+                         report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr,
+                         ANALYZED_CACHE_SIZE);
+        }
+        catch (const std::exception& error)
+        {
+            std::println(stderr, "{}: {}", input.string(), error.what());
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}